@@ -23,6 +23,10 @@ enum ofp_extension_commands { /* Queue configuration commands */
     OFP_EXT_QUEUE_MODIFY,  /* Add and/or modify */
     OFP_EXT_QUEUE_DELETE,  /* Remove a queue */
     OFP_EXT_SET_DESC,      /* Set ofp_desc_stat->dp_desc */
+    OFP_EXT_FLOW_CACHE_REQUEST, /* Get flow cache counters */
+    OFP_EXT_FLOW_CACHE_REPLY,   /* Flow cache counters */
+    OFP_EXT_PKTIN_RATE_REQUEST, /* Get packet in rate limiter counters */
+    OFP_EXT_PKTIN_RATE_REPLY,   /* Packet in rate limiter counters */
 
     OFP_EXT_COUNT
 };
@@ -87,6 +91,25 @@ struct openflow_ext_set_dp_desc {
 };
 OFP_ASSERT(sizeof(struct openflow_ext_set_dp_desc) == 272);
 
+/* Body of OFP_EXT_FLOW_CACHE_REPLY; the request has no body. The counters
+ * are the sums over the caches of all threads processing packets. */
+struct openflow_ext_flow_cache_stats {
+    struct ofp_extension_header header;
+    uint64_t hits;              /* table lookups answered by the cache. */
+    uint64_t misses;            /* table lookups done by the classifier. */
+};
+OFP_ASSERT(sizeof(struct openflow_ext_flow_cache_stats) == 32);
+
+/* Body of OFP_EXT_PKTIN_RATE_REPLY; the request has no body. The counters
+ * are zero if the datapath does not rate limit packet ins. */
+struct openflow_ext_pktin_rate_stats {
+    struct ofp_extension_header header;
+    uint64_t normal;            /* packet ins sent without queueing. */
+    uint64_t limited;           /* packet ins queued by the rate limiter. */
+    uint64_t dropped;           /* queued packet ins dropped on overflow. */
+};
+OFP_ASSERT(sizeof(struct openflow_ext_pktin_rate_stats) == 40);
+
 #define ofq_error_string(rv) (((rv) < OFQ_ERR_COUNT) && ((rv) >= 0) ? \
     openflow_queue_error_strings[rv] : "Unknown error code")
 
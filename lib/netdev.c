@@ -926,6 +926,96 @@ netdev_recv(struct netdev *netdev, struct ofpbuf *buffer)
     }
 }
 
+/* Attempts to receive up to 'n_buffers' packets from 'netdev' with as few
+ * system calls as possible.  Each of 'buffers' must be empty and initialized
+ * as required by netdev_recv().  At most NETDEV_MAX_BATCH packets are
+ * received in one call.
+ *
+ * On return '*n_received' is the number of packets received, which are
+ * stored in the first '*n_received' elements of 'buffers' (the elements may
+ * be reordered); the remaining buffers are left empty.  Returns 0 if at
+ * least one packet was received, otherwise a positive errno value.  Returns
+ * EAGAIN immediately if no packet is ready to be returned.
+ */
+int
+netdev_recv_batch(struct netdev *netdev, struct ofpbuf **buffers,
+                  size_t n_buffers, size_t *n_received)
+{
+#ifdef HAVE_RECVMMSG
+    struct mmsghdr msgs[NETDEV_MAX_BATCH];
+    struct iovec iovs[NETDEV_MAX_BATCH];
+    struct sockaddr_ll slls[NETDEV_MAX_BATCH];
+    size_t received;
+    size_t i;
+    int n_msgs;
+#endif
+
+    *n_received = 0;
+    if (n_buffers > NETDEV_MAX_BATCH) {
+        n_buffers = NETDEV_MAX_BATCH;
+    }
+
+#ifdef HAVE_RECVMMSG
+    /* cannot execute recvmmsg over a tap device */
+    if (strncmp(netdev->name, "tap", 3)) {
+        for (i = 0; i < n_buffers; i++) {
+            assert(buffers[i]->size == 0);
+            assert(ofpbuf_tailroom(buffers[i]) >= ETH_TOTAL_MIN);
+
+            iovs[i].iov_base = ofpbuf_tail(buffers[i]);
+            iovs[i].iov_len = ofpbuf_tailroom(buffers[i]);
+
+            memset(&msgs[i], 0, sizeof msgs[i]);
+            msgs[i].msg_hdr.msg_name = &slls[i];
+            msgs[i].msg_hdr.msg_namelen = sizeof slls[i];
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        do {
+            n_msgs = recvmmsg(netdev->tap_fd, msgs, n_buffers, MSG_DONTWAIT, NULL);
+        } while (n_msgs < 0 && errno == EINTR);
+
+        if (n_msgs >= 0) {
+            received = 0;
+            for (i = 0; i < (size_t) n_msgs; i++) {
+                struct ofpbuf *buffer = buffers[i];
+
+                /* see netdev_recv() on filtering outgoing packets. */
+                if (slls[i].sll_pkttype == PACKET_OUTGOING) {
+                    continue;
+                }
+                buffer->size += msgs[i].msg_len;
+                pad_to_minimum_length(buffer);
+
+                buffers[i] = buffers[received];
+                buffers[received] = buffer;
+                received++;
+            }
+            *n_received = received;
+            return received > 0 ? 0 : EAGAIN;
+        }
+        if (errno != ENOSYS) {
+            if (errno != EAGAIN) {
+                VLOG_WARN_RL(LOG_MODULE, &rl, "error receiving Ethernet packets on %s: %s",
+                             netdev->name, strerror(errno));
+            }
+            return errno;
+        }
+        /* fall back to receiving one packet at a time. */
+    }
+#endif
+
+    while (*n_received < n_buffers) {
+        int error = netdev_recv(netdev, buffers[*n_received]);
+        if (error) {
+            return *n_received > 0 ? 0 : error;
+        }
+        (*n_received)++;
+    }
+    return 0;
+}
+
 /* Registers with the poll loop to wake up from the next call to poll_block()
  * when a packet is ready to be received with netdev_recv() on 'netdev'. */
 void
@@ -992,6 +1082,90 @@ netdev_send(struct netdev *netdev, const struct ofpbuf *buffer,
     }
 }
 
+/* Sends the 'n_buffers' packets in 'buffers' on 'netdev' through the queue
+ * 'class_id', with as few system calls as possible.  Packets are sent in
+ * order; a packet which cannot be sent is dropped and the following ones are
+ * still attempted.
+ *
+ * Returns the number of packets which were sent successfully. */
+size_t
+netdev_send_batch(struct netdev *netdev, struct ofpbuf **buffers,
+                  size_t n_buffers, uint16_t class_id)
+{
+    size_t n_sent = 0;
+    size_t i;
+#ifdef HAVE_SENDMMSG
+    struct mmsghdr msgs[NETDEV_MAX_BATCH];
+    struct iovec iovs[NETDEV_MAX_BATCH];
+#endif
+
+    assert(class_id <= NETDEV_MAX_QUEUES);
+
+#ifdef HAVE_SENDMMSG
+    /* cannot execute sendmmsg over a tap device */
+    if (strncmp(netdev->name, "tap", 3)) {
+        size_t n_msgs;
+
+        while (n_buffers > 0) {
+            n_msgs = MIN(n_buffers, NETDEV_MAX_BATCH);
+
+            for (i = 0; i < n_msgs; i++) {
+                iovs[i].iov_base = buffers[i]->data;
+                iovs[i].iov_len = buffers[i]->size;
+
+                memset(&msgs[i], 0, sizeof msgs[i]);
+                msgs[i].msg_hdr.msg_iov = &iovs[i];
+                msgs[i].msg_hdr.msg_iovlen = 1;
+            }
+
+            i = 0;
+            while (i < n_msgs) {
+                int retval = sendmmsg(netdev->queue_fd[class_id], &msgs[i],
+                                      n_msgs - i, 0);
+                if (retval < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    if (errno == ENOSYS) {
+                        goto fallback;
+                    }
+                    /* ENOBUFS and EAGAIN simply mean the packet is dropped,
+                     * as in netdev_send(). */
+                    if (errno != ENOBUFS && errno != EAGAIN) {
+                        VLOG_WARN_RL(LOG_MODULE, &rl, "error sending Ethernet packet on %s: %s",
+                                     netdev->name, strerror(errno));
+                    }
+                    i++;
+                } else {
+                    size_t end = i + retval;
+                    for (; i < end; i++) {
+                        if (msgs[i].msg_len == buffers[i]->size) {
+                            n_sent++;
+                        } else {
+                            VLOG_WARN_RL(LOG_MODULE, &rl,
+                                         "send partial Ethernet packet (%u bytes of %zu) on %s",
+                                         msgs[i].msg_len, buffers[i]->size, netdev->name);
+                        }
+                    }
+                }
+            }
+
+            buffers += n_msgs;
+            n_buffers -= n_msgs;
+        }
+        return n_sent;
+    }
+ fallback:
+#endif
+
+    for (i = 0; i < n_buffers; i++) {
+        if (!netdev_send(netdev, buffers[i], class_id)) {
+            n_sent++;
+        }
+    }
+    return n_sent;
+}
+
 /* Registers with the poll loop to wake up from the next call to poll_block()
  * when the packet transmission queue has sufficient room to transmit a packet
  * with netdev_send().
@@ -1046,6 +1220,14 @@ netdev_get_name(const struct netdev *netdev)
     return netdev->name;
 }
 
+/* Returns the file descriptor packets are received on from 'netdev', for
+ * callers that wait for packets outside of the poll loop. */
+int
+netdev_get_fd(const struct netdev *netdev)
+{
+    return netdev->tap_fd;
+}
+
 /* Returns the maximum size of transmitted (and received) packets on 'netdev',
  * in bytes, not including the hardware header; thus, this is typically 1500
  * bytes for Ethernet devices. */
@@ -1332,7 +1514,9 @@ netdev_nodev_get_flags(const char *netdev_name, enum netdev_flags *flagsp)
     if (flags & IFF_PROMISC) {
         *flagsp |= NETDEV_PROMISC;
     }
-    if (flags & IFF_LOWER_UP) {
+    /* IFF_LOWER_UP does not fit the flags reported by SIOCGIFFLAGS, but
+     * IFF_RUNNING reflects the operational state, which follows the carrier. */
+    if (flags & (IFF_LOWER_UP | IFF_RUNNING)) {
         *flagsp |= NETDEV_CARRIER;
     }
     return 0;
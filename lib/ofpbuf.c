@@ -55,6 +55,7 @@ ofpbuf_use(struct ofpbuf *b, void *base, size_t allocated)
     b->l2 = b->l3 = b->l4 = b->l7 = NULL;
     b->next = NULL;
     b->private_p = NULL;
+    b->refcount = NULL;
 }
 
 /* Initializes 'b' as an empty ofpbuf with an initial capacity of 'size'
@@ -65,11 +66,17 @@ ofpbuf_init(struct ofpbuf *b, size_t size)
     ofpbuf_use(b, size ? xmalloc(size) : NULL, size);
 }
 
-/* Frees memory that 'b' points to. */
+/* Frees memory that 'b' points to, unless other ofpbufs still share it. */
 void
 ofpbuf_uninit(struct ofpbuf *b)
 {
     if (b) {
+        if (b->refcount) {
+            if (--*b->refcount > 0) {
+                return;
+            }
+            free(b->refcount);
+        }
         free(b->base);
     }
 }
@@ -126,6 +133,27 @@ ofpbuf_clone_data(const void *data, size_t size)
     return b;
 }
 
+/* Creates and returns a new ofpbuf which shares the data of 'b', without
+ * copying it.  The data may no longer be modified or expanded through either
+ * of them, and is freed with the last ofpbuf sharing it.  Reference counts are
+ * not atomic, so the ofpbufs must be used by a single thread. */
+struct ofpbuf *
+ofpbuf_share(struct ofpbuf *b)
+{
+    struct ofpbuf *share = xmalloc(sizeof *share);
+
+    if (!b->refcount) {
+        b->refcount = xmalloc(sizeof *b->refcount);
+        *b->refcount = 1;
+    }
+    ++*b->refcount;
+
+    *share = *b;
+    share->next = NULL;
+    share->private_p = NULL;
+    return share;
+}
+
 /* Frees memory that 'b' points to, as well as 'b' itself. */
 void
 ofpbuf_delete(struct ofpbuf *b) 
@@ -182,6 +210,7 @@ ofpbuf_rebase__(struct ofpbuf *b, void *new_base)
 static void
 ofpbuf_resize_tailroom__(struct ofpbuf *b, size_t new_tailroom)
 {
+    assert(!b->refcount);
     b->allocated = ofpbuf_headroom(b) + b->size + new_tailroom;
     ofpbuf_rebase__(b, xrealloc(b->base, b->allocated));
 }
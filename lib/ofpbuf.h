@@ -52,6 +52,8 @@ struct ofpbuf {
 
     struct ofpbuf *next;        /* Next in a list of ofpbufs. */
     void *private_p;            /* Private pointer for use by owner. */
+    unsigned int *refcount;     /* Number of ofpbufs sharing the memory at
+                                 * 'base', or NULL if it is not shared. */
 };
 
 void ofpbuf_use(struct ofpbuf *, void *, size_t);
@@ -66,6 +68,7 @@ struct ofpbuf *ofpbuf_clone(const struct ofpbuf *);
 struct ofpbuf *ofpbuf_clone_with_headroom(const struct ofpbuf *,
                                           size_t headroom);
 struct ofpbuf *ofpbuf_clone_data(const void *, size_t);
+struct ofpbuf *ofpbuf_share(struct ofpbuf *);
 void ofpbuf_delete(struct ofpbuf *);
 
 void *ofpbuf_at(const struct ofpbuf *, size_t offset, size_t size);
@@ -581,13 +581,34 @@ vconn_send(struct vconn *vconn, struct ofpbuf *msg)
     return retval;
 }
 
+/* Returns true if 'buf' holds one or more complete OpenFlow messages, back to
+ * back. */
+static bool
+is_msg_sequence(const struct ofpbuf *buf)
+{
+    size_t ofs = 0;
+
+    while (ofs + sizeof(struct ofp_header) <= buf->size) {
+        const struct ofp_header *oh = (const struct ofp_header *)
+                ((const uint8_t *) buf->data + ofs);
+        size_t length = ntohs(oh->length);
+
+        if (length < sizeof(struct ofp_header)) {
+            return false;
+        }
+        ofs += length;
+    }
+    return ofs == buf->size && ofs > 0;
+}
+
 static int
 do_send(struct vconn *vconn, struct ofpbuf *buf)
 {
     int retval;
 
+    /* A buffer may hold several messages, which are then written at once. */
     assert(buf->size >= sizeof(struct ofp_header));
-    assert(((struct ofp_header *) buf->data)->length == htons(buf->size));
+    assert(is_msg_sequence(buf));
     if (!VLOG_IS_DBG_ENABLED(LOG_MODULE)) {
         retval = (vconn->class->send)(vconn, buf);
     } else {
@@ -29,6 +29,7 @@
  * Author: Zoltán Lajos Kis <zoltan.lajos.kis@ericsson.com>
  */
 
+#include <inttypes.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -38,6 +39,7 @@
 #include "ofl-exp-openflow.h"
 #include "../oflib/ofl-log.h"
 #include "../oflib/ofl-print.h"
+#include "../oflib/ofl-utils.h"
 
 #define LOG_MODULE ofl_exp_of
 OFL_LOG_INIT(LOG_MODULE)
@@ -78,6 +80,50 @@ ofl_exp_openflow_msg_pack(struct ofl_msg_experimenter *msg, uint8_t **buf, size_
 
                 return 0;
             }
+            case (OFP_EXT_FLOW_CACHE_REQUEST):
+            case (OFP_EXT_PKTIN_RATE_REQUEST): {
+                struct ofp_extension_header *ofp;
+
+                *buf_len  = sizeof(struct ofp_extension_header);
+                *buf     = (uint8_t *)malloc(*buf_len);
+
+                ofp = (struct ofp_extension_header *)(*buf);
+                ofp->vendor  = htonl(exp->header.experimenter_id);
+                ofp->subtype = htonl(exp->type);
+
+                return 0;
+            }
+            case (OFP_EXT_FLOW_CACHE_REPLY): {
+                struct ofl_exp_openflow_msg_flow_cache *c = (struct ofl_exp_openflow_msg_flow_cache *)exp;
+                struct openflow_ext_flow_cache_stats *ofp;
+
+                *buf_len  = sizeof(struct openflow_ext_flow_cache_stats);
+                *buf     = (uint8_t *)malloc(*buf_len);
+
+                ofp = (struct openflow_ext_flow_cache_stats *)(*buf);
+                ofp->header.vendor  = htonl(exp->header.experimenter_id);
+                ofp->header.subtype = htonl(exp->type);
+                ofp->hits   = hton64(c->hits);
+                ofp->misses = hton64(c->misses);
+
+                return 0;
+            }
+            case (OFP_EXT_PKTIN_RATE_REPLY): {
+                struct ofl_exp_openflow_msg_pktin_rate *r = (struct ofl_exp_openflow_msg_pktin_rate *)exp;
+                struct openflow_ext_pktin_rate_stats *ofp;
+
+                *buf_len  = sizeof(struct openflow_ext_pktin_rate_stats);
+                *buf     = (uint8_t *)malloc(*buf_len);
+
+                ofp = (struct openflow_ext_pktin_rate_stats *)(*buf);
+                ofp->header.vendor  = htonl(exp->header.experimenter_id);
+                ofp->header.subtype = htonl(exp->type);
+                ofp->normal  = hton64(r->normal);
+                ofp->limited = hton64(r->limited);
+                ofp->dropped = hton64(r->dropped);
+
+                return 0;
+            }
             default: {
                 OFL_LOG_WARN(LOG_MODULE, "Trying to print unknown Openflow Experimenter message.");
                 return -1;
@@ -152,6 +198,62 @@ ofl_exp_openflow_msg_unpack(struct ofp_header *oh, size_t *len, struct ofl_msg_e
                 (*msg) = (struct ofl_msg_experimenter *)dst;
                 return 0;
             }
+            case (OFP_EXT_FLOW_CACHE_REQUEST):
+            case (OFP_EXT_PKTIN_RATE_REQUEST): {
+                struct ofl_exp_openflow_msg_header *dst;
+
+                *len -= sizeof(struct ofp_extension_header);
+
+                dst = (struct ofl_exp_openflow_msg_header *)malloc(sizeof(struct ofl_exp_openflow_msg_header));
+                dst->header.experimenter_id = ntohl(exp->vendor);
+                dst->type                   = ntohl(exp->subtype);
+
+                (*msg) = (struct ofl_msg_experimenter *)dst;
+                return 0;
+            }
+            case (OFP_EXT_FLOW_CACHE_REPLY): {
+                struct openflow_ext_flow_cache_stats *src;
+                struct ofl_exp_openflow_msg_flow_cache *dst;
+
+                if (*len < sizeof(struct openflow_ext_flow_cache_stats)) {
+                    OFL_LOG_WARN(LOG_MODULE, "Received EXT_FLOW_CACHE_REPLY message has invalid length (%zu).", *len);
+                    return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_LEN);
+                }
+                *len -= sizeof(struct openflow_ext_flow_cache_stats);
+
+                src = (struct openflow_ext_flow_cache_stats *)exp;
+
+                dst = (struct ofl_exp_openflow_msg_flow_cache *)malloc(sizeof(struct ofl_exp_openflow_msg_flow_cache));
+                dst->header.header.experimenter_id = ntohl(exp->vendor);
+                dst->header.type                   = ntohl(exp->subtype);
+                dst->hits                          = ntoh64(src->hits);
+                dst->misses                        = ntoh64(src->misses);
+
+                (*msg) = (struct ofl_msg_experimenter *)dst;
+                return 0;
+            }
+            case (OFP_EXT_PKTIN_RATE_REPLY): {
+                struct openflow_ext_pktin_rate_stats *src;
+                struct ofl_exp_openflow_msg_pktin_rate *dst;
+
+                if (*len < sizeof(struct openflow_ext_pktin_rate_stats)) {
+                    OFL_LOG_WARN(LOG_MODULE, "Received EXT_PKTIN_RATE_REPLY message has invalid length (%zu).", *len);
+                    return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_LEN);
+                }
+                *len -= sizeof(struct openflow_ext_pktin_rate_stats);
+
+                src = (struct openflow_ext_pktin_rate_stats *)exp;
+
+                dst = (struct ofl_exp_openflow_msg_pktin_rate *)malloc(sizeof(struct ofl_exp_openflow_msg_pktin_rate));
+                dst->header.header.experimenter_id = ntohl(exp->vendor);
+                dst->header.type                   = ntohl(exp->subtype);
+                dst->normal                        = ntoh64(src->normal);
+                dst->limited                       = ntoh64(src->limited);
+                dst->dropped                       = ntoh64(src->dropped);
+
+                (*msg) = (struct ofl_msg_experimenter *)dst;
+                return 0;
+            }
             default: {
                 OFL_LOG_WARN(LOG_MODULE, "Trying to unpack unknown Openflow Experimenter message.");
                 return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_EXPERIMENTER);
@@ -181,6 +283,12 @@ ofl_exp_openflow_msg_free(struct ofl_msg_experimenter *msg) {
                 free(s->dp_desc);
                 break;
             }
+            case (OFP_EXT_FLOW_CACHE_REQUEST):
+            case (OFP_EXT_FLOW_CACHE_REPLY):
+            case (OFP_EXT_PKTIN_RATE_REQUEST):
+            case (OFP_EXT_PKTIN_RATE_REPLY): {
+                break;
+            }
             default: {
                 OFL_LOG_WARN(LOG_MODULE, "Trying to free unknown Openflow Experimenter message.");
             }
@@ -216,6 +324,26 @@ ofl_exp_openflow_msg_to_string(struct ofl_msg_experimenter *msg) {
                 fprintf(stream, "setdesc{desc=\"%s\"}", s->dp_desc);
                 break;
             }
+            case (OFP_EXT_FLOW_CACHE_REQUEST): {
+                fprintf(stream, "flowcache_req");
+                break;
+            }
+            case (OFP_EXT_FLOW_CACHE_REPLY): {
+                struct ofl_exp_openflow_msg_flow_cache *c = (struct ofl_exp_openflow_msg_flow_cache *)exp;
+                fprintf(stream, "flowcache_repl{hits=\"%"PRIu64"\", misses=\"%"PRIu64"\"}",
+                        c->hits, c->misses);
+                break;
+            }
+            case (OFP_EXT_PKTIN_RATE_REQUEST): {
+                fprintf(stream, "pktinrate_req");
+                break;
+            }
+            case (OFP_EXT_PKTIN_RATE_REPLY): {
+                struct ofl_exp_openflow_msg_pktin_rate *r = (struct ofl_exp_openflow_msg_pktin_rate *)exp;
+                fprintf(stream, "pktinrate_repl{normal=\"%"PRIu64"\", limited=\"%"PRIu64"\", dropped=\"%"PRIu64"\"}",
+                        r->normal, r->limited, r->dropped);
+                break;
+            }
             default: {
                 OFL_LOG_WARN(LOG_MODULE, "Trying to print unknown Openflow Experimenter message.");
                 fprintf(stream, "ofexp{type=\"%u\"}", exp->type);
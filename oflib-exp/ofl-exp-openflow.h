@@ -57,6 +57,23 @@ struct ofl_exp_openflow_msg_set_dp_desc {
     char  *dp_desc;
 };
 
+/* The request is a plain ofl_exp_openflow_msg_header. */
+struct ofl_exp_openflow_msg_flow_cache {
+    struct ofl_exp_openflow_msg_header   header; /* OFP_EXT_FLOW_CACHE_REPLY */
+
+    uint64_t   hits;
+    uint64_t   misses;
+};
+
+/* The request is a plain ofl_exp_openflow_msg_header. */
+struct ofl_exp_openflow_msg_pktin_rate {
+    struct ofl_exp_openflow_msg_header   header; /* OFP_EXT_PKTIN_RATE_REPLY */
+
+    uint64_t   normal;
+    uint64_t   limited;
+    uint64_t   dropped;
+};
+
 
 
 int
@@ -34,6 +34,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "ofl.h"
+#include "ofl-arena.h"
 #include "ofl-utils.h"
 #include "ofl-actions.h"
 #include "ofl-structs.h"
@@ -88,7 +89,7 @@ ofl_actions_unpack(struct ofp_action_header *src, size_t *len, struct ofl_action
                 return ofl_error(OFPET_BAD_ACTION, OFPBAC_BAD_OUT_PORT);
             }
 
-            da = (struct ofl_action_output *)malloc(sizeof(struct ofl_action_output));
+            da = (struct ofl_action_output *)ofl_alloc(sizeof(struct ofl_action_output));
             da->port = ntohl(sa->port);
             da->max_len = ntohs(sa->max_len);
 
@@ -117,7 +118,7 @@ ofl_actions_unpack(struct ofp_action_header *src, size_t *len, struct ofl_action
                 return ofl_error(OFPET_BAD_ACTION, OFPBAC_BAD_ARGUMENT);
             }
 
-            da = (struct ofl_action_vlan_vid *)malloc(sizeof(struct ofl_action_vlan_vid));
+            da = (struct ofl_action_vlan_vid *)ofl_alloc(sizeof(struct ofl_action_vlan_vid));
             da->vlan_vid = ntohs(sa->vlan_vid);
 
             *len -= sizeof(struct ofp_action_vlan_vid);
@@ -141,7 +142,7 @@ ofl_actions_unpack(struct ofp_action_header *src, size_t *len, struct ofl_action
                 return ofl_error(OFPET_BAD_ACTION, OFPBAC_BAD_ARGUMENT);
             }
 
-            da = (struct ofl_action_vlan_pcp *)malloc(sizeof(struct ofl_action_vlan_pcp));
+            da = (struct ofl_action_vlan_pcp *)ofl_alloc(sizeof(struct ofl_action_vlan_pcp));
             da->vlan_pcp = sa->vlan_pcp;
 
             *len -= sizeof(struct ofp_action_vlan_pcp);
@@ -161,7 +162,7 @@ ofl_actions_unpack(struct ofp_action_header *src, size_t *len, struct ofl_action
 
             sa = (struct ofp_action_dl_addr *)src;
 
-            da = (struct ofl_action_dl_addr *)malloc(sizeof(struct ofl_action_dl_addr));
+            da = (struct ofl_action_dl_addr *)ofl_alloc(sizeof(struct ofl_action_dl_addr));
             memcpy(&(da->dl_addr), &(sa->dl_addr), OFP_ETH_ALEN);
 
             *len -= sizeof(struct ofp_action_dl_addr);
@@ -180,7 +181,7 @@ ofl_actions_unpack(struct ofp_action_header *src, size_t *len, struct ofl_action
 
             sa = (struct ofp_action_nw_addr *)src;
 
-            da = (struct ofl_action_nw_addr *)malloc(sizeof(struct ofl_action_nw_addr));
+            da = (struct ofl_action_nw_addr *)ofl_alloc(sizeof(struct ofl_action_nw_addr));
             da->nw_addr = sa->nw_addr;
 
             *len -= sizeof(struct ofp_action_nw_addr);
@@ -203,7 +204,7 @@ ofl_actions_unpack(struct ofp_action_header *src, size_t *len, struct ofl_action
                 return ofl_error(OFPET_BAD_ACTION, OFPBAC_BAD_ARGUMENT);
             }
 
-            da = (struct ofl_action_nw_tos *)malloc(sizeof(struct ofl_action_nw_tos));
+            da = (struct ofl_action_nw_tos *)ofl_alloc(sizeof(struct ofl_action_nw_tos));
             da->nw_tos = sa->nw_tos;
 
             *len -= sizeof(struct ofp_action_nw_tos);
@@ -227,7 +228,7 @@ ofl_actions_unpack(struct ofp_action_header *src, size_t *len, struct ofl_action
                 return ofl_error(OFPET_BAD_ACTION, OFPBAC_BAD_ARGUMENT);
             }
 
-            da = (struct ofl_action_nw_ecn *)malloc(sizeof(struct ofl_action_nw_ecn));
+            da = (struct ofl_action_nw_ecn *)ofl_alloc(sizeof(struct ofl_action_nw_ecn));
             da->nw_ecn = sa->nw_ecn;
 
             *len -= sizeof(struct ofp_action_nw_ecn);
@@ -247,7 +248,7 @@ ofl_actions_unpack(struct ofp_action_header *src, size_t *len, struct ofl_action
 
             sa = (struct ofp_action_tp_port *)src;
 
-            da = (struct ofl_action_tp_port *)malloc(sizeof(struct ofl_action_tp_port));
+            da = (struct ofl_action_tp_port *)ofl_alloc(sizeof(struct ofl_action_tp_port));
             da->tp_port = ntohs(sa->tp_port);
 
             *len -= sizeof(struct ofp_action_tp_port);
@@ -258,14 +259,14 @@ ofl_actions_unpack(struct ofp_action_header *src, size_t *len, struct ofl_action
         case OFPAT_COPY_TTL_OUT: {
             //ofp_action_header length was already checked
             *len -= sizeof(struct ofp_action_header);
-            *dst = (struct ofl_action_header *)malloc(sizeof(struct ofl_action_header));
+            *dst = (struct ofl_action_header *)ofl_alloc(sizeof(struct ofl_action_header));
             break;
         }
 
         case OFPAT_COPY_TTL_IN: {
             //ofp_action_header length was already checked
             *len -= sizeof(struct ofp_action_header);
-            *dst = (struct ofl_action_header *)malloc(sizeof(struct ofl_action_header));
+            *dst = (struct ofl_action_header *)ofl_alloc(sizeof(struct ofl_action_header));
             break;
         }
 
@@ -285,7 +286,7 @@ ofl_actions_unpack(struct ofp_action_header *src, size_t *len, struct ofl_action
                 return ofl_error(OFPET_BAD_ACTION, OFPBAC_BAD_ARGUMENT);
             }
 
-            da = (struct ofl_action_mpls_label *)malloc(sizeof(struct ofl_action_mpls_label));
+            da = (struct ofl_action_mpls_label *)ofl_alloc(sizeof(struct ofl_action_mpls_label));
             da->mpls_label = ntohl(sa->mpls_label);
 
             *len -= sizeof(struct ofp_action_mpls_label);
@@ -309,7 +310,7 @@ ofl_actions_unpack(struct ofp_action_header *src, size_t *len, struct ofl_action
                 return ofl_error(OFPET_BAD_ACTION, OFPBAC_BAD_ARGUMENT);
             }
 
-            da = (struct ofl_action_mpls_tc *)malloc(sizeof(struct ofl_action_mpls_tc));
+            da = (struct ofl_action_mpls_tc *)ofl_alloc(sizeof(struct ofl_action_mpls_tc));
             da->mpls_tc = sa->mpls_tc;
 
             *len -= sizeof(struct ofp_action_mpls_tc);
@@ -328,7 +329,7 @@ ofl_actions_unpack(struct ofp_action_header *src, size_t *len, struct ofl_action
 
             sa = (struct ofp_action_mpls_ttl *)src;
 
-            da = (struct ofl_action_mpls_ttl *)malloc(sizeof(struct ofl_action_mpls_ttl));
+            da = (struct ofl_action_mpls_ttl *)ofl_alloc(sizeof(struct ofl_action_mpls_ttl));
             da->mpls_ttl = sa->mpls_ttl;
 
             *len -= sizeof(struct ofp_action_mpls_ttl);
@@ -339,7 +340,7 @@ ofl_actions_unpack(struct ofp_action_header *src, size_t *len, struct ofl_action
         case OFPAT_DEC_MPLS_TTL: {
             //ofp_action_header length was already checked
             *len -= sizeof(struct ofp_action_mpls_ttl);
-            *dst = (struct ofl_action_header *)malloc(sizeof(struct ofl_action_header));
+            *dst = (struct ofl_action_header *)ofl_alloc(sizeof(struct ofl_action_header));
             break;
         }
 
@@ -365,7 +366,7 @@ ofl_actions_unpack(struct ofp_action_header *src, size_t *len, struct ofl_action
                 return ofl_error(OFPET_BAD_ACTION, OFPBAC_BAD_ARGUMENT);
             }
 
-            da = (struct ofl_action_push *)malloc(sizeof(struct ofl_action_push));
+            da = (struct ofl_action_push *)ofl_alloc(sizeof(struct ofl_action_push));
             da->ethertype = ntohs(sa->ethertype);
 
             *len -= sizeof(struct ofp_action_push);
@@ -376,7 +377,7 @@ ofl_actions_unpack(struct ofp_action_header *src, size_t *len, struct ofl_action
         case OFPAT_POP_VLAN: {
             //ofp_action_header length was already checked
             *len -= sizeof(struct ofp_action_header);
-            *dst = (struct ofl_action_header *)malloc(sizeof(struct ofl_action_header));
+            *dst = (struct ofl_action_header *)ofl_alloc(sizeof(struct ofl_action_header));
             break;
         }
 
@@ -391,7 +392,7 @@ ofl_actions_unpack(struct ofp_action_header *src, size_t *len, struct ofl_action
 
             sa = (struct ofp_action_pop_mpls *)src;
 
-            da = (struct ofl_action_pop_mpls *)malloc(sizeof(struct ofl_action_pop_mpls));
+            da = (struct ofl_action_pop_mpls *)ofl_alloc(sizeof(struct ofl_action_pop_mpls));
             da->ethertype = ntohs(sa->ethertype);
 
             *len -= sizeof(struct ofp_action_pop_mpls);
@@ -410,7 +411,7 @@ ofl_actions_unpack(struct ofp_action_header *src, size_t *len, struct ofl_action
 
             sa = (struct ofp_action_set_queue *)src;
 
-            da = (struct ofl_action_set_queue *)malloc(sizeof(struct ofl_action_set_queue));
+            da = (struct ofl_action_set_queue *)ofl_alloc(sizeof(struct ofl_action_set_queue));
             da->queue_id = ntohl(sa->queue_id);
 
             *len -= sizeof(struct ofp_action_set_queue);
@@ -438,7 +439,7 @@ ofl_actions_unpack(struct ofp_action_header *src, size_t *len, struct ofl_action
                 return ofl_error(OFPET_BAD_ACTION, OFPBAC_BAD_ARGUMENT);
             }
 
-            da = (struct ofl_action_group *)malloc(sizeof(struct ofl_action_group));
+            da = (struct ofl_action_group *)ofl_alloc(sizeof(struct ofl_action_group));
             da->group_id = ntohl(sa->group_id);
 
             *len -= sizeof(struct ofp_action_group);
@@ -457,7 +458,7 @@ ofl_actions_unpack(struct ofp_action_header *src, size_t *len, struct ofl_action
 
             sa = (struct ofp_action_nw_ttl *)src;
 
-            da = (struct ofl_action_set_nw_ttl *)malloc(sizeof(struct ofl_action_set_nw_ttl));
+            da = (struct ofl_action_set_nw_ttl *)ofl_alloc(sizeof(struct ofl_action_set_nw_ttl));
             da->nw_ttl = ntohs(sa->nw_ttl);
 
             *len -= sizeof(struct ofp_action_nw_ttl);
@@ -468,7 +469,7 @@ ofl_actions_unpack(struct ofp_action_header *src, size_t *len, struct ofl_action
         case OFPAT_DEC_NW_TTL: {
             //ofp_action_header length was already checked
             *len -= sizeof(struct ofp_action_header);
-            *dst = (struct ofl_action_header *)malloc(sizeof(struct ofl_action_header));
+            *dst = (struct ofl_action_header *)ofl_alloc(sizeof(struct ofl_action_header));
             break;
         }
 
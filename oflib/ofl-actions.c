@@ -33,6 +33,7 @@
 #include <string.h>
 #include <netinet/in.h>
 #include "ofl.h"
+#include "ofl-arena.h"
 #include "ofl-actions.h"
 #include "ofl-log.h"
 
@@ -80,7 +81,70 @@ ofl_actions_free(struct ofl_action_header *act, struct ofl_exp *exp) {
         default: {
         }
     }
-    free(act);
+    ofl_free(act);
+}
+
+/* Returns the size of the OFLib structure of a standard action. */
+static size_t
+ofl_actions_size(struct ofl_action_header *act) {
+    switch (act->type) {
+        case OFPAT_OUTPUT:         return sizeof(struct ofl_action_output);
+        case OFPAT_SET_VLAN_VID:   return sizeof(struct ofl_action_vlan_vid);
+        case OFPAT_SET_VLAN_PCP:   return sizeof(struct ofl_action_vlan_pcp);
+        case OFPAT_SET_DL_SRC:
+        case OFPAT_SET_DL_DST:     return sizeof(struct ofl_action_dl_addr);
+        case OFPAT_SET_NW_SRC:
+        case OFPAT_SET_NW_DST:     return sizeof(struct ofl_action_nw_addr);
+        case OFPAT_SET_NW_TOS:     return sizeof(struct ofl_action_nw_tos);
+        case OFPAT_SET_NW_ECN:     return sizeof(struct ofl_action_nw_ecn);
+        case OFPAT_SET_TP_SRC:
+        case OFPAT_SET_TP_DST:     return sizeof(struct ofl_action_tp_port);
+        case OFPAT_SET_MPLS_LABEL: return sizeof(struct ofl_action_mpls_label);
+        case OFPAT_SET_MPLS_TC:    return sizeof(struct ofl_action_mpls_tc);
+        case OFPAT_SET_MPLS_TTL:   return sizeof(struct ofl_action_mpls_ttl);
+        case OFPAT_PUSH_VLAN:
+        case OFPAT_PUSH_MPLS:      return sizeof(struct ofl_action_push);
+        case OFPAT_POP_MPLS:       return sizeof(struct ofl_action_pop_mpls);
+        case OFPAT_SET_QUEUE:      return sizeof(struct ofl_action_set_queue);
+        case OFPAT_GROUP:          return sizeof(struct ofl_action_group);
+        case OFPAT_SET_NW_TTL:     return sizeof(struct ofl_action_set_nw_ttl);
+        case OFPAT_COPY_TTL_OUT:
+        case OFPAT_COPY_TTL_IN:
+        case OFPAT_DEC_MPLS_TTL:
+        case OFPAT_POP_VLAN:
+        case OFPAT_DEC_NW_TTL:
+        case OFPAT_EXPERIMENTER:
+        default:                   return sizeof(struct ofl_action_header);
+    }
+}
+
+struct ofl_action_header *
+ofl_actions_clone(struct ofl_action_header *act, struct ofl_exp *exp) {
+    struct ofl_action_header *clone;
+
+    if (act->type == OFPAT_EXPERIMENTER) {
+        struct ofp_action_header *ofp;
+        size_t len;
+
+        if (exp == NULL || exp->act == NULL || exp->act->ofp_len == NULL ||
+            exp->act->pack == NULL || exp->act->unpack == NULL) {
+            OFL_LOG_WARN(LOG_MODULE, "Cloning experimenter action, but no callback is given.");
+            return NULL;
+        }
+        /* NOTE: experimenter actions are cloned through their wire format. */
+        len = exp->act->ofp_len(act);
+        ofp = (struct ofp_action_header *)malloc(len);
+        exp->act->pack(act, ofp);
+        if (exp->act->unpack(ofp, &len, &clone)) {
+            clone = NULL;
+        }
+        free(ofp);
+        return clone;
+    }
+
+    clone = (struct ofl_action_header *)malloc(ofl_actions_size(act));
+    memcpy(clone, act, ofl_actions_size(act));
+    return clone;
 }
 
 ofl_err
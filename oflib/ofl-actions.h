@@ -193,6 +193,17 @@ ofl_actions_free(struct ofl_action_header *act, struct ofl_exp *exp);
 
 
 
+/****************************************************************************
+ * Functions for cloning action structures
+ ****************************************************************************/
+
+/* Returns a copy of the action structure, allocated by malloc. In case of an
+ * experimenter action, it uses the passed in experimenter callback. */
+struct ofl_action_header *
+ofl_actions_clone(struct ofl_action_header *act, struct ofl_exp *exp);
+
+
+
 /****************************************************************************
  * Functions for freeing structures
  ****************************************************************************/
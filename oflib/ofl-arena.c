@@ -0,0 +1,159 @@
+/* Copyright (c) 2011, TrafficLab, Ericsson Research, Hungary
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Ericsson Research nor the names of its
+ *     contributors may be used to endorse or promote products derived from
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "ofl-arena.h"
+
+/* Allocations are aligned for any of the unpacked structures. */
+#define ARENA_ALIGN 16
+#define ARENA_ROUND(size) (((size) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+struct ofl_arena_chunk {
+    struct ofl_arena_chunk  *next;
+    size_t                   size;
+    size_t                   used;
+    uint8_t                 *data;
+};
+
+/* The arena attached to the thread; see ofl_arena_begin_unpack. */
+static __thread struct ofl_arena *current_arena = NULL;
+
+static struct ofl_arena_chunk *
+chunk_create(size_t size) {
+    struct ofl_arena_chunk *chunk;
+
+    chunk = (struct ofl_arena_chunk *)malloc(ARENA_ROUND(sizeof(struct ofl_arena_chunk)) + size);
+    chunk->next = NULL;
+    chunk->size = size;
+    chunk->used = 0;
+    chunk->data = (uint8_t *)chunk + ARENA_ROUND(sizeof(struct ofl_arena_chunk));
+    return chunk;
+}
+
+static inline bool
+chunk_owns(const struct ofl_arena_chunk *chunk, const void *p) {
+    const uint8_t *b = (const uint8_t *)p;
+
+    return b >= chunk->data && b < chunk->data + chunk->size;
+}
+
+static void *
+arena_alloc(struct ofl_arena *arena, size_t size) {
+    struct ofl_arena_chunk *chunk = arena->base;
+    void *p;
+
+    size = ARENA_ROUND(size);
+
+    if (chunk->size - chunk->used < size) {
+        chunk = arena->extra;
+        if (chunk == NULL || chunk->size - chunk->used < size) {
+            chunk = chunk_create(size > arena->base->size ? size : arena->base->size);
+            chunk->next  = arena->extra;
+            arena->extra = chunk;
+        }
+    }
+
+    p = chunk->data + chunk->used;
+    chunk->used += size;
+    return p;
+}
+
+void
+ofl_arena_init(struct ofl_arena *arena, size_t chunk_size) {
+    arena->base      = chunk_create(ARENA_ROUND(chunk_size));
+    arena->extra     = NULL;
+    arena->unpacking = false;
+}
+
+void
+ofl_arena_clear(struct ofl_arena *arena) {
+    struct ofl_arena_chunk *chunk, *next;
+
+    for (chunk = arena->extra; chunk != NULL; chunk = next) {
+        next = chunk->next;
+        free(chunk);
+    }
+    arena->extra      = NULL;
+    arena->base->used = 0;
+    arena->unpacking  = false;
+
+    if (current_arena == arena) {
+        current_arena = NULL;
+    }
+}
+
+void
+ofl_arena_destroy(struct ofl_arena *arena) {
+    ofl_arena_clear(arena);
+    free(arena->base);
+    arena->base = NULL;
+}
+
+void
+ofl_arena_begin_unpack(struct ofl_arena *arena) {
+    current_arena = arena;
+    arena->unpacking = true;
+}
+
+void
+ofl_arena_end_unpack(struct ofl_arena *arena) {
+    arena->unpacking = false;
+}
+
+bool
+ofl_arena_owns(const struct ofl_arena *arena, const void *p) {
+    struct ofl_arena_chunk *chunk;
+
+    if (chunk_owns(arena->base, p)) {
+        return true;
+    }
+    for (chunk = arena->extra; chunk != NULL; chunk = chunk->next) {
+        if (chunk_owns(chunk, p)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void *
+ofl_alloc(size_t size) {
+    if (current_arena != NULL && current_arena->unpacking) {
+        return arena_alloc(current_arena, size);
+    }
+    return malloc(size);
+}
+
+void
+ofl_free(void *p) {
+    if (current_arena != NULL && ofl_arena_owns(current_arena, p)) {
+        return;
+    }
+    free(p);
+}
@@ -0,0 +1,96 @@
+/* Copyright (c) 2011, TrafficLab, Ericsson Research, Hungary
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Ericsson Research nor the names of its
+ *     contributors may be used to endorse or promote products derived from
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef OFL_ARENA_H
+#define OFL_ARENA_H 1
+
+#include <stdbool.h>
+#include <stddef.h>
+
+
+/****************************************************************************
+ * Arena allocation of unpacked OFLib structures.
+ *
+ * Messages unpacked into an arena are allocated by bumping a pointer in the
+ * arena's chunks, and are all released at once when the arena is cleared.
+ * Until then the arena is attached to the thread that unpacked into it, and
+ * the OFLib free functions called on that thread skip any memory belonging to
+ * it; so arena messages can be handed to code which frees them as usual.
+ * Structures which have to outlive the arena must be cloned.
+ ****************************************************************************/
+
+struct ofl_arena_chunk;
+
+struct ofl_arena {
+    struct ofl_arena_chunk  *base;       /* chunk kept between clears. */
+    struct ofl_arena_chunk  *extra;      /* chunks allocated when the base
+                                          * chunk is exhausted. */
+    bool                     unpacking;  /* true while unpacking into the
+                                          * arena. */
+};
+
+/* Default size of the chunks of an arena. */
+#define OFL_ARENA_CHUNK_SIZE (64 * 1024)
+
+/* Initializes the arena with a base chunk of the given size. */
+void
+ofl_arena_init(struct ofl_arena *arena, size_t chunk_size);
+
+/* Releases everything allocated from the arena, and detaches it from the
+ * calling thread. The base chunk is kept for reuse. */
+void
+ofl_arena_clear(struct ofl_arena *arena);
+
+/* Clears the arena and frees its base chunk as well. */
+void
+ofl_arena_destroy(struct ofl_arena *arena);
+
+/* Attaches the arena to the calling thread, and directs allocations of
+ * unpacked structures to it until ofl_arena_end_unpack is called. */
+void
+ofl_arena_begin_unpack(struct ofl_arena *arena);
+
+void
+ofl_arena_end_unpack(struct ofl_arena *arena);
+
+/* Returns true if the memory pointed at by p belongs to the arena. */
+bool
+ofl_arena_owns(const struct ofl_arena *arena, const void *p);
+
+/* Allocates memory for an unpacked structure; from the arena attached to the
+ * thread while it is unpacking, and by malloc otherwise. */
+void *
+ofl_alloc(size_t size);
+
+/* Frees memory allocated by ofl_alloc. Memory of the arena attached to the
+ * thread is left to ofl_arena_clear. */
+void
+ofl_free(void *p);
+
+
+#endif /* OFL_ARENA_H */
@@ -50,31 +50,41 @@ OFL_LOG_INIT(LOG_MODULE)
  * Functions for packing ofl structures to ofp wire format.
  ****************************************************************************/
 
-static int
-ofl_msg_pack_error(struct ofl_msg_error *msg, uint8_t **buf, size_t *buf_len) {
-    struct ofp_error_msg *err;
+/* The messages below are packed in two steps: the length of the packed
+ * message is calculated first, then it is written to a buffer of that length.
+ * This lets ofl_msg_pack_to() pack them into buffers supplied by the caller. */
 
-    *buf_len = sizeof(struct ofp_error_msg) + msg->data_length;
-    *buf     = (uint8_t *)malloc(*buf_len);
+static void
+ofl_msg_write_error(struct ofl_msg_error *msg, uint8_t *buf) {
+    struct ofp_error_msg *err = (struct ofp_error_msg *)buf;
 
-    err = (struct ofp_error_msg *)(*buf);
     err->type = htons(msg->type);
     err->code = htons(msg->code);
     memcpy(err->data, msg->data, msg->data_length);
+}
+
+static int
+ofl_msg_pack_error(struct ofl_msg_error *msg, uint8_t **buf, size_t *buf_len) {
+    *buf_len = sizeof(struct ofp_error_msg) + msg->data_length;
+    *buf     = (uint8_t *)malloc(*buf_len);
+
+    ofl_msg_write_error(msg, *buf);
     return 0;
 }
 
+static void
+ofl_msg_write_echo(struct ofl_msg_echo *msg, uint8_t *buf) {
+    if (msg->data_length > 0) {
+        memcpy(buf + sizeof(struct ofp_header), msg->data, msg->data_length);
+    }
+}
+
 static int
 ofl_msg_pack_echo(struct ofl_msg_echo *msg, uint8_t **buf, size_t *buf_len) {
-    uint8_t *data;
-
     *buf_len = sizeof(struct ofp_header) + msg->data_length;
     *buf     = (uint8_t *)malloc(*buf_len);
 
-    if (msg->data_length > 0) {
-        data = (*buf) + sizeof(struct ofp_header);
-        memcpy(data, msg->data, msg->data_length);
-    }
+    ofl_msg_write_echo(msg, *buf);
     return 0;
 }
 
@@ -105,17 +115,20 @@ ofl_msg_pack_features_reply(struct ofl_msg_features_reply *msg, uint8_t **buf, s
     return 0;
 }
 
+static void
+ofl_msg_write_get_config_reply(struct ofl_msg_get_config_reply *msg, uint8_t *buf) {
+    struct ofp_switch_config *config = (struct ofp_switch_config *)buf;
+
+    config->flags         = htons(msg->config->flags);
+    config->miss_send_len = htons(msg->config->miss_send_len);
+}
+
 static int
 ofl_msg_pack_get_config_reply(struct ofl_msg_get_config_reply *msg, uint8_t **buf, size_t *buf_len) {
-    struct ofp_switch_config *config;
-
     *buf_len = sizeof(struct ofp_switch_config);
     *buf     = (uint8_t *)malloc(*buf_len);
 
-    config = (struct ofp_switch_config *)(*buf);
-    config->flags         = htons(msg->config->flags);
-    config->miss_send_len = htons(msg->config->miss_send_len);
-
+    ofl_msg_write_get_config_reply(msg, *buf);
     return 0;
 }
 
@@ -133,14 +146,10 @@ ofl_msg_pack_set_config(struct ofl_msg_set_config *msg, uint8_t **buf, size_t *b
     return 0;
 }
 
-static int
-ofl_msg_pack_packet_in(struct ofl_msg_packet_in *msg, uint8_t **buf, size_t *buf_len) {
-    struct ofp_packet_in *packet_in;
+static void
+ofl_msg_write_packet_in(struct ofl_msg_packet_in *msg, uint8_t *buf) {
+    struct ofp_packet_in *packet_in = (struct ofp_packet_in *)buf;
 
-    *buf_len = sizeof(struct ofp_packet_in) + msg->data_length;
-    *buf     = (uint8_t *)malloc(*buf_len);
-
-    packet_in = (struct ofp_packet_in *)(*buf);
     packet_in->buffer_id   = htonl(msg->buffer_id);
     packet_in->in_port     = htonl(msg->in_port);
     packet_in->in_phy_port = htonl(msg->in_phy_port);
@@ -151,18 +160,21 @@ ofl_msg_pack_packet_in(struct ofl_msg_packet_in *msg, uint8_t **buf, size_t *buf
     if (msg->data_length > 0) {
         memcpy(packet_in->data, msg->data, msg->data_length);
     }
-
-    return 0;
 }
 
 static int
-ofl_msg_pack_flow_removed(struct ofl_msg_flow_removed *msg, uint8_t **buf, size_t *buf_len, struct ofl_exp *exp) {
-    struct ofp_flow_removed *ofr;
-
-    *buf_len = sizeof(struct ofp_flow_removed);
+ofl_msg_pack_packet_in(struct ofl_msg_packet_in *msg, uint8_t **buf, size_t *buf_len) {
+    *buf_len = sizeof(struct ofp_packet_in) + msg->data_length;
     *buf     = (uint8_t *)malloc(*buf_len);
 
-    ofr = (struct ofp_flow_removed *)(*buf);
+    ofl_msg_write_packet_in(msg, *buf);
+    return 0;
+}
+
+static void
+ofl_msg_write_flow_removed(struct ofl_msg_flow_removed *msg, uint8_t *buf, struct ofl_exp *exp) {
+    struct ofp_flow_removed *ofr = (struct ofp_flow_removed *)buf;
+
     ofr->cookie        = hton64(msg->stats->cookie);
     ofr->priority      = hton64(msg->stats->priority);
     ofr->reason        =        msg->reason;
@@ -175,23 +187,33 @@ ofl_msg_pack_flow_removed(struct ofl_msg_flow_removed *msg, uint8_t **buf, size_
     ofr->byte_count    = hton64(msg->stats->byte_count);
 
     ofl_structs_match_pack(msg->stats->match, &(ofr->match), exp);
-
-    return 0;
 }
 
 static int
-ofl_msg_pack_port_status(struct ofl_msg_port_status *msg, uint8_t **buf, size_t *buf_len) {
-    struct ofp_port_status *status;
-
-    *buf_len = sizeof(struct ofp_port_status);
+ofl_msg_pack_flow_removed(struct ofl_msg_flow_removed *msg, uint8_t **buf, size_t *buf_len, struct ofl_exp *exp) {
+    *buf_len = sizeof(struct ofp_flow_removed);
     *buf     = (uint8_t *)malloc(*buf_len);
 
-    status = (struct ofp_port_status *)(*buf);
+    ofl_msg_write_flow_removed(msg, *buf, exp);
+    return 0;
+}
+
+static void
+ofl_msg_write_port_status(struct ofl_msg_port_status *msg, uint8_t *buf) {
+    struct ofp_port_status *status = (struct ofp_port_status *)buf;
+
     status->reason = msg->reason;
     memset(status->pad, 0x00, 7);
 
     ofl_structs_port_pack(msg->desc, &(status->desc));
+}
+
+static int
+ofl_msg_pack_port_status(struct ofl_msg_port_status *msg, uint8_t **buf, size_t *buf_len) {
+    *buf_len = sizeof(struct ofp_port_status);
+    *buf     = (uint8_t *)malloc(*buf_len);
 
+    ofl_msg_write_port_status(msg, *buf);
     return 0;
 }
 
@@ -860,3 +882,126 @@ ofl_msg_pack(struct ofl_msg_header *msg, uint32_t xid, uint8_t **buf, size_t *bu
 
     return 0;
 }
+
+size_t
+ofl_msg_pack_length(struct ofl_msg_header *msg, struct ofl_exp *exp UNUSED) {
+    switch (msg->type) {
+        case OFPT_HELLO:
+        case OFPT_FEATURES_REQUEST:
+        case OFPT_GET_CONFIG_REQUEST:
+        case OFPT_BARRIER_REQUEST:
+        case OFPT_BARRIER_REPLY: {
+            return sizeof(struct ofp_header);
+        }
+        case OFPT_ERROR: {
+            return sizeof(struct ofp_error_msg) + ((struct ofl_msg_error *)msg)->data_length;
+        }
+        case OFPT_ECHO_REQUEST:
+        case OFPT_ECHO_REPLY: {
+            return sizeof(struct ofp_header) + ((struct ofl_msg_echo *)msg)->data_length;
+        }
+        case OFPT_GET_CONFIG_REPLY: {
+            return sizeof(struct ofp_switch_config);
+        }
+        case OFPT_PACKET_IN: {
+            return sizeof(struct ofp_packet_in) + ((struct ofl_msg_packet_in *)msg)->data_length;
+        }
+        case OFPT_FLOW_REMOVED: {
+            /* experimenter matches are packed by callbacks. */
+            if (((struct ofl_msg_flow_removed *)msg)->stats->match->type != OFPMT_STANDARD) {
+                return 0;
+            }
+            return sizeof(struct ofp_flow_removed);
+        }
+        case OFPT_PORT_STATUS: {
+            return sizeof(struct ofp_port_status);
+        }
+        /* variable length, or experimenter messages. */
+        case OFPT_EXPERIMENTER:
+        case OFPT_FEATURES_REPLY:
+        case OFPT_SET_CONFIG:
+        case OFPT_PACKET_OUT:
+        case OFPT_FLOW_MOD:
+        case OFPT_GROUP_MOD:
+        case OFPT_PORT_MOD:
+        case OFPT_TABLE_MOD:
+        case OFPT_STATS_REQUEST:
+        case OFPT_STATS_REPLY:
+        case OFPT_QUEUE_GET_CONFIG_REQUEST:
+        case OFPT_QUEUE_GET_CONFIG_REPLY:
+        default: {
+            return 0;
+        }
+    }
+}
+
+int
+ofl_msg_pack_to(struct ofl_msg_header *msg, uint32_t xid, uint8_t *buf, size_t buf_len, struct ofl_exp *exp) {
+    struct ofp_header *oh;
+
+    if (buf_len == 0 || buf_len != ofl_msg_pack_length(msg, exp)) {
+        OFL_LOG_WARN(LOG_MODULE, "Trying to pack message into a buffer of wrong length.");
+        return -1;
+    }
+
+    switch (msg->type) {
+        case OFPT_ERROR: {
+            ofl_msg_write_error((struct ofl_msg_error *)msg, buf);
+            break;
+        }
+        case OFPT_ECHO_REQUEST:
+        case OFPT_ECHO_REPLY: {
+            ofl_msg_write_echo((struct ofl_msg_echo *)msg, buf);
+            break;
+        }
+        case OFPT_GET_CONFIG_REPLY: {
+            ofl_msg_write_get_config_reply((struct ofl_msg_get_config_reply *)msg, buf);
+            break;
+        }
+        case OFPT_PACKET_IN: {
+            ofl_msg_write_packet_in((struct ofl_msg_packet_in *)msg, buf);
+            break;
+        }
+        case OFPT_FLOW_REMOVED: {
+            ofl_msg_write_flow_removed((struct ofl_msg_flow_removed *)msg, buf, exp);
+            break;
+        }
+        case OFPT_PORT_STATUS: {
+            ofl_msg_write_port_status((struct ofl_msg_port_status *)msg, buf);
+            break;
+        }
+        /* messages with only a header. */
+        case OFPT_HELLO:
+        case OFPT_FEATURES_REQUEST:
+        case OFPT_GET_CONFIG_REQUEST:
+        case OFPT_BARRIER_REQUEST:
+        case OFPT_BARRIER_REPLY: {
+            break;
+        }
+        /* rejected by ofl_msg_pack_length. */
+        case OFPT_EXPERIMENTER:
+        case OFPT_FEATURES_REPLY:
+        case OFPT_SET_CONFIG:
+        case OFPT_PACKET_OUT:
+        case OFPT_FLOW_MOD:
+        case OFPT_GROUP_MOD:
+        case OFPT_PORT_MOD:
+        case OFPT_TABLE_MOD:
+        case OFPT_STATS_REQUEST:
+        case OFPT_STATS_REPLY:
+        case OFPT_QUEUE_GET_CONFIG_REQUEST:
+        case OFPT_QUEUE_GET_CONFIG_REPLY:
+        default: {
+            break;
+        }
+    }
+
+    oh = (struct ofp_header *)buf;
+
+    oh->version =        OFP_VERSION;
+    oh->type    =        msg->type;
+    oh->length  = htons(buf_len);
+    oh->xid     = htonl(xid);
+
+    return 0;
+}
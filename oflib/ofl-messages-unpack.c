@@ -33,6 +33,7 @@
 #include <string.h>
 #include <netinet/in.h>
 #include <endian.h>
+#include "ofl-arena.h"
 #include "ofl-actions.h"
 #include "ofl-messages.h"
 #include "ofl-structs.h"
@@ -64,12 +65,12 @@ ofl_msg_unpack_error(struct ofp_header *src, size_t *len, struct ofl_msg_header
 
     se = (struct ofp_error_msg *)src;
 
-    de = (struct ofl_msg_error *)malloc(sizeof(struct ofl_msg_error));
+    de = (struct ofl_msg_error *)ofl_alloc(sizeof(struct ofl_msg_error));
 
     de->type = (enum ofp_error_type)ntohs(se->type);
     de->code = ntohs(se->code);
     de->data_length = *len;
-    de->data = *len > 0 ? (uint8_t *)memcpy(malloc(*len), se->data, *len) : NULL;
+    de->data = *len > 0 ? (uint8_t *)memcpy(ofl_alloc(*len), se->data, *len) : NULL;
     *len = 0;
 
     (*msg) = (struct ofl_msg_header *)de;
@@ -79,7 +80,7 @@ ofl_msg_unpack_error(struct ofp_header *src, size_t *len, struct ofl_msg_header
 
 static ofl_err
 ofl_msg_unpack_echo(struct ofp_header *src, size_t *len, struct ofl_msg_header **msg) {
-    struct ofl_msg_echo *e = (struct ofl_msg_echo *)malloc(sizeof(struct ofl_msg_echo));
+    struct ofl_msg_echo *e = (struct ofl_msg_echo *)ofl_alloc(sizeof(struct ofl_msg_echo));
     uint8_t *data;
 
     // ofp_header length was checked at ofl_msg_unpack
@@ -87,7 +88,7 @@ ofl_msg_unpack_echo(struct ofp_header *src, size_t *len, struct ofl_msg_header *
 
     data = (uint8_t *)src + sizeof(struct ofp_header);
     e->data_length = *len;
-    e->data = *len > 0 ? (uint8_t *)memcpy(malloc(*len), data, *len) : NULL;
+    e->data = *len > 0 ? (uint8_t *)memcpy(ofl_alloc(*len), data, *len) : NULL;
     *len = 0;
 
     *msg = (struct ofl_msg_header *)e;
@@ -110,7 +111,7 @@ ofl_msg_unpack_features_reply(struct ofp_header *src, size_t *len, struct ofl_ms
     *len -= sizeof(struct ofp_switch_features);
 
     sr = (struct ofp_switch_features *)src;
-    dr = (struct ofl_msg_features_reply *)malloc(sizeof(struct ofl_msg_features_reply));
+    dr = (struct ofl_msg_features_reply *)ofl_alloc(sizeof(struct ofl_msg_features_reply));
 
     dr->datapath_id  = ntoh64(sr->datapath_id);
     dr->n_buffers    = ntohl( sr->n_buffers);
@@ -119,18 +120,18 @@ ofl_msg_unpack_features_reply(struct ofp_header *src, size_t *len, struct ofl_ms
 
     error = ofl_utils_count_ofp_ports(&(sr->ports), *len, &dr->ports_num);
     if (error) {
-        free(dr);
+        ofl_free(dr);
         return error;
     }
 
-    dr->ports = (struct ofl_port **)malloc(dr->ports_num * sizeof(struct ofl_port *));
+    dr->ports = (struct ofl_port **)ofl_alloc(dr->ports_num * sizeof(struct ofl_port *));
 
     port = sr->ports;
     for (i = 0; i < dr->ports_num; i++) {
         error = ofl_structs_port_unpack(port, len, &(dr->ports[i]));
         if (error) {
             OFL_UTILS_FREE_ARR(dr->ports, i);
-            free(dr);
+            ofl_free(dr);
             return error;
         }
         port = (struct ofp_port *)((uint8_t *)port + sizeof(struct ofp_port));
@@ -153,9 +154,9 @@ ofl_msg_unpack_get_config_reply(struct ofp_header *src, size_t *len, struct ofl_
     *len -= sizeof(struct ofp_switch_config);
 
     sr = (struct ofp_switch_config *)src;
-    dr = (struct ofl_msg_get_config_reply *)malloc(sizeof(struct ofl_msg_get_config_reply));
+    dr = (struct ofl_msg_get_config_reply *)ofl_alloc(sizeof(struct ofl_msg_get_config_reply));
 
-    dr->config = (struct ofl_config *)malloc(sizeof(struct ofl_config));
+    dr->config = (struct ofl_config *)ofl_alloc(sizeof(struct ofl_config));
     dr->config->miss_send_len = ntohs(sr->miss_send_len);
     dr->config->flags = ntohs(sr->flags);
 
@@ -175,9 +176,9 @@ ofl_msg_unpack_set_config(struct ofp_header *src, size_t *len, struct ofl_msg_he
      *len -= sizeof(struct ofp_switch_config);
 
      sr = (struct ofp_switch_config *)src;
-     dr = (struct ofl_msg_set_config *)malloc(sizeof(struct ofl_msg_set_config));
+     dr = (struct ofl_msg_set_config *)ofl_alloc(sizeof(struct ofl_msg_set_config));
 
-     dr->config = (struct ofl_config *)malloc(sizeof(struct ofl_config));
+     dr->config = (struct ofl_config *)ofl_alloc(sizeof(struct ofl_config));
      // TODO Zoltan: validate flags
      dr->config->miss_send_len = ntohs(sr->miss_send_len);
      dr->config->flags = ntohs(sr->flags);
@@ -219,7 +220,7 @@ ofl_msg_unpack_packet_in(struct ofp_header *src, size_t *len, struct ofl_msg_hea
     }
     *len -= sizeof(struct ofp_packet_in);
 
-    dp = (struct ofl_msg_packet_in *)malloc(sizeof(struct ofl_msg_packet_in));
+    dp = (struct ofl_msg_packet_in *)ofl_alloc(sizeof(struct ofl_msg_packet_in));
 
     dp->buffer_id = ntohl(sp->buffer_id);
     dp->in_port = ntohl(sp->in_port);
@@ -229,7 +230,7 @@ ofl_msg_unpack_packet_in(struct ofp_header *src, size_t *len, struct ofl_msg_hea
     dp->table_id = sp->table_id;
 
     dp->data_length = *len;
-    dp->data = *len > 0 ? (uint8_t *)memcpy(malloc(*len), sp->data, *len) : NULL;
+    dp->data = *len > 0 ? (uint8_t *)memcpy(ofl_alloc(*len), sp->data, *len) : NULL;
     *len = 0;
 
     *msg = (struct ofl_msg_header *)dp;
@@ -260,10 +261,10 @@ ofl_msg_unpack_flow_removed(struct ofp_header *src, size_t *len, struct ofl_msg_
     }
     *len -= (sizeof(struct ofp_flow_removed) - sizeof(struct ofp_match));
 
-    dr = (struct ofl_msg_flow_removed *)malloc(sizeof(struct ofl_msg_flow_removed));
+    dr = (struct ofl_msg_flow_removed *)ofl_alloc(sizeof(struct ofl_msg_flow_removed));
     dr->reason = (enum ofp_flow_removed_reason)sr->reason;
 
-    dr->stats = (struct ofl_flow_stats *)malloc(sizeof(struct ofl_flow_stats));
+    dr->stats = (struct ofl_flow_stats *)ofl_alloc(sizeof(struct ofl_flow_stats));
     dr->stats->table_id         =        sr->table_id;
     dr->stats->duration_sec     = ntohl( sr->duration_sec);
     dr->stats->duration_nsec    = ntohl( sr->duration_nsec);
@@ -278,8 +279,8 @@ ofl_msg_unpack_flow_removed(struct ofp_header *src, size_t *len, struct ofl_msg_
 
     error = ofl_structs_match_unpack(&(sr->match), len, &(dr->stats->match), exp);
     if (error) {
-        free(dr->stats);
-        free(dr);
+        ofl_free(dr->stats);
+        ofl_free(dr);
         return error;
     }
 
@@ -300,13 +301,13 @@ ofl_msg_unpack_port_status(struct ofp_header *src, size_t *len, struct ofl_msg_h
     *len -= (sizeof(struct ofp_port_status) - sizeof(struct ofp_port));
 
     ss = (struct ofp_port_status *)src;
-    ds = (struct ofl_msg_port_status *)malloc(sizeof(struct ofl_msg_port_status));
+    ds = (struct ofl_msg_port_status *)ofl_alloc(sizeof(struct ofl_msg_port_status));
 
     ds->reason = ss->reason;
 
     error = ofl_structs_port_unpack(&(ss->desc), len, &(ds->desc));
     if (error) {
-        free(ds);
+        ofl_free(ds);
         return error;
     }
 
@@ -351,24 +352,24 @@ ofl_msg_unpack_packet_out(struct ofp_header *src, size_t *len, struct ofl_msg_he
     }
     *len -= sizeof(struct ofp_packet_out);
 
-    dp = (struct ofl_msg_packet_out *)malloc(sizeof(struct ofl_msg_packet_out));
+    dp = (struct ofl_msg_packet_out *)ofl_alloc(sizeof(struct ofl_msg_packet_out));
 
     dp->buffer_id = ntohl(sp->buffer_id);
     dp->in_port = ntohl(sp->in_port);
 
     if (*len < ntohs(sp->actions_len)) {
         OFL_LOG_WARN(LOG_MODULE, "Received PACKET_OUT message has invalid action length (%zu).", *len);
-        free(dp);
+        ofl_free(dp);
         return ofl_error(OFPET_BAD_ACTION, OFPBRC_BAD_LEN);
     }
 
     error = ofl_utils_count_ofp_actions(&(sp->actions), ntohs(sp->actions_len), &actions_num);
     if (error) {
-        free(dp);
+        ofl_free(dp);
         return error;
     }
     dp->actions_num = actions_num;
-    dp->actions = (struct ofl_action_header **)malloc(dp->actions_num * sizeof(struct ofp_action_header *));
+    dp->actions = (struct ofl_action_header **)ofl_alloc(dp->actions_num * sizeof(struct ofp_action_header *));
 
     // TODO Zoltan: Output actions can contain OFPP_TABLE
     act = sp->actions;
@@ -377,14 +378,14 @@ ofl_msg_unpack_packet_out(struct ofp_header *src, size_t *len, struct ofl_msg_he
         if (error) {
             OFL_UTILS_FREE_ARR_FUN2(dp->actions, i,
                                     ofl_actions_free, exp);
-            free(dp);
+            ofl_free(dp);
         }
         act = (struct ofp_action_header *)((uint8_t *)act + ntohs(act->len));
     }
 
     data = ((uint8_t *)sp->actions) + ntohs(sp->actions_len);
     dp->data_length = *len;
-    dp->data = *len > 0 ? (uint8_t *)memcpy(malloc(*len), data, *len) : NULL;
+    dp->data = *len > 0 ? (uint8_t *)memcpy(ofl_alloc(*len), data, *len) : NULL;
     *len = 0;
 
     *msg = (struct ofl_msg_header *)dp;
@@ -407,7 +408,7 @@ ofl_msg_unpack_flow_mod(struct ofp_header *src, size_t *len, struct ofl_msg_head
     *len -= (sizeof(struct ofp_flow_mod) - sizeof(struct ofp_match));
 
     sm = (struct ofp_flow_mod *)src;
-    dm = (struct ofl_msg_flow_mod *)malloc(sizeof(struct ofl_msg_flow_mod));
+    dm = (struct ofl_msg_flow_mod *)ofl_alloc(sizeof(struct ofl_msg_flow_mod));
 
     dm->cookie =       ntoh64(sm->cookie);
     dm->cookie_mask =  ntoh64(sm->cookie_mask);
@@ -424,18 +425,18 @@ ofl_msg_unpack_flow_mod(struct ofp_header *src, size_t *len, struct ofl_msg_head
     error = ofl_structs_match_unpack(&(sm->match), len, &(dm->match), exp);
 
     if (error) {
-        free(dm);
+        ofl_free(dm);
         return error;
     }
 
     error = ofl_utils_count_ofp_instructions(&(sm->instructions), *len, &dm->instructions_num);
     if (error) {
         ofl_structs_free_match(dm->match, exp);
-        free(dm);
+        ofl_free(dm);
         return error;
     }
 
-    dm->instructions = (struct ofl_instruction_header **)malloc(dm->instructions_num * sizeof(struct ofl_instruction_header *));
+    dm->instructions = (struct ofl_instruction_header **)ofl_alloc(dm->instructions_num * sizeof(struct ofl_instruction_header *));
     inst = sm->instructions;
     for (i = 0; i < dm->instructions_num; i++) {
         error = ofl_structs_instructions_unpack(inst, len, &(dm->instructions[i]), exp);
@@ -443,7 +444,7 @@ ofl_msg_unpack_flow_mod(struct ofp_header *src, size_t *len, struct ofl_msg_head
             OFL_UTILS_FREE_ARR_FUN2(dm->instructions, i,
                     ofl_structs_free_instruction, exp);
             ofl_structs_free_match(dm->match, exp);
-            free(dm);
+            ofl_free(dm);
             return error;
         }
         inst = (struct ofp_instruction *)((uint8_t *)inst + ntohs(inst->len));
@@ -489,7 +490,7 @@ ofl_msg_unpack_group_mod(struct ofp_header *src, size_t *len, struct ofl_msg_hea
         return ofl_error(OFPET_GROUP_MOD_FAILED, OFPGMFC_INVALID_GROUP);
     }
 
-    dm = (struct ofl_msg_group_mod *)malloc(sizeof(struct ofl_msg_group_mod));
+    dm = (struct ofl_msg_group_mod *)ofl_alloc(sizeof(struct ofl_msg_group_mod));
 
     dm->command = (enum ofp_group_mod_command)ntohs(sm->command);
     dm->type = sm->type;
@@ -497,23 +498,23 @@ ofl_msg_unpack_group_mod(struct ofp_header *src, size_t *len, struct ofl_msg_hea
 
     error = ofl_utils_count_ofp_buckets(&(sm->buckets), *len, &dm->buckets_num);
     if (error) {
-        free(dm);
+        ofl_free(dm);
         return error;
     }
 
     if (dm->command == OFPGC_DELETE && dm->buckets_num > 0) {
         OFL_LOG_WARN(LOG_MODULE, "Received DELETE group command with buckets (%zu).", dm->buckets_num);
-        free(dm);
+        ofl_free(dm);
         return ofl_error(OFPET_GROUP_MOD_FAILED, OFPGMFC_INVALID_GROUP);
     }
 
     if (dm->type == OFPGT_INDIRECT && dm->buckets_num != 1) {
         OFL_LOG_WARN(LOG_MODULE, "Received INDIRECT group doesn't have exactly one bucket (%zu).", dm->buckets_num);
-        free(dm);
+        ofl_free(dm);
         return ofl_error(OFPET_GROUP_MOD_FAILED, OFPGMFC_INVALID_GROUP);
     }
 
-    dm->buckets = (struct ofl_bucket **)malloc(dm->buckets_num * sizeof(struct ofl_bucket *));
+    dm->buckets = (struct ofl_bucket **)ofl_alloc(dm->buckets_num * sizeof(struct ofl_bucket *));
 
     bucket = sm->buckets;
     for (i = 0; i < dm->buckets_num; i++) {
@@ -521,7 +522,7 @@ ofl_msg_unpack_group_mod(struct ofp_header *src, size_t *len, struct ofl_msg_hea
         if (error) {
             OFL_UTILS_FREE_ARR_FUN2(dm->buckets, i,
                                     ofl_structs_free_bucket, exp);
-            free(dm);
+            ofl_free(dm);
             return error;
         }
         bucket = (struct ofp_bucket *)((uint8_t *)bucket + ntohs(bucket->len));
@@ -553,7 +554,7 @@ ofl_msg_unpack_port_mod(struct ofp_header *src, size_t *len, struct ofl_msg_head
     }
     *len -= sizeof(struct ofp_port_mod);
 
-    dm = (struct ofl_msg_port_mod *)malloc(sizeof(struct ofl_msg_port_mod));
+    dm = (struct ofl_msg_port_mod *)ofl_alloc(sizeof(struct ofl_msg_port_mod));
 
     dm->port_no =   ntohl(sm->port_no);
     memcpy(dm->hw_addr, sm->hw_addr, OFP_ETH_ALEN);
@@ -577,7 +578,7 @@ ofl_msg_unpack_table_mod(struct ofp_header *src, size_t *len, struct ofl_msg_hea
     *len -= sizeof(struct ofp_table_mod);
 
     sm = (struct ofp_table_mod *)src;
-    dm = (struct ofl_msg_table_mod *)malloc(sizeof(struct ofl_msg_table_mod));
+    dm = (struct ofl_msg_table_mod *)ofl_alloc(sizeof(struct ofl_msg_table_mod));
 
     dm->table_id = sm->table_id;
     dm->config = ntohl(sm->config);
@@ -601,7 +602,7 @@ ofl_msg_unpack_stats_request_flow(struct ofp_stats_request *os, size_t *len, str
     *len -= (sizeof(struct ofp_flow_stats_request) - sizeof(struct ofp_match));
 
     sm = (struct ofp_flow_stats_request *)os->body;
-    dm = (struct ofl_msg_stats_request_flow *)malloc(sizeof(struct ofl_msg_stats_request_flow));
+    dm = (struct ofl_msg_stats_request_flow *)ofl_alloc(sizeof(struct ofl_msg_stats_request_flow));
 
     dm->table_id = sm->table_id;
     dm->out_port = ntohl(sm->out_port);
@@ -611,7 +612,7 @@ ofl_msg_unpack_stats_request_flow(struct ofp_stats_request *os, size_t *len, str
 
     error = ofl_structs_match_unpack(&(sm->match), len, &(dm->match), exp);
     if (error) {
-        free(dm);
+        ofl_free(dm);
         return error;
     }
 
@@ -641,7 +642,7 @@ ofl_msg_unpack_stats_request_port(struct ofp_stats_request *os, size_t *len, str
 
     *len -= sizeof(struct ofp_port_stats_request);
 
-    dm = (struct ofl_msg_stats_request_port *)malloc(sizeof(struct ofl_msg_stats_request_port));
+    dm = (struct ofl_msg_stats_request_port *)ofl_alloc(sizeof(struct ofl_msg_stats_request_port));
 
     dm->port_no = ntohl(sm->port_no);
 
@@ -670,7 +671,7 @@ ofl_msg_unpack_stats_request_queue(struct ofp_stats_request *os, size_t *len, st
     }
     *len -= sizeof(struct ofp_queue_stats_request);
 
-    dm = (struct ofl_msg_stats_request_queue *)malloc(sizeof(struct ofl_msg_stats_request_queue));
+    dm = (struct ofl_msg_stats_request_queue *)ofl_alloc(sizeof(struct ofl_msg_stats_request_queue));
 
     dm->port_no = ntohl(sm->port_no);
     dm->queue_id = ntohl(sm->queue_id);
@@ -693,7 +694,7 @@ ofl_msg_unpack_stats_request_group(struct ofp_stats_request *os, size_t *len, st
     *len -= sizeof(struct ofp_group_stats_request);
 
     sm = (struct ofp_group_stats_request *)os->body;
-    dm = (struct ofl_msg_stats_request_group *)malloc(sizeof(struct ofl_msg_stats_request_group));
+    dm = (struct ofl_msg_stats_request_group *)ofl_alloc(sizeof(struct ofl_msg_stats_request_group));
 
     dm->group_id = ntohl(sm->group_id);
 
@@ -707,7 +708,7 @@ ofl_msg_unpack_stats_request_empty(struct ofp_stats_request *os UNUSED, size_t *
     // ofp_stats_request length was checked at ofl_msg_unpack_stats_request
     len -= sizeof(struct ofp_stats_request);
 
-    *msg = (struct ofl_msg_header *)malloc(sizeof(struct ofl_msg_stats_request_header));
+    *msg = (struct ofl_msg_header *)ofl_alloc(sizeof(struct ofl_msg_stats_request_header));
     return 0;
 }
 
@@ -792,13 +793,13 @@ ofl_msg_unpack_stats_reply_desc(struct ofp_stats_reply *os, size_t *len, struct
     *len -= sizeof(struct ofp_desc_stats);
 
     sm = (struct ofp_desc_stats *)os->body;
-    dm = (struct ofl_msg_stats_reply_desc *)malloc(sizeof(struct ofl_msg_stats_reply_desc));
+    dm = (struct ofl_msg_stats_reply_desc *)ofl_alloc(sizeof(struct ofl_msg_stats_reply_desc));
 
-    dm->mfr_desc =   (char *)strcpy((char *)malloc(strlen(sm->mfr_desc) + 1), sm->mfr_desc);
-    dm->hw_desc =    (char *)strcpy((char *)malloc(strlen(sm->hw_desc) + 1), sm->hw_desc);
-    dm->sw_desc =    (char *)strcpy((char *)malloc(strlen(sm->sw_desc) + 1), sm->sw_desc);
-    dm->serial_num = (char *)strcpy((char *)malloc(strlen(sm->serial_num) + 1), sm->serial_num);
-    dm->dp_desc =    (char *)strcpy((char *)malloc(strlen(sm->dp_desc) + 1), sm->dp_desc);
+    dm->mfr_desc =   (char *)strcpy((char *)ofl_alloc(strlen(sm->mfr_desc) + 1), sm->mfr_desc);
+    dm->hw_desc =    (char *)strcpy((char *)ofl_alloc(strlen(sm->hw_desc) + 1), sm->hw_desc);
+    dm->sw_desc =    (char *)strcpy((char *)ofl_alloc(strlen(sm->sw_desc) + 1), sm->sw_desc);
+    dm->serial_num = (char *)strcpy((char *)ofl_alloc(strlen(sm->serial_num) + 1), sm->serial_num);
+    dm->dp_desc =    (char *)strcpy((char *)ofl_alloc(strlen(sm->dp_desc) + 1), sm->dp_desc);
 
     *msg = (struct ofl_msg_header *)dm;
     return 0;
@@ -815,14 +816,14 @@ ofl_msg_unpack_stats_reply_flow(struct ofp_stats_reply *os, size_t *len, struct
     // ofp_stats_reply was already checked and subtracted in unpack_stats_reply
 
     stat = (struct ofp_flow_stats *)os->body;
-    dm = (struct ofl_msg_stats_reply_flow *)malloc(sizeof(struct ofl_msg_stats_reply_flow));
+    dm = (struct ofl_msg_stats_reply_flow *)ofl_alloc(sizeof(struct ofl_msg_stats_reply_flow));
 
     error = ofl_utils_count_ofp_flow_stats(stat, *len, &dm->stats_num);
     if (error) {
-        free(dm);
+        ofl_free(dm);
         return error;
     }
-    dm->stats = (struct ofl_flow_stats **)malloc(dm->stats_num * sizeof(struct ofl_flow_stats *));
+    dm->stats = (struct ofl_flow_stats **)ofl_alloc(dm->stats_num * sizeof(struct ofl_flow_stats *));
 
     for (i = 0; i < dm->stats_num; i++) {
         error = ofl_structs_flow_stats_unpack(stat, len, &(dm->stats[i]), exp);
@@ -853,7 +854,7 @@ ofl_msg_unpack_stats_reply_aggregate(struct ofp_stats_reply *os, size_t *len, st
     *len -= sizeof(struct ofp_aggregate_stats_reply);
 
     sm = (struct ofp_aggregate_stats_reply *)os->body;
-    dm = (struct ofl_msg_stats_reply_aggregate *)malloc(sizeof(struct ofl_msg_stats_reply_aggregate));
+    dm = (struct ofl_msg_stats_reply_aggregate *)ofl_alloc(sizeof(struct ofl_msg_stats_reply_aggregate));
 
     dm->packet_count = ntoh64(sm->packet_count);
     dm->byte_count =   ntoh64(sm->byte_count);
@@ -873,20 +874,20 @@ ofl_msg_unpack_stats_reply_table(struct ofp_stats_reply *os, size_t *len, struct
     // ofp_stats_reply was already checked and subtracted in unpack_stats_reply
 
     stat = (struct ofp_table_stats *)os->body;
-    dm = (struct ofl_msg_stats_reply_table *)malloc(sizeof(struct ofl_msg_stats_reply_table));
+    dm = (struct ofl_msg_stats_reply_table *)ofl_alloc(sizeof(struct ofl_msg_stats_reply_table));
 
     error = ofl_utils_count_ofp_table_stats(stat, *len, &dm->stats_num);
     if (error) {
-        free(dm);
+        ofl_free(dm);
         return error;
     }
-    dm->stats = (struct ofl_table_stats **)malloc(dm->stats_num * sizeof(struct ofl_table_stats *));
+    dm->stats = (struct ofl_table_stats **)ofl_alloc(dm->stats_num * sizeof(struct ofl_table_stats *));
 
     for (i = 0; i < dm->stats_num; i++) {
         error = ofl_structs_table_stats_unpack(stat, len, &(dm->stats[i]));
         if (error) {
             OFL_UTILS_FREE_ARR(dm->stats, i);
-            free(dm);
+            ofl_free(dm);
             return error;
         }
         stat = (struct ofp_table_stats *)((uint8_t *)stat + sizeof(struct ofp_table_stats));
@@ -899,28 +900,28 @@ ofl_msg_unpack_stats_reply_table(struct ofp_stats_reply *os, size_t *len, struct
 static ofl_err
 ofl_msg_unpack_stats_reply_port(struct ofp_stats_reply *os, size_t *len, struct ofl_msg_header **msg) {
     struct ofp_port_stats *stat = (struct ofp_port_stats *)os->body;
-    struct ofl_msg_stats_reply_port *dm = (struct ofl_msg_stats_reply_port *)malloc(sizeof(struct ofl_msg_stats_reply_port));
+    struct ofl_msg_stats_reply_port *dm = (struct ofl_msg_stats_reply_port *)ofl_alloc(sizeof(struct ofl_msg_stats_reply_port));
     ofl_err error;
     size_t i;
 
     // ofp_stats_reply was already checked and subtracted in unpack_stats_reply
 
     stat = (struct ofp_port_stats *)os->body;
-    dm = (struct ofl_msg_stats_reply_port *)malloc(sizeof(struct ofl_msg_stats_reply_port));
+    dm = (struct ofl_msg_stats_reply_port *)ofl_alloc(sizeof(struct ofl_msg_stats_reply_port));
 
     error = ofl_utils_count_ofp_port_stats(stat, *len, &dm->stats_num);
     if (error) {
-        free(dm);
+        ofl_free(dm);
         return error;
     }
 
-    dm->stats = (struct ofl_port_stats **)malloc(dm->stats_num * sizeof(struct ofl_port_stats *));
+    dm->stats = (struct ofl_port_stats **)ofl_alloc(dm->stats_num * sizeof(struct ofl_port_stats *));
 
     for (i = 0; i < dm->stats_num; i++) {
         error = ofl_structs_port_stats_unpack(stat, len, &(dm->stats[i]));
         if (error) {
             OFL_UTILS_FREE_ARR(dm->stats, i);
-            free(dm);
+            ofl_free(dm);
             return error;
         }
         stat = (struct ofp_port_stats *)((uint8_t *)stat + sizeof(struct ofp_port_stats));
@@ -933,27 +934,27 @@ ofl_msg_unpack_stats_reply_port(struct ofp_stats_reply *os, size_t *len, struct
 static ofl_err
 ofl_msg_unpack_stats_reply_queue(struct ofp_stats_reply *os, size_t *len, struct ofl_msg_header **msg) {
     struct ofp_queue_stats *stat = (struct ofp_queue_stats *)os->body;
-    struct ofl_msg_stats_reply_queue *dm = (struct ofl_msg_stats_reply_queue *)malloc(sizeof(struct ofl_msg_stats_reply_queue));
+    struct ofl_msg_stats_reply_queue *dm = (struct ofl_msg_stats_reply_queue *)ofl_alloc(sizeof(struct ofl_msg_stats_reply_queue));
     ofl_err error;
     size_t i;
 
     // ofp_stats_reply was already checked and subtracted in unpack_stats_reply
 
     stat = (struct ofp_queue_stats *)os->body;
-    dm = (struct ofl_msg_stats_reply_queue *)malloc(sizeof(struct ofl_msg_stats_reply_queue));
+    dm = (struct ofl_msg_stats_reply_queue *)ofl_alloc(sizeof(struct ofl_msg_stats_reply_queue));
 
     error = ofl_utils_count_ofp_queue_stats(stat, *len, &dm->stats_num);
     if (error) {
-        free(dm);
+        ofl_free(dm);
         return error;
     }
-    dm->stats = (struct ofl_queue_stats **)malloc(dm->stats_num * sizeof(struct ofl_queue_stats *));
+    dm->stats = (struct ofl_queue_stats **)ofl_alloc(dm->stats_num * sizeof(struct ofl_queue_stats *));
 
     for (i = 0; i < dm->stats_num; i++) {
         error = ofl_structs_queue_stats_unpack(stat, len, &(dm->stats[i]));
         if (error) {
             OFL_UTILS_FREE_ARR(dm->stats, i);
-            free(dm);
+            ofl_free(dm);
             return error;
         }
         stat = (struct ofp_queue_stats *)((uint8_t *)stat + sizeof(struct ofp_queue_stats));
@@ -973,14 +974,14 @@ ofl_msg_unpack_stats_reply_group(struct ofp_stats_reply *os, size_t *len, struct
     // ofp_stats_reply was already checked and subtracted in unpack_stats_reply
 
     stat = (struct ofp_group_stats *)os->body;
-    dm = (struct ofl_msg_stats_reply_group *)malloc(sizeof(struct ofl_msg_stats_reply_group));
+    dm = (struct ofl_msg_stats_reply_group *)ofl_alloc(sizeof(struct ofl_msg_stats_reply_group));
 
     error = ofl_utils_count_ofp_group_stats(stat, *len, &dm->stats_num);
     if (error) {
-        free(dm);
+        ofl_free(dm);
         return error;
     }
-    dm->stats = (struct ofl_group_stats **)malloc(dm->stats_num * sizeof(struct ofl_group_stats *));
+    dm->stats = (struct ofl_group_stats **)ofl_alloc(dm->stats_num * sizeof(struct ofl_group_stats *));
 
     for (i = 0; i < dm->stats_num; i++) {
         error = ofl_structs_group_stats_unpack(stat, len, &(dm->stats[i]));
@@ -1007,14 +1008,14 @@ ofl_msg_unpack_stats_reply_group_desc(struct ofp_stats_reply *os, size_t *len, s
     // ofp_stats_reply was already checked and subtracted in unpack_stats_reply
 
     stat = (struct ofp_group_desc_stats *)os->body;
-    dm = (struct ofl_msg_stats_reply_group_desc *)malloc(sizeof(struct ofl_msg_stats_reply_group_desc));
+    dm = (struct ofl_msg_stats_reply_group_desc *)ofl_alloc(sizeof(struct ofl_msg_stats_reply_group_desc));
 
     error = ofl_utils_count_ofp_group_desc_stats(stat, *len, &dm->stats_num);
     if (error) {
-        free(dm);
+        ofl_free(dm);
         return error;
     }
-    dm->stats = (struct ofl_group_desc_stats **)malloc(dm->stats_num * sizeof(struct ofl_group_desc_stats *));
+    dm->stats = (struct ofl_group_desc_stats **)ofl_alloc(dm->stats_num * sizeof(struct ofl_group_desc_stats *));
 
     for (i = 0; i < dm->stats_num; i++) {
         error = ofl_structs_group_desc_stats_unpack(stat, len, &(dm->stats[i]), exp);
@@ -1121,7 +1122,7 @@ ofl_msg_unpack_queue_get_config_request(struct ofp_header *src, size_t *len, str
     }
     *len -= sizeof(struct ofp_queue_get_config_request);
 
-    dr = (struct ofl_msg_queue_get_config_request *)malloc(sizeof(struct ofl_msg_queue_get_config_request));
+    dr = (struct ofl_msg_queue_get_config_request *)ofl_alloc(sizeof(struct ofl_msg_queue_get_config_request));
 
     dr->port = ntohl(sr->port);
 
@@ -1144,16 +1145,16 @@ ofl_msg_unpack_queue_get_config_reply(struct ofp_header *src, size_t *len, struc
     *len -= sizeof(struct ofp_queue_get_config_reply);
 
     sr = (struct ofp_queue_get_config_reply *)src;
-    dr = (struct ofl_msg_queue_get_config_reply *)malloc(sizeof(struct ofl_msg_queue_get_config_reply));
+    dr = (struct ofl_msg_queue_get_config_reply *)ofl_alloc(sizeof(struct ofl_msg_queue_get_config_reply));
 
     dr->port = ntohl(sr->port);
 
     error = ofl_utils_count_ofp_packet_queues(&(sr->queues), *len, &dr->queues_num);
     if (error) {
-        free(dr);
+        ofl_free(dr);
         return error;
     }
-    dr->queues = (struct ofl_packet_queue **)malloc(dr->queues_num * sizeof(struct ofl_packet_queue *));
+    dr->queues = (struct ofl_packet_queue **)ofl_alloc(dr->queues_num * sizeof(struct ofl_packet_queue *));
 
     queue = sr->queues;
     for (i = 0; i < dr->queues_num; i++) {
@@ -1177,7 +1178,7 @@ ofl_msg_unpack_empty(struct ofp_header *src UNUSED, size_t *len, struct ofl_msg_
     // ofp_header length was checked at ofl_msg_unpack
     *len -= sizeof(struct ofp_header);
 
-    *msg = (struct ofl_msg_header *)malloc(sizeof(struct ofl_msg_header));
+    *msg = (struct ofl_msg_header *)ofl_alloc(sizeof(struct ofl_msg_header));
     return 0;
 }
 
@@ -1332,3 +1333,15 @@ ofl_msg_unpack(uint8_t *buf, size_t buf_len, struct ofl_msg_header **msg, uint32
 
     return 0;
 }
+
+ofl_err
+ofl_msg_unpack_arena(uint8_t *buf, size_t buf_len, struct ofl_msg_header **msg,
+                     uint32_t *xid, struct ofl_arena *arena, struct ofl_exp *exp) {
+    ofl_err error;
+
+    ofl_arena_begin_unpack(arena);
+    error = ofl_msg_unpack(buf, buf_len, msg, xid, exp);
+    ofl_arena_end_unpack(arena);
+
+    return error;
+}
@@ -38,6 +38,7 @@
 
 #include "openflow/openflow.h"
 #include "ofl.h"
+#include "ofl-arena.h"
 #include "ofl-structs.h"
 #include "ofl-actions.h"
 
@@ -409,6 +410,18 @@ struct ofl_msg_queue_get_config_reply {
 int
 ofl_msg_pack(struct ofl_msg_header *msg, uint32_t xid, uint8_t **buf, size_t *buf_len, struct ofl_exp *exp);
 
+/* Returns the length of the message in wire format, if the message can be
+ * packed into a buffer supplied by the caller with ofl_msg_pack_to. Returns
+ * zero otherwise, in which case ofl_msg_pack must be used. */
+size_t
+ofl_msg_pack_length(struct ofl_msg_header *msg, struct ofl_exp *exp);
+
+/* Packs the message in msg to the buffer at buf, whose length must be the one
+ * returned by ofl_msg_pack_length. The packed message will have xid as
+ * transaction ID. The return value is zero on success. */
+int
+ofl_msg_pack_to(struct ofl_msg_header *msg, uint32_t xid, uint8_t *buf, size_t buf_len, struct ofl_exp *exp);
+
 /* Unpacks the wire format message in buf to a new OFLib message pointed at by
  * msg. If xid is not null, it will hold the transaction ID of the received
  * message. Returns zero on success. In case of experimenter features, the
@@ -417,6 +430,14 @@ ofl_err
 ofl_msg_unpack(uint8_t *buf, size_t buf_len,
                struct ofl_msg_header **msg, uint32_t *xid, struct ofl_exp *exp);
 
+/* Unpacks the message like ofl_msg_unpack, but allocates the OFLib message
+ * from the arena (see ofl-arena.h). The message can be freed by the usual free
+ * functions, or dropped when the arena is cleared; parts of it which are kept
+ * longer must be cloned first. */
+ofl_err
+ofl_msg_unpack_arena(uint8_t *buf, size_t buf_len, struct ofl_msg_header **msg,
+                     uint32_t *xid, struct ofl_arena *arena, struct ofl_exp *exp);
+
 
 
 
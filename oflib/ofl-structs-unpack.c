@@ -33,6 +33,7 @@
 #include <string.h>
 #include <netinet/in.h>
 #include "ofl.h"
+#include "ofl-arena.h"
 #include "ofl-print.h"
 #include "ofl-actions.h"
 #include "ofl-structs.h"
@@ -81,7 +82,7 @@ ofl_structs_instructions_unpack(struct ofp_instruction *src, size_t *len, struct
                 return ofl_error(OFPET_BAD_INSTRUCTION, OFPBIC_BAD_TABLE_ID);
             }
 
-            di = (struct ofl_instruction_goto_table *)malloc(sizeof(struct ofl_instruction_goto_table));
+            di = (struct ofl_instruction_goto_table *)ofl_alloc(sizeof(struct ofl_instruction_goto_table));
 
             di->table_id = si->table_id;
 
@@ -100,7 +101,7 @@ ofl_structs_instructions_unpack(struct ofp_instruction *src, size_t *len, struct
             }
 
             si = (struct ofp_instruction_write_metadata *)src;
-            di = (struct ofl_instruction_write_metadata *)malloc(sizeof(struct ofl_instruction_write_metadata));
+            di = (struct ofl_instruction_write_metadata *)ofl_alloc(sizeof(struct ofl_instruction_write_metadata));
 
             di->metadata =      ntoh64(si->metadata);
             di->metadata_mask = ntoh64(si->metadata_mask);
@@ -124,14 +125,14 @@ ofl_structs_instructions_unpack(struct ofp_instruction *src, size_t *len, struct
             ilen -= sizeof(struct ofp_instruction_actions);
 
             si = (struct ofp_instruction_actions *)src;
-            di = (struct ofl_instruction_actions *)malloc(sizeof(struct ofl_instruction_actions));
+            di = (struct ofl_instruction_actions *)ofl_alloc(sizeof(struct ofl_instruction_actions));
 
             error = ofl_utils_count_ofp_actions((uint8_t *)si->actions, ilen, &di->actions_num);
             if (error) {
-                free(di);
+                ofl_free(di);
                 return error;
             }
-            di->actions = (struct ofl_action_header **)malloc(di->actions_num * sizeof(struct ofl_action_header *));
+            di->actions = (struct ofl_action_header **)ofl_alloc(di->actions_num * sizeof(struct ofl_action_header *));
 
             act = si->actions;
             for (i = 0; i < di->actions_num; i++) {
@@ -140,7 +141,7 @@ ofl_structs_instructions_unpack(struct ofp_instruction *src, size_t *len, struct
                     *len = *len - ntohs(src->len) + ilen;
                     OFL_UTILS_FREE_ARR_FUN2(di->actions, i,
                                             ofl_actions_free, exp);
-                    free(di);
+                    ofl_free(di);
                     return error;
                 }
                 act = (struct ofp_action_header *)((uint8_t *)act + ntohs(act->len));
@@ -155,7 +156,7 @@ ofl_structs_instructions_unpack(struct ofp_instruction *src, size_t *len, struct
                 return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_LEN);
             }
 
-            inst = (struct ofl_instruction_header *)malloc(sizeof(struct ofl_instruction_header));
+            inst = (struct ofl_instruction_header *)ofl_alloc(sizeof(struct ofl_instruction_header));
             inst->type = (enum ofp_instruction_type)ntohs(src->type);
 
             ilen -= sizeof(struct ofp_instruction_actions);
@@ -224,7 +225,7 @@ ofl_structs_bucket_unpack(struct ofp_bucket *src, size_t *len, uint8_t gtype, st
         return ofl_error(OFPET_GROUP_MOD_FAILED, OFPGMFC_INVALID_GROUP);
     }
 
-    b = (struct ofl_bucket *)malloc(sizeof(struct ofl_bucket));
+    b = (struct ofl_bucket *)ofl_alloc(sizeof(struct ofl_bucket));
 
     b->weight =      ntohs(src->weight);
     b->watch_port =  ntohl(src->watch_port);
@@ -232,10 +233,10 @@ ofl_structs_bucket_unpack(struct ofp_bucket *src, size_t *len, uint8_t gtype, st
 
     error = ofl_utils_count_ofp_actions((uint8_t *)src->actions, blen, &b->actions_num);
     if (error) {
-        free(b);
+        ofl_free(b);
         return error;
     }
-    b->actions = (struct ofl_action_header **)malloc(b->actions_num * sizeof(struct ofl_action_header *));
+    b->actions = (struct ofl_action_header **)ofl_alloc(b->actions_num * sizeof(struct ofl_action_header *));
 
     act = src->actions;
     for (i = 0; i < b->actions_num; i++) {
@@ -244,7 +245,7 @@ ofl_structs_bucket_unpack(struct ofp_bucket *src, size_t *len, uint8_t gtype, st
             *len = *len - ntohs(src->len) + blen;
             OFL_UTILS_FREE_ARR_FUN2(b->actions, i,
                                     ofl_actions_free, exp);
-            free(b);
+            ofl_free(b);
             return error;
         }
         act = (struct ofp_action_header *)((uint8_t *)act + ntohs(act->len));
@@ -292,7 +293,7 @@ ofl_structs_flow_stats_unpack(struct ofp_flow_stats *src, size_t *len, struct of
 
     slen = ntohs(src->length) - (sizeof(struct ofp_flow_stats) - sizeof(struct ofp_match));
 
-    s = (struct ofl_flow_stats *)malloc(sizeof(struct ofl_flow_stats));
+    s = (struct ofl_flow_stats *)ofl_alloc(sizeof(struct ofl_flow_stats));
 
     s->table_id =             src->table_id;
     s->duration_sec =  ntohl( src->duration_sec);
@@ -306,17 +307,17 @@ ofl_structs_flow_stats_unpack(struct ofp_flow_stats *src, size_t *len, struct of
 
     error = ofl_structs_match_unpack(&(src->match), &slen, &(s->match), exp);
     if (error) {
-        free(s);
+        ofl_free(s);
         return error;
     }
 
     error = ofl_utils_count_ofp_instructions(src->instructions, slen, &s->instructions_num);
     if (error) {
         ofl_structs_free_match(s->match, exp);
-        free(s);
+        ofl_free(s);
         return error;
     }
-    s->instructions = (struct ofl_instruction_header **)malloc(s->instructions_num * sizeof(struct ofl_instruction_header *));
+    s->instructions = (struct ofl_instruction_header **)ofl_alloc(s->instructions_num * sizeof(struct ofl_instruction_header *));
 
     inst = src->instructions;
     for (i = 0; i < s->instructions_num; i++) {
@@ -324,7 +325,7 @@ ofl_structs_flow_stats_unpack(struct ofp_flow_stats *src, size_t *len, struct of
         if (error) {
             OFL_UTILS_FREE_ARR_FUN2(s->instructions, i,
                                     ofl_structs_free_instruction, exp);
-            free(s);
+            ofl_free(s);
             return error;
         }
         inst = (struct ofp_instruction *)((uint8_t *)inst + ntohs(inst->len));
@@ -371,7 +372,7 @@ ofl_structs_group_stats_unpack(struct ofp_group_stats *src, size_t *len, struct
     }
     slen = ntohs(src->length) - sizeof(struct ofp_group_stats);
 
-    s = (struct ofl_group_stats *)malloc(sizeof(struct ofl_group_stats));
+    s = (struct ofl_group_stats *)ofl_alloc(sizeof(struct ofl_group_stats));
     s->group_id = ntohl(src->group_id);
     s->ref_count = ntohl(src->ref_count);
     s->packet_count = ntoh64(src->packet_count);
@@ -379,17 +380,17 @@ ofl_structs_group_stats_unpack(struct ofp_group_stats *src, size_t *len, struct
 
     error = ofl_utils_count_ofp_bucket_counters(src->bucket_stats, slen, &s->counters_num);
     if (error) {
-        free(s);
+        ofl_free(s);
         return error;
     }
-    s->counters = (struct ofl_bucket_counter **)malloc(s->counters_num * sizeof(struct ofl_bucket_counter *));
+    s->counters = (struct ofl_bucket_counter **)ofl_alloc(s->counters_num * sizeof(struct ofl_bucket_counter *));
 
     c = src->bucket_stats;
     for (i = 0; i < s->counters_num; i++) {
         error = ofl_structs_bucket_counter_unpack(c, &slen, &(s->counters[i]));
         if (error) {
             OFL_UTILS_FREE_ARR(s->counters, i);
-            free(s);
+            ofl_free(s);
             return error;
         }
         c = (struct ofp_bucket_counter *)((uint8_t *)c + sizeof(struct ofp_bucket_counter));
@@ -424,7 +425,7 @@ ofl_structs_queue_prop_unpack(struct ofp_queue_prop_header *src, size_t *len, st
     switch (ntohs(src->property)) {
         case OFPQT_MIN_RATE: {
             struct ofp_queue_prop_min_rate *sp = (struct ofp_queue_prop_min_rate *)src;
-            struct ofl_queue_prop_min_rate *dp = (struct ofl_queue_prop_min_rate *)malloc(sizeof(struct ofl_queue_prop_min_rate));
+            struct ofl_queue_prop_min_rate *dp = (struct ofl_queue_prop_min_rate *)ofl_alloc(sizeof(struct ofl_queue_prop_min_rate));
 
             if (*len < sizeof(struct ofp_queue_prop_min_rate)) {
                 OFL_LOG_WARN(LOG_MODULE, "Received MIN_RATE queue property has invalid length (%zu).", *len);
@@ -461,15 +462,15 @@ ofl_structs_packet_queue_unpack(struct ofp_packet_queue *src, size_t *len, struc
     }
     *len -= sizeof(struct ofp_packet_queue);
 
-    q = (struct ofl_packet_queue *)malloc(sizeof(struct ofl_packet_queue));
+    q = (struct ofl_packet_queue *)ofl_alloc(sizeof(struct ofl_packet_queue));
     q->queue_id = ntohl(src->queue_id);
 
     error = ofl_utils_count_ofp_queue_props((uint8_t *)src->properties, *len, &q->properties_num);
     if (error) {
-        free(q);
+        ofl_free(q);
         return error;
     }
-    q->properties = (struct ofl_queue_prop_header **)malloc(q->properties_num * sizeof(struct ofl_queue_prop_header *));
+    q->properties = (struct ofl_queue_prop_header **)ofl_alloc(q->properties_num * sizeof(struct ofl_queue_prop_header *));
 
     prop = src->properties;
     for (i = 0; i < q->properties_num; i++) {
@@ -502,11 +503,11 @@ ofl_structs_port_unpack(struct ofp_port *src, size_t *len, struct ofl_port **dst
     }
     *len -= sizeof(struct ofp_port);
 
-    p = (struct ofl_port *)malloc(sizeof(struct ofl_port));
+    p = (struct ofl_port *)ofl_alloc(sizeof(struct ofl_port));
 
     p->port_no = ntohl(src->port_no);
     memcpy(p->hw_addr, src->hw_addr, ETH_ADDR_LEN);
-    p->name = strcpy((char *)malloc(strlen(src->name) + 1), src->name);
+    p->name = strcpy((char *)ofl_alloc(strlen(src->name) + 1), src->name);
     p->config = ntohl(src->config);
     p->state = ntohl(src->state);
     p->curr = ntohl(src->curr);
@@ -541,9 +542,9 @@ ofl_structs_table_stats_unpack(struct ofp_table_stats *src, size_t *len, struct
     }
     *len -= sizeof(struct ofp_table_stats);
 
-    p = (struct ofl_table_stats *)malloc(sizeof(struct ofl_table_stats));
+    p = (struct ofl_table_stats *)ofl_alloc(sizeof(struct ofl_table_stats));
     p->table_id =      src->table_id;
-    p->name =          strcpy((char *)malloc(strlen(src->name) + 1), src->name);
+    p->name =          strcpy((char *)ofl_alloc(strlen(src->name) + 1), src->name);
     p->wildcards =     ntohl(src->wildcards);
     p->match =         ntohl(src->match);
     p->instructions =  ntohl(src->instructions);
@@ -578,7 +579,7 @@ ofl_structs_port_stats_unpack(struct ofp_port_stats *src, size_t *len, struct of
     }
     *len -= sizeof(struct ofp_port_stats);
 
-    p = (struct ofl_port_stats *)malloc(sizeof(struct ofl_port_stats));
+    p = (struct ofl_port_stats *)ofl_alloc(sizeof(struct ofl_port_stats));
 
     p->port_no      = ntohl(src->port_no);
     p->rx_packets   = ntoh64(src->rx_packets);
@@ -617,7 +618,7 @@ ofl_structs_queue_stats_unpack(struct ofp_queue_stats *src, size_t *len, struct
     }
     *len -= sizeof(struct ofp_queue_stats);
 
-    p = (struct ofl_queue_stats *)malloc(sizeof(struct ofl_queue_stats));
+    p = (struct ofl_queue_stats *)ofl_alloc(sizeof(struct ofl_queue_stats));
 
     p->port_no =    ntohl(src->port_no);
     p->queue_id =   ntohl(src->queue_id);
@@ -657,17 +658,17 @@ ofl_structs_group_desc_stats_unpack(struct ofp_group_desc_stats *src, size_t *le
     }
     dlen = ntohs(src->length) - sizeof(struct ofp_group_desc_stats);
 
-    dm = (struct ofl_group_desc_stats *)malloc(sizeof(struct ofl_group_desc_stats));
+    dm = (struct ofl_group_desc_stats *)ofl_alloc(sizeof(struct ofl_group_desc_stats));
 
     dm->type = src->type;
     dm->group_id = ntohl(src->group_id);
 
     error = ofl_utils_count_ofp_buckets(src->buckets, dlen, &dm->buckets_num);
     if (error) {
-        free(dm);
+        ofl_free(dm);
         return error;
     }
-    dm->buckets = (struct ofl_bucket **)malloc(dm->buckets_num * sizeof(struct ofl_bucket *));
+    dm->buckets = (struct ofl_bucket **)ofl_alloc(dm->buckets_num * sizeof(struct ofl_bucket *));
 
     bucket = src->buckets;
     for (i = 0; i < dm->buckets_num; i++) {
@@ -703,7 +704,7 @@ ofl_structs_bucket_counter_unpack(struct ofp_bucket_counter *src, size_t *len, s
     }
     *len -= sizeof(struct ofp_bucket_counter);
 
-    p = (struct ofl_bucket_counter *)malloc(sizeof(struct ofl_bucket_counter));
+    p = (struct ofl_bucket_counter *)ofl_alloc(sizeof(struct ofl_bucket_counter));
     p->packet_count = ntoh64(src->packet_count);
     p->byte_count =   ntoh64(src->byte_count);
 
@@ -763,7 +764,7 @@ ofl_structs_match_standard_unpack(struct ofp_match *src, size_t *len, struct ofl
              taken into account, which are explicitly matched (MPLS, ARP, IP,
              TCP, UDP) It is up to the library user to handle this either by
              updating this match structure, or by other means. */
-    m = (struct ofl_match_standard *)malloc(sizeof(struct ofl_match_standard));
+    m = (struct ofl_match_standard *)ofl_alloc(sizeof(struct ofl_match_standard));
     m->header.type =          OFPMT_STANDARD;
     m->in_port =       ntohl( src->in_port);
     m->wildcards =     ntohl( src->wildcards);
@@ -33,6 +33,7 @@
 #include <string.h>
 #include <netinet/in.h>
 #include "ofl.h"
+#include "ofl-arena.h"
 #include "ofl-structs.h"
 #include "ofl-actions.h"
 #include "ofl-utils.h"
@@ -245,10 +246,111 @@ ofl_utils_count_ofp_queue_props(void *data, size_t data_len, size_t *count) {
 }
 
 
+struct ofl_instruction_header *
+ofl_structs_instruction_clone(struct ofl_instruction_header *inst, struct ofl_exp *exp) {
+    switch (inst->type) {
+        case OFPIT_GOTO_TABLE: {
+            struct ofl_instruction_goto_table *clone = (struct ofl_instruction_goto_table *)malloc(sizeof(struct ofl_instruction_goto_table));
+            memcpy(clone, inst, sizeof(struct ofl_instruction_goto_table));
+            return (struct ofl_instruction_header *)clone;
+        }
+        case OFPIT_WRITE_METADATA: {
+            struct ofl_instruction_write_metadata *clone = (struct ofl_instruction_write_metadata *)malloc(sizeof(struct ofl_instruction_write_metadata));
+            memcpy(clone, inst, sizeof(struct ofl_instruction_write_metadata));
+            return (struct ofl_instruction_header *)clone;
+        }
+        case OFPIT_WRITE_ACTIONS:
+        case OFPIT_APPLY_ACTIONS: {
+            struct ofl_instruction_actions *ia = (struct ofl_instruction_actions *)inst;
+            struct ofl_instruction_actions *clone = (struct ofl_instruction_actions *)malloc(sizeof(struct ofl_instruction_actions));
+            size_t i;
+
+            clone->header      = ia->header;
+            clone->actions_num = ia->actions_num;
+            clone->actions     = (struct ofl_action_header **)malloc(ia->actions_num * sizeof(struct ofl_action_header *));
+            for (i=0; i<ia->actions_num; i++) {
+                clone->actions[i] = ofl_actions_clone(ia->actions[i], exp);
+            }
+            return (struct ofl_instruction_header *)clone;
+        }
+        case OFPIT_EXPERIMENTER: {
+            struct ofl_instruction_header *clone;
+            struct ofp_instruction *ofp;
+            size_t len;
+
+            if (exp == NULL || exp->inst == NULL || exp->inst->ofp_len == NULL ||
+                exp->inst->pack == NULL || exp->inst->unpack == NULL) {
+                OFL_LOG_WARN(LOG_MODULE, "Trying to clone experimenter instruction, but no callback was given.");
+                return NULL;
+            }
+            /* NOTE: experimenter instructions are cloned through their wire format. */
+            len = exp->inst->ofp_len(inst);
+            ofp = (struct ofp_instruction *)malloc(len);
+            exp->inst->pack(inst, ofp);
+            if (exp->inst->unpack(ofp, &len, &clone)) {
+                clone = NULL;
+            }
+            free(ofp);
+            return clone;
+        }
+        case OFPIT_CLEAR_ACTIONS:
+        default: {
+            struct ofl_instruction_header *clone = (struct ofl_instruction_header *)malloc(sizeof(struct ofl_instruction_header));
+            *clone = *inst;
+            return clone;
+        }
+    }
+}
+
+struct ofl_bucket *
+ofl_structs_bucket_clone(struct ofl_bucket *bucket, struct ofl_exp *exp) {
+    struct ofl_bucket *clone;
+    size_t i;
+
+    clone = (struct ofl_bucket *)malloc(sizeof(struct ofl_bucket));
+    *clone = *bucket;
+    clone->actions = (struct ofl_action_header **)malloc(bucket->actions_num * sizeof(struct ofl_action_header *));
+    for (i=0; i<bucket->actions_num; i++) {
+        clone->actions[i] = ofl_actions_clone(bucket->actions[i], exp);
+    }
+    return clone;
+}
+
+struct ofl_match_header *
+ofl_structs_match_clone(struct ofl_match_header *match, struct ofl_exp *exp) {
+    switch (match->type) {
+        case (OFPMT_STANDARD): {
+            struct ofl_match_standard *clone = (struct ofl_match_standard *)malloc(sizeof(struct ofl_match_standard));
+            memcpy(clone, match, sizeof(struct ofl_match_standard));
+            return (struct ofl_match_header *)clone;
+        }
+        default: {
+            struct ofl_match_header *clone;
+            struct ofp_match *ofp;
+            size_t len;
+
+            if (exp == NULL || exp->match == NULL || exp->match->ofp_len == NULL ||
+                exp->match->pack == NULL || exp->match->unpack == NULL) {
+                OFL_LOG_WARN(LOG_MODULE, "Trying to clone experimenter match, but no callback was given.");
+                return NULL;
+            }
+            len = exp->match->ofp_len(match);
+            ofp = (struct ofp_match *)malloc(len);
+            exp->match->pack(match, ofp);
+            if (exp->match->unpack(ofp, &len, &clone)) {
+                clone = NULL;
+            }
+            free(ofp);
+            return clone;
+        }
+    }
+}
+
+
 void
 ofl_structs_free_packet_queue(struct ofl_packet_queue *queue) {
     OFL_UTILS_FREE_ARR(queue->properties, queue->properties_num);
-    free(queue);
+    ofl_free(queue);
 }
 
 void
@@ -276,20 +378,20 @@ ofl_structs_free_instruction(struct ofl_instruction_header *inst, struct ofl_exp
             }
         }
     }
-    free(inst);
+    ofl_free(inst);
 }
 
 void
 ofl_structs_free_table_stats(struct ofl_table_stats *stats) {
-    free(stats->name);
-    free(stats);
+    ofl_free(stats->name);
+    ofl_free(stats);
 }
 
 void
 ofl_structs_free_bucket(struct ofl_bucket *bucket, struct ofl_exp *exp) {
     OFL_UTILS_FREE_ARR_FUN2(bucket->actions, bucket->actions_num,
                             ofl_actions_free, exp);
-    free(bucket);
+    ofl_free(bucket);
 }
 
 
@@ -298,39 +400,39 @@ ofl_structs_free_flow_stats(struct ofl_flow_stats *stats, struct ofl_exp *exp) {
     OFL_UTILS_FREE_ARR_FUN2(stats->instructions, stats->instructions_num,
                             ofl_structs_free_instruction, exp);
     ofl_structs_free_match(stats->match, exp);
-    free(stats);
+    ofl_free(stats);
 }
 
 void
 ofl_structs_free_port(struct ofl_port *port) {
-    free(port->name);
-    free(port);
+    ofl_free(port->name);
+    ofl_free(port);
 }
 
 void
 ofl_structs_free_group_stats(struct ofl_group_stats *stats) {
     OFL_UTILS_FREE_ARR(stats->counters, stats->counters_num);
-    free(stats);
+    ofl_free(stats);
 }
 
 void
 ofl_structs_free_group_desc_stats(struct ofl_group_desc_stats *stats, struct ofl_exp *exp) {
     OFL_UTILS_FREE_ARR_FUN2(stats->buckets, stats->buckets_num,
                             ofl_structs_free_bucket, exp);
-    free(stats);
+    ofl_free(stats);
 }
 
 void
 ofl_structs_free_match(struct ofl_match_header *match, struct ofl_exp *exp) {
     switch (match->type) {
         case (OFPMT_STANDARD): {
-            free(match);
+            ofl_free(match);
             break;
         }
         default: {
             if (exp == NULL || exp->match == NULL || exp->match->free == NULL) {
                 OFL_LOG_WARN(LOG_MODULE, "Trying to free experimented instruction, but no callback was given.");
-                free(match);
+                ofl_free(match);
             } else {
                 exp->match->free(match);
             }
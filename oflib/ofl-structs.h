@@ -391,6 +391,25 @@ ofl_structs_free_match(struct ofl_match_header *match, struct ofl_exp *exp);
 
 
 
+/****************************************************************************
+ * Functions for cloning structures
+ ****************************************************************************/
+
+/* These functions return a deep copy of the passed in structure, allocated by
+ * malloc, which can be freed by the respective free function. They are used
+ * for keeping parts of messages unpacked into an arena. In case of
+ * experimenter features, they use the passed in experimenter callback. */
+struct ofl_instruction_header *
+ofl_structs_instruction_clone(struct ofl_instruction_header *inst, struct ofl_exp *exp);
+
+struct ofl_bucket *
+ofl_structs_bucket_clone(struct ofl_bucket *bucket, struct ofl_exp *exp);
+
+struct ofl_match_header *
+ofl_structs_match_clone(struct ofl_match_header *match, struct ofl_exp *exp);
+
+
+
 /****************************************************************************
  * Utility functions
  ****************************************************************************/
@@ -29,6 +29,7 @@
  * Author: Zoltán Lajos Kis <zoltan.lajos.kis@ericsson.com>
  */
 
+#include <stdbool.h>
 #include <stdlib.h>
 #include "action_set.h"
 #include "dp_actions.h"
@@ -37,141 +38,59 @@
 #include "oflib/ofl.h"
 #include "oflib/ofl-actions.h"
 #include "oflib/ofl-print.h"
-#include "packet.h"
-#include "list.h"
 #include "util.h"
 
-struct action_set_entry;
-
-struct action_set {
-    struct list     actions;   /* the list of actions in the action set,
-+                                   stored in the order of precedence as defined
-+                                   by the specification. */
-    struct ofl_exp *exp;       /* experimenter callbacks */
-};
-
-struct action_set_entry {
-    struct list                node;
-
-    struct ofl_action_header  *action;  /* these actions point to actions in
-+                                        * flow table entry instructions */
-    int                        order;   /* order of the entry as defined */
+/* Slots in the order the actions should be executed in according to the
+ * spec. Slots of the same precedence are in type order. */
+static const size_t exec_order[ACTION_SET_SLOTS] = {
+    OFPAT_COPY_TTL_IN,                                      /* 10 */
+    OFPAT_POP_VLAN, OFPAT_POP_MPLS,                         /* 20 */
+    OFPAT_PUSH_VLAN, OFPAT_PUSH_MPLS,                       /* 30 */
+    OFPAT_COPY_TTL_OUT,                                     /* 40 */
+    OFPAT_DEC_MPLS_TTL, OFPAT_DEC_NW_TTL,                   /* 50 */
+    OFPAT_SET_VLAN_VID, OFPAT_SET_VLAN_PCP, OFPAT_SET_DL_SRC,
+    OFPAT_SET_DL_DST, OFPAT_SET_NW_SRC, OFPAT_SET_NW_DST,
+    OFPAT_SET_NW_TOS, OFPAT_SET_NW_ECN, OFPAT_SET_TP_SRC,
+    OFPAT_SET_TP_DST, OFPAT_SET_MPLS_LABEL, OFPAT_SET_MPLS_TC,
+    OFPAT_SET_MPLS_TTL, OFPAT_SET_NW_TTL,                   /* 60 */
+    OFPAT_SET_QUEUE,                                        /* 70 */
+    ACTION_SET_EXP_SLOT,                                    /* 75 */
+    OFPAT_GROUP,                                            /* 80 */
+    OFPAT_OUTPUT                                            /* 90 */
 };
 
+BUILD_ASSERT_DECL(ACTION_SET_SLOTS <= 32);
 
-
-
-/* Returns the priority of the action it should be executed in
- * according to the spec. Note, that the actions are already
- * stored in this order.
- */
-static int
-action_set_order(struct ofl_action_header *act) {
-    switch (act->type) {
-        case (OFPAT_OUTPUT):         return 90;
-        case (OFPAT_SET_VLAN_VID):   return 60;
-        case (OFPAT_SET_VLAN_PCP):   return 60;
-        case (OFPAT_SET_DL_SRC):     return 60;
-        case (OFPAT_SET_DL_DST):     return 60;
-        case (OFPAT_SET_NW_SRC):     return 60;
-        case (OFPAT_SET_NW_DST):     return 60;
-        case (OFPAT_SET_NW_TOS):     return 60;
-        case (OFPAT_SET_NW_ECN):     return 60;
-        case (OFPAT_SET_TP_SRC):     return 60;
-        case (OFPAT_SET_TP_DST):     return 60;
-        case (OFPAT_COPY_TTL_OUT):   return 40;
-        case (OFPAT_COPY_TTL_IN):    return 10;
-        case (OFPAT_SET_MPLS_LABEL): return 60;
-        case (OFPAT_SET_MPLS_TC):    return 60;
-        case (OFPAT_SET_MPLS_TTL):   return 60;
-        case (OFPAT_DEC_MPLS_TTL):   return 50;
-        case (OFPAT_PUSH_VLAN):      return 30;
-        case (OFPAT_POP_VLAN):       return 20;
-        case (OFPAT_PUSH_MPLS):      return 30;
-        case (OFPAT_POP_MPLS):       return 20;
-        case (OFPAT_SET_QUEUE):      return 70;
-        case (OFPAT_GROUP):          return 80;
-        case (OFPAT_SET_NW_TTL):     return 60;
-        case (OFPAT_DEC_NW_TTL):     return 50;
-        case (OFPAT_EXPERIMENTER):   return 75;
-        default:                     return 79;
-    }
-}
-
-
-/* Creates a new set entry */
-struct action_set *
-action_set_create(struct ofl_exp *exp) {
-    struct action_set *set = xmalloc(sizeof(struct action_set));
-    list_init(&set->actions);
-    set->exp = exp;
-
-    return set;
-}
-
-void action_set_destroy(struct action_set *set) {
-    action_set_clear_actions(set);
-    free(set);
+/* Returns the slot of the action. */
+static inline size_t
+action_set_slot(struct ofl_action_header *act) {
+    return act->type < ACTION_SET_EXP_SLOT ? act->type : ACTION_SET_EXP_SLOT;
 }
 
-static struct action_set_entry *
-action_set_create_entry(struct ofl_action_header *act) {
-    struct action_set_entry *entry;
 
-    entry = xmalloc(sizeof(struct action_set_entry));
-    entry->action = act;
-    entry->order = action_set_order(act);
-
-    return entry;
+void
+action_set_init(struct action_set *set, struct ofl_exp *exp) {
+    set->slots = 0;
+    set->exp   = exp;
 }
 
-struct action_set *
-action_set_clone(struct action_set *set) {
-    struct action_set *s = xmalloc(sizeof(struct action_set));
-    struct action_set_entry *entry, *new_entry;
-
-    list_init(&s->actions);
-    s->exp = set->exp;
-
-    LIST_FOR_EACH(entry, struct action_set_entry, node, &set->actions) {
-        new_entry = action_set_create_entry(entry->action);
-        list_push_back(&s->actions, &new_entry->node);
-    }
-
-    return s;
+void
+action_set_copy(struct action_set *set, struct action_set *src) {
+    *set = *src;
 }
 
 
 /* Writes a single action to the action set. Overwrites existing actions with
- * the same type in the set. The list order is based on the precedence defined
- * in the specification. */
-static void
+ * the same type in the set. */
+static inline void
 action_set_write_action(struct action_set *set,
                         struct ofl_action_header *act) {
-    struct action_set_entry *entry, *new_entry;
-
-    new_entry = action_set_create_entry(act);
-
-    LIST_FOR_EACH(entry, struct action_set_entry, node, &set->actions) {
-        if (entry->action->type == new_entry->action->type) {
-            /* replace same type of action */
-            list_replace(&new_entry->node, &entry->node);
-            /* NOTE: action in entry must not be freed, as it is owned by the
-             *       write instruction which added the action to the set */
-            free(entry);
-
-            return;
-        }
-        if (new_entry->order < entry->order) {
-            /* insert higher order action before */
-            list_insert(&entry->node, &new_entry->node);
+    size_t slot = action_set_slot(act);
 
-            return;
-        }
-    }
-
-    /* add action to the end of set */
-    list_insert(&entry->node, &new_entry->node);
+    /* NOTE: a replaced action must not be freed, as it is owned by the
+     *       write instruction which added the action to the set */
+    set->actions[slot] = act;
+    set->slots |= (1u << slot);
 }
 
 
@@ -188,24 +107,23 @@ action_set_write_actions(struct action_set *set,
 
 void
 action_set_clear_actions(struct action_set *set) {
-    struct action_set_entry *entry, *next;
-
-    LIST_FOR_EACH_SAFE(entry, next, struct action_set_entry, node, &set->actions) {
-        list_remove(&entry->node);
-        // NOTE: action in entry must not be freed, as it is owned by the write instruction
-        //       which added the action to the set
-        free(entry);
-    }
+    // NOTE: actions must not be freed, as they are owned by the write instruction
+    //       which added the action to the set
+    set->slots = 0;
 }
 
 void
 action_set_execute(struct action_set *set, struct packet *pkt) {
-    struct action_set_entry *entry, *next;
+    size_t i;
 
-    LIST_FOR_EACH_SAFE(entry, next, struct action_set_entry, node, &set->actions) {
-        dp_execute_action(pkt, entry->action);
-        list_remove(&entry->node);
-        free(entry);
+    for (i=0; i<ACTION_SET_SLOTS && set->slots != 0; i++) {
+        size_t slot = exec_order[i];
+
+        if ((set->slots & (1u << slot)) == 0) {
+            continue;
+        }
+        set->slots &= ~(1u << slot);
+        dp_execute_action(pkt, set->actions[slot]);
 
         /* According to the spec. if there was a group action, the output
          * port action should be ignored */
@@ -246,13 +164,19 @@ action_set_to_string(struct action_set *set) {
 
 void
 action_set_print(FILE *stream, struct action_set *set) {
-    struct action_set_entry *entry;
+    bool first = true;
+    size_t i;
 
     fprintf(stream, "[");
 
-    LIST_FOR_EACH(entry, struct action_set_entry, node, &set->actions) {
-        ofl_action_print(stream, entry->action, set->exp);
-        if (entry->node.next != &set->actions) { fprintf(stream, ", "); }
+    for (i=0; i<ACTION_SET_SLOTS; i++) {
+        size_t slot = exec_order[i];
+
+        if ((set->slots & (1u << slot)) != 0) {
+            if (!first) { fprintf(stream, ", "); }
+            ofl_action_print(stream, set->actions[slot], set->exp);
+            first = false;
+        }
     }
 
     fprintf(stream, "]");
@@ -33,14 +33,12 @@
 #define ACTION_SET_H 1
 
 #include <sys/types.h>
+#include <stdint.h>
 #include <stdio.h>
-#include "datapath.h"
-#include "packet.h"
 #include "oflib/ofl.h"
 #include "oflib/ofl-actions.h"
 #include "oflib/ofl-structs.h"
 
-struct action_set;
 struct datapath;
 struct packet;
 
@@ -49,17 +47,28 @@ struct packet;
  * Implementation of an action set associated with a datapath packet
  ****************************************************************************/
 
-struct action_set *
-action_set_create(struct ofl_exp *exp);
+/* The set holds at most one action of each type, so actions are stored in a
+ * slot per type; experimenter actions share a single slot. */
+#define ACTION_SET_EXP_SLOT  (OFPAT_DEC_NW_TTL + 1)
+#define ACTION_SET_SLOTS     (ACTION_SET_EXP_SLOT + 1)
 
-/* Destroys an action set */
+/* NOTE: the action set is embedded in the packet, see packet.h. */
+struct action_set {
+    struct ofl_action_header  *actions[ACTION_SET_SLOTS]; /* these actions point to
+                                                             actions in flow table
+                                                             entry instructions */
+    uint32_t                   slots;  /* bitmap of the slots in use. */
+    struct ofl_exp            *exp;    /* experimenter callbacks */
+};
+
+/* Initializes an empty action set. */
 void
-action_set_destroy(struct action_set *set);
+action_set_init(struct action_set *set, struct ofl_exp *exp);
 
-/* Creates a clone of an action set. Used when cloning a datapath packet in
- * groups. */
-struct action_set *
-action_set_clone(struct action_set *set);
+/* Initializes set to a copy of the action set src. Used when cloning a
+ * datapath packet in groups. */
+void
+action_set_copy(struct action_set *set, struct action_set *src);
 
 /* Writes the set of given actions to the set, overwriting existing types as
  * defined by the 1.1 spec. */
@@ -8,6 +8,8 @@ man_MANS += udatapath/ofdatapath.8
 udatapath_ofdatapath_SOURCES = \
 	udatapath/action_set.c \
 	udatapath/action_set.h \
+	udatapath/classifier.c \
+	udatapath/classifier.h \
 	udatapath/crc32.c \
 	udatapath/crc32.h \
 	udatapath/datapath.c \
@@ -22,6 +24,12 @@ udatapath_ofdatapath_SOURCES = \
 	udatapath/dp_exp.h \
 	udatapath/dp_ports.c \
 	udatapath/dp_ports.h \
+	udatapath/dp_ratelimit.c \
+	udatapath/dp_ratelimit.h \
+	udatapath/dp_workers.c \
+	udatapath/dp_workers.h \
+	udatapath/flow_cache.c \
+	udatapath/flow_cache.h \
 	udatapath/flow_table.c \
 	udatapath/flow_table.h \
 	udatapath/flow_entry.c \
@@ -38,9 +46,13 @@ udatapath_ofdatapath_SOURCES = \
 	udatapath/packet_handle_std.h \
 	udatapath/pipeline.c \
 	udatapath/pipeline.h \
+	udatapath/rcu.c \
+	udatapath/rcu.h \
+	udatapath/timer_wheel.c \
+	udatapath/timer_wheel.h \
 	udatapath/udatapath.c
 
-udatapath_ofdatapath_LDADD = lib/libopenflow.a oflib/liboflib.a oflib-exp/liboflib_exp.a $(SSL_LIBS) $(FAULT_LIBS)
+udatapath_ofdatapath_LDADD = lib/libopenflow.a oflib/liboflib.a oflib-exp/liboflib_exp.a $(SSL_LIBS) $(FAULT_LIBS) $(PTHREAD_LIBS)
 udatapath_ofdatapath_CPPFLAGS = $(AM_CPPFLAGS)
 
 EXTRA_DIST += udatapath/ofdatapath.8.in
@@ -65,6 +77,8 @@ noinst_LIBRARIES += udatapath/libudatapath.a
 udatapath_libudatapath_a_SOURCES = \
 	udatapath/action_set.c \
 	udatapath/action_set.h \
+	udatapath/classifier.c \
+	udatapath/classifier.h \
 	udatapath/crc32.c \
 	udatapath/crc32.h \
 	udatapath/datapath.c \
@@ -77,6 +91,12 @@ udatapath_libudatapath_a_SOURCES = \
 	udatapath/dp_control.h \
 	udatapath/dp_exp.c \
 	udatapath/dp_exp.h \
+	udatapath/dp_ratelimit.c \
+	udatapath/dp_ratelimit.h \
+	udatapath/dp_workers.c \
+	udatapath/dp_workers.h \
+	udatapath/flow_cache.c \
+	udatapath/flow_cache.h \
 	udatapath/flow_table.c \
 	udatapath/flow_table.h \
 	udatapath/flow_entry.c \
@@ -93,6 +113,10 @@ udatapath_libudatapath_a_SOURCES = \
 	udatapath/packet_handle_std.h \
 	udatapath/pipeline.c \
 	udatapath/pipeline.h \
+	udatapath/rcu.c \
+	udatapath/rcu.h \
+	udatapath/timer_wheel.c \
+	udatapath/timer_wheel.h \
 	udatapath/udatapath.c
 
 udatapath_libudatapath_a_CPPFLAGS = $(AM_CPPFLAGS)
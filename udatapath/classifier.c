@@ -0,0 +1,692 @@
+/* Copyright (c) 2011, TrafficLab, Ericsson Research, Hungary
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Ericsson Research nor the names of its
+ *     contributors may be used to endorse or promote products derived from
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <netinet/in.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "classifier.h"
+#include "hmap.h"
+#include "list.h"
+#include "match_std.h"
+#include "util.h"
+#include "oflib/ofl-structs.h"
+#include "openflow/openflow.h"
+
+/* Number of subtables whose buckets are prefetched ahead of probing. */
+#define CLS_LOOKAHEAD 4
+
+/* Number of address bits consumed by a trie node. */
+#define TRIE_STRIDE 4
+#define TRIE_SLOTS  (1 << TRIE_STRIDE)
+
+/* A node of an IPv4 prefix trie. A prefix is counted in the node where its
+ * last stride ends, and is expanded into the plens of the slots it covers;
+ * so a lookup reads one byte and one pointer per stride. */
+struct cls_trie_node {
+    struct cls_trie_node  *children[TRIE_SLOTS];
+    uint8_t                plens[TRIE_SLOTS];  /* bit i is set if a prefix of
+                                                  depth+i+1 bits covers the slot. */
+    uint32_t               prefixes[2 * TRIE_SLOTS - 2]; /* rules per prefix
+                                                  ending in the node. */
+    size_t                 refs;               /* rules with prefixes ending
+                                                  in the node or below. */
+};
+
+
+/* Returns true if the given field is set in the wildcard field */
+static inline bool
+wc(uint32_t wildcards, uint32_t field) {
+    return (wildcards & field) != 0;
+}
+
+static inline const uint64_t *
+key_words(const struct flow_key *key) {
+    return (const uint64_t *)key;
+}
+
+/* Hashes the key a word at a time. It is calculated for each subtable on
+ * each lookup, so a multiplicative hash is used instead of hash_words. */
+static inline uint32_t
+flow_key_hash(const struct flow_key *key) {
+    const uint64_t *kw = key_words(key);
+    uint64_t h = 0;
+    size_t i;
+
+    for (i=0; i<FLOW_KEY_WORDS; i++) {
+        h = (h ^ kw[i]) * 0x9e3779b97f4a7c15ULL;
+        h ^= h >> 29;
+    }
+    return (uint32_t)(h ^ (h >> 32));
+}
+
+/* NOTE: where SSE2 is available, keys are compared and masked two words at a
+ *       time; the remaining word is handled by the scalar loop. */
+static inline bool
+flow_key_equal(const struct flow_key *a, const struct flow_key *b) {
+    const uint64_t *aw = key_words(a);
+    const uint64_t *bw = key_words(b);
+    size_t i = 0;
+#ifdef __SSE2__
+    __m128i diff = _mm_setzero_si128();
+
+    for (; i + 2 <= FLOW_KEY_WORDS; i += 2) {
+        diff = _mm_or_si128(diff, _mm_xor_si128(_mm_loadu_si128((const __m128i *)(aw + i)),
+                                                _mm_loadu_si128((const __m128i *)(bw + i))));
+    }
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(diff, _mm_setzero_si128())) != 0xffff) {
+        return false;
+    }
+#endif
+
+    for (; i<FLOW_KEY_WORDS; i++) {
+        if (aw[i] != bw[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Masks the key with the given mask. */
+static inline void
+flow_key_mask(struct flow_key *dst, const struct flow_key *key, const struct flow_key *mask) {
+    const uint64_t *kw = key_words(key);
+    const uint64_t *mw = key_words(mask);
+    uint64_t *dw = (uint64_t *)dst;
+    size_t i = 0;
+
+#ifdef __SSE2__
+    for (; i + 2 <= FLOW_KEY_WORDS; i += 2) {
+        _mm_storeu_si128((__m128i *)(dw + i),
+                         _mm_and_si128(_mm_loadu_si128((const __m128i *)(kw + i)),
+                                       _mm_loadu_si128((const __m128i *)(mw + i))));
+    }
+#endif
+    for (; i<FLOW_KEY_WORDS; i++) {
+        dw[i] = kw[i] & mw[i];
+    }
+}
+
+void
+flow_key_from_pkt(struct flow_key *key, struct ofl_match_standard *m) {
+    memset(key, 0x00, sizeof(struct flow_key));
+
+    key->in_port      = m->in_port;
+    key->dl_vlan      = m->dl_vlan;
+    key->dl_vlan_pcp  = m->dl_vlan_pcp;
+    key->vlan_present = (m->dl_vlan != OFPVID_NONE);
+    memcpy(key->dl_src, m->dl_src, OFP_ETH_ALEN);
+    memcpy(key->dl_dst, m->dl_dst, OFP_ETH_ALEN);
+    key->dl_type      = m->dl_type;
+    key->nw_tos       = m->nw_tos;
+    key->nw_proto     = m->nw_proto;
+    key->nw_src       = m->nw_src;
+    key->nw_dst       = m->nw_dst;
+    key->tp_src       = m->tp_src;
+    key->tp_dst       = m->tp_dst;
+    key->mpls_label   = m->mpls_label;
+    key->mpls_tc      = m->mpls_tc;
+    key->metadata     = m->metadata;
+}
+
+bool
+flow_key_from_match(struct flow_key *key, struct flow_key *mask,
+                    struct ofl_match_standard *m) {
+    uint32_t w = m->wildcards;
+    size_t i;
+
+    memset(key,  0x00, sizeof(struct flow_key));
+    memset(mask, 0x00, sizeof(struct flow_key));
+
+    if (!wc(w, OFPFW_IN_PORT)) {
+        mask->in_port = 0xffffffff;
+    }
+
+    /* NOTE: OFPVID_ANY matches any tagged packet, which is expressed by the
+     *       vlan_present flag instead of the VLAN id. */
+    if (!wc(w, OFPFW_DL_VLAN)) {
+        if (m->dl_vlan == OFPVID_ANY) {
+            mask->vlan_present = 0xff;
+            key->vlan_present  = 1;
+        } else {
+            mask->dl_vlan = 0xffff;
+        }
+    }
+
+    /* NOTE: PCP is not checked for untagged packets if the match requires
+     *       no VLAN. If VLAN is wildcarded though, a match with OFPVID_NONE
+     *       and a PCP value matches either untagged packets, or packets with
+     *       the given PCP; this cannot be expressed as a mask. */
+    if (!wc(w, OFPFW_DL_VLAN_PCP)) {
+        if (m->dl_vlan == OFPVID_NONE) {
+            if (wc(w, OFPFW_DL_VLAN)) {
+                return false;
+            }
+        } else {
+            mask->dl_vlan_pcp = 0xff;
+        }
+    }
+
+    for (i=0; i<OFP_ETH_ALEN; i++) {
+        mask->dl_src[i] = ~m->dl_src_mask[i];
+        mask->dl_dst[i] = ~m->dl_dst_mask[i];
+    }
+
+    if (!wc(w, OFPFW_DL_TYPE))    { mask->dl_type    = 0xffff; }
+    if (!wc(w, OFPFW_NW_TOS))     { mask->nw_tos     = 0xff; }
+    if (!wc(w, OFPFW_NW_PROTO))   { mask->nw_proto   = 0xff; }
+    if (!wc(w, OFPFW_TP_SRC))     { mask->tp_src     = 0xffff; }
+    if (!wc(w, OFPFW_TP_DST))     { mask->tp_dst     = 0xffff; }
+    if (!wc(w, OFPFW_MPLS_LABEL)) { mask->mpls_label = 0xffffffff; }
+    if (!wc(w, OFPFW_MPLS_TC))    { mask->mpls_tc    = 0xff; }
+
+    mask->nw_src   = ~m->nw_src_mask;
+    mask->nw_dst   = ~m->nw_dst_mask;
+    mask->metadata = ~m->metadata_mask;
+
+    {
+        struct flow_key value;
+
+        flow_key_from_pkt(&value, m);
+        value.vlan_present = key->vlan_present;
+        flow_key_mask(key, &value, mask);
+    }
+
+    return true;
+}
+
+
+/* Returns true if rule a takes precedence over rule b. */
+static inline bool
+rule_precedes(struct cls_rule *a, struct cls_rule *b) {
+    return (b == NULL) ||
+           (a->priority > b->priority) ||
+           (a->priority == b->priority && a->serial < b->serial);
+}
+
+/* Returns the length of a prefix mask in host order. Returns 0 if the mask
+ * is not a prefix, and for full masks: exact addresses are not worth a trie
+ * entry, as they are looked up with a single probe anyway. */
+static uint8_t
+prefix_len(uint32_t mask) {
+    uint8_t len = 0;
+
+    while (len < 32 && (mask & (0x80000000U >> len)) != 0) {
+        len++;
+    }
+    return (len < 32 && (mask << len) == 0) ? len : 0;
+}
+
+static inline uint32_t
+trie_field(const struct flow_key *key, size_t trie) {
+    return ntohl(trie == CLS_TRIE_NW_SRC ? key->nw_src : key->nw_dst);
+}
+
+static inline size_t
+trie_slot(uint32_t addr, unsigned int depth) {
+    return (addr >> (32 - TRIE_STRIDE - depth)) & (TRIE_SLOTS - 1);
+}
+
+/* Counts a prefix ending in the node in or out, and updates the plens of the
+ * covered slots when the first one is added or the last one removed. */
+static void
+trie_node_count(struct cls_trie_node *node, uint32_t addr, unsigned int depth,
+                uint8_t plen, bool add) {
+    unsigned int bits  = plen - depth;
+    unsigned int value = (addr >> (32 - plen)) & ((1 << bits) - 1);
+    uint32_t *count = &node->prefixes[(1 << bits) - 2 + value];
+    size_t first = value << (TRIE_STRIDE - bits);
+    size_t last  = first + (1 << (TRIE_STRIDE - bits));
+    size_t i;
+
+    if (add ? (*count)++ != 0 : --(*count) != 0) {
+        return;
+    }
+    for (i=first; i<last; i++) {
+        if (add) {
+            node->plens[i] |= 1 << (bits - 1);
+        } else {
+            node->plens[i] &= ~(1 << (bits - 1));
+        }
+    }
+}
+
+/* NOTE: lookups may walk the trie concurrently. Nodes are published once
+ *       initialized, and prefixes are added before the rule is visible in
+ *       its subtable. */
+static void
+trie_insert(struct cls_trie_node **root, uint32_t addr, uint8_t plen) {
+    struct cls_trie_node **link = root;
+    unsigned int depth;
+
+    for (depth = 0; ; depth += TRIE_STRIDE) {
+        struct cls_trie_node *node = *link;
+
+        if (node == NULL) {
+            node = xcalloc(1, sizeof(struct cls_trie_node));
+            rcu_barrier();
+            *link = node;
+        }
+        node->refs++;
+
+        if (plen <= depth + TRIE_STRIDE) {
+            trie_node_count(node, addr, depth, plen, true);
+            return;
+        }
+        link = &node->children[trie_slot(addr, depth)];
+    }
+}
+
+/* Removes a prefix; the nodes left without prefixes are unlinked, and
+ * released once no lookup can be walking them. */
+static void
+trie_remove(struct rcu *rcu, struct cls_trie_node **root, uint32_t addr, uint8_t plen) {
+    struct cls_trie_node **link = root;
+    struct cls_trie_node *node = *root;
+    bool unlinked = false;
+    unsigned int depth;
+
+    for (depth = 0; node != NULL; depth += TRIE_STRIDE) {
+        struct cls_trie_node *next = NULL;
+
+        if (plen <= depth + TRIE_STRIDE) {
+            trie_node_count(node, addr, depth, plen, false);
+        } else {
+            next = node->children[trie_slot(addr, depth)];
+        }
+
+        node->refs--;
+        if (node->refs == 0) {
+            if (!unlinked) {
+                *link = NULL;
+                unlinked = true;
+            }
+            rcu_defer(rcu, free, node);
+        } else {
+            link = &node->children[trie_slot(addr, depth)];
+        }
+        node = next;
+    }
+}
+
+/* Returns the lengths of the prefixes matching addr, as a bitmap. Bit 0 is
+ * always set, to tell the result from a trie not walked yet. */
+static uint64_t
+trie_lookup(const struct cls_trie_node *node, uint32_t addr) {
+    uint64_t plens = 1;
+    unsigned int depth;
+
+    for (depth = 0; node != NULL; depth += TRIE_STRIDE) {
+        size_t slot = trie_slot(addr, depth);
+
+        plens |= (uint64_t)node->plens[slot] << (depth + 1);
+        node = node->children[slot];
+    }
+    return plens;
+}
+
+static void
+trie_destroy(struct cls_trie_node *node) {
+    size_t i;
+
+    if (node != NULL) {
+        for (i=0; i<TRIE_SLOTS; i++) {
+            trie_destroy(node->children[i]);
+        }
+        free(node);
+    }
+}
+
+/* Returns true if no rule of the subtable can match the packet, as none of
+ * the prefixes of the subtable's length matches its addresses. The tries are
+ * walked on demand, and the results are kept in plens. */
+static inline bool
+subtable_pruned(struct classifier *cls, struct cls_subtable *st,
+                struct flow_key *pkt_key, uint64_t plens[CLS_TRIES]) {
+    size_t t;
+
+    for (t=0; t<CLS_TRIES; t++) {
+        if (st->plen[t] == 0) {
+            continue;
+        }
+        if (plens[t] == 0) {
+            plens[t] = trie_lookup(cls->tries[t], trie_field(pkt_key, t));
+        }
+        if ((plens[t] & ((uint64_t)1 << st->plen[t])) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static struct cls_subtable *
+find_subtable(struct classifier *cls, struct flow_key *mask, uint32_t hash) {
+    struct hmap_node *node;
+
+    for (node = hmap_first_with_hash(&cls->subtables_map, hash); node != NULL;
+         node = hmap_next_with_hash(node)) {
+        struct cls_subtable *st = CONTAINER_OF(node, struct cls_subtable, hmap_node);
+
+        if (flow_key_equal(&st->mask, mask)) {
+            return st;
+        }
+    }
+    return NULL;
+}
+
+/* Publishes a new snapshot of the subtables, with st added or removed, in
+ * decreasing max_priority order. The old snapshot is released once no
+ * lookup can be using it. */
+static void
+publish_subtables(struct classifier *cls, struct cls_subtable *add, struct cls_subtable *del) {
+    struct cls_subtables *old = cls->subtables;
+    struct cls_subtables *new;
+    size_t i, j;
+
+    new = xmalloc(sizeof(struct cls_subtables) +
+                  (old->subtables_num + 1) * sizeof(struct cls_subtable *));
+    new->subtables_num = 0;
+
+    for (i=0; i<old->subtables_num; i++) {
+        if (old->subtables[i] != del && old->subtables[i] != add) {
+            new->subtables[new->subtables_num++] = old->subtables[i];
+        }
+    }
+    if (add != NULL) {
+        new->subtables[new->subtables_num++] = add;
+    }
+
+    /* insertion sort; stable, and the vector is mostly ordered already. */
+    for (i=1; i<new->subtables_num; i++) {
+        struct cls_subtable *st = new->subtables[i];
+
+        for (j=i; j > 0 && new->subtables[j-1]->max_priority < st->max_priority; j--) {
+            new->subtables[j] = new->subtables[j-1];
+        }
+        new->subtables[j] = st;
+    }
+
+    rcu_barrier();
+    cls->subtables = new;
+    rcu_defer(cls->rcu, free, old);
+}
+
+static struct cls_subtable *
+create_subtable(struct classifier *cls, struct flow_key *mask, uint32_t hash) {
+    struct cls_subtable *st = xmalloc(sizeof(struct cls_subtable));
+    size_t t;
+
+    st->mask         = *mask;
+    for (t=0; t<CLS_TRIES; t++) {
+        st->plen[t] = prefix_len(trie_field(mask, t));
+    }
+    st->rules_num    = 0;
+    st->max_priority = 0;
+    hmap_init(&st->rules);
+
+    hmap_insert(&cls->subtables_map, &st->hmap_node, hash);
+
+    return st;
+}
+
+static void
+free_subtable(void *st_) {
+    struct cls_subtable *st = (struct cls_subtable *)st_;
+
+    hmap_destroy(&st->rules);
+    free(st);
+}
+
+static void
+destroy_subtable(struct classifier *cls, struct cls_subtable *st) {
+    hmap_remove(&cls->subtables_map, &st->hmap_node);
+    publish_subtables(cls, NULL, st);
+    rcu_defer(cls->rcu, free_subtable, st);
+}
+
+static void
+insert_fallback(struct classifier *cls, struct cls_rule *rule) {
+    struct cls_rule *r;
+
+    rule->subtable = NULL;
+
+    LIST_FOR_EACH(r, struct cls_rule, list_node, &cls->fallback) {
+        if (rule_precedes(rule, r)) {
+            rcu_list_insert(&r->list_node, &rule->list_node);
+            return;
+        }
+    }
+    rcu_list_insert(&cls->fallback, &rule->list_node);
+}
+
+static void
+insert_rule(struct classifier *cls, struct cls_rule *rule, struct ofl_match_header *match,
+            uint16_t priority, uint64_t serial) {
+    struct flow_key mask;
+
+    rule->match    = match;
+    rule->priority = priority;
+    rule->serial   = serial;
+    list_init(&rule->list_node);
+
+    if (match != NULL && match->type == OFPMT_STANDARD &&
+        flow_key_from_match(&rule->key, &mask, (struct ofl_match_standard *)match)) {
+        uint32_t mask_hash = flow_key_hash(&mask);
+        struct cls_subtable *st;
+        bool created = false;
+        size_t t;
+
+        st = find_subtable(cls, &mask, mask_hash);
+        if (st == NULL) {
+            st = create_subtable(cls, &mask, mask_hash);
+            created = true;
+        }
+
+        rule->subtable = st;
+        for (t=0; t<CLS_TRIES; t++) {
+            if (st->plen[t] != 0) {
+                trie_insert(&cls->tries[t], trie_field(&rule->key, t), st->plen[t]);
+            }
+        }
+        rcu_hmap_insert(cls->rcu, &st->rules, &rule->hmap_node, flow_key_hash(&rule->key));
+        st->rules_num++;
+
+        /* NOTE: the rule is in place before the subtable becomes visible, or
+         *       before lookups stop pruning it by its old max_priority. */
+        if (created || priority > st->max_priority) {
+            st->max_priority = priority;
+            publish_subtables(cls, created ? st : NULL, NULL);
+        }
+    } else {
+        insert_fallback(cls, rule);
+    }
+
+    cls->rules_num++;
+    rcu_barrier();
+    cls->version++;
+}
+
+void
+classifier_init(struct classifier *cls, struct rcu *rcu) {
+    cls->rcu       = rcu;
+    cls->subtables = xmalloc(sizeof(struct cls_subtables));
+    cls->subtables->subtables_num = 0;
+    hmap_init(&cls->subtables_map);
+    list_init(&cls->fallback);
+    cls->tries[CLS_TRIE_NW_SRC] = NULL;
+    cls->tries[CLS_TRIE_NW_DST] = NULL;
+    cls->next_serial = 0;
+    cls->version     = 0;
+    cls->rules_num   = 0;
+}
+
+void
+classifier_destroy(struct classifier *cls) {
+    size_t i;
+
+    for (i=0; i<cls->subtables->subtables_num; i++) {
+        free_subtable(cls->subtables->subtables[i]);
+    }
+    free(cls->subtables);
+    hmap_destroy(&cls->subtables_map);
+    trie_destroy(cls->tries[CLS_TRIE_NW_SRC]);
+    trie_destroy(cls->tries[CLS_TRIE_NW_DST]);
+}
+
+void
+classifier_insert(struct classifier *cls, struct cls_rule *rule,
+                  struct ofl_match_header *match, uint16_t priority) {
+    insert_rule(cls, rule, match, priority, cls->next_serial++);
+}
+
+void
+classifier_replace(struct classifier *cls, struct cls_rule *old_rule,
+                   struct cls_rule *rule, struct ofl_match_header *match) {
+    /* NOTE: the new rule is inserted first, so concurrent lookups always
+     *       find one of the two. */
+    insert_rule(cls, rule, match, old_rule->priority, old_rule->serial);
+    classifier_remove(cls, old_rule);
+}
+
+void
+classifier_remove(struct classifier *cls, struct cls_rule *rule) {
+    struct cls_subtable *st = rule->subtable;
+    size_t t;
+
+    if (st != NULL) {
+        hmap_remove(&st->rules, &rule->hmap_node);
+        st->rules_num--;
+        for (t=0; t<CLS_TRIES; t++) {
+            if (st->plen[t] != 0) {
+                trie_remove(cls->rcu, &cls->tries[t], trie_field(&rule->key, t), st->plen[t]);
+            }
+        }
+        /* NOTE: max_priority is kept as an upper bound, which is still
+         *       valid for pruning the lookup. */
+        if (st->rules_num == 0) {
+            destroy_subtable(cls, st);
+        }
+        rule->subtable = NULL;
+    } else {
+        list_remove(&rule->list_node);
+    }
+    cls->rules_num--;
+    rcu_barrier();
+    cls->version++;
+}
+
+struct cls_rule *
+classifier_lookup(struct classifier *cls, struct ofl_match_standard *pkt_match) {
+    struct flow_key pkt_key;
+
+    flow_key_from_pkt(&pkt_key, pkt_match);
+    return classifier_lookup_key(cls, &pkt_key, pkt_match);
+}
+
+struct cls_rule *
+classifier_lookup_key(struct classifier *cls, struct flow_key *pkt_key,
+                      struct ofl_match_standard *pkt_match) {
+    struct cls_subtables *subtables = cls->subtables;
+    struct cls_rule *best = NULL;
+    struct cls_rule *rule;
+    uint64_t plens[CLS_TRIES] = {0, 0};
+    size_t i = 0, j, n;
+
+    /* NOTE: subtables are probed in batches of CLS_LOOKAHEAD: the masked keys
+     *       and hashes of a batch are computed first and their buckets
+     *       prefetched, so that the cache misses of the probes overlap. */
+    while (i < subtables->subtables_num) {
+        struct cls_subtable *batch[CLS_LOOKAHEAD];
+        struct flow_key masked[CLS_LOOKAHEAD];
+        uint32_t hash[CLS_LOOKAHEAD];
+
+        for (n=0; n < CLS_LOOKAHEAD && i < subtables->subtables_num; i++) {
+            struct cls_subtable *st = subtables->subtables[i];
+
+            /* subtables are ordered, none of the rest can have a better rule. */
+            if (best != NULL && st->max_priority < best->priority) {
+                break;
+            }
+            if (subtable_pruned(cls, st, pkt_key, plens)) {
+                continue;
+            }
+            batch[n] = st;
+            flow_key_mask(&masked[n], pkt_key, &st->mask);
+            hash[n] = flow_key_hash(&masked[n]);
+            __builtin_prefetch(&st->rules.buckets[hash[n] & st->rules.mask]);
+            n++;
+
+            /* a subtable which passed the tries likely has the best rule,
+             * which would make the rest of the batch a waste. */
+            if (st->plen[CLS_TRIE_NW_SRC] != 0 || st->plen[CLS_TRIE_NW_DST] != 0) {
+                i++;
+                break;
+            }
+        }
+        if (n == 0) {
+            break;
+        }
+
+        for (j=0; j<n; j++) {
+            struct hmap_node *node;
+
+            if (best != NULL && batch[j]->max_priority < best->priority) {
+                break;
+            }
+
+            for (node = hmap_first_with_hash(&batch[j]->rules, hash[j]); node != NULL;
+                 node = hmap_next_with_hash(node)) {
+                rule = CONTAINER_OF(node, struct cls_rule, hmap_node);
+
+                if (flow_key_equal(&rule->key, &masked[j]) && rule_precedes(rule, best)) {
+                    best = rule;
+                }
+            }
+        }
+        if (j < n) {
+            break;
+        }
+    }
+
+    /* fallback rules are ordered, so the first matching one is the best. */
+    LIST_FOR_EACH(rule, struct cls_rule, list_node, &cls->fallback) {
+        if (best != NULL && !rule_precedes(rule, best)) {
+            break;
+        }
+        if (rule->match->type == OFPMT_STANDARD &&
+            match_std_pkt((struct ofl_match_standard *)rule->match, pkt_match)) {
+            best = rule;
+            break;
+        }
+    }
+
+    return best;
+}
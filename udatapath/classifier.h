@@ -0,0 +1,181 @@
+/* Copyright (c) 2011, TrafficLab, Ericsson Research, Hungary
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Ericsson Research nor the names of its
+ *     contributors may be used to endorse or promote products derived from
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CLASSIFIER_H
+#define CLASSIFIER_H 1
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "hmap.h"
+#include "list.h"
+#include "rcu.h"
+#include "util.h"
+#include "oflib/ofl-structs.h"
+
+
+/****************************************************************************
+ * Tuple space search classifier for standard matches. Flow entries are
+ * grouped into subtables by their wildcard/mask signature; within a subtable
+ * entries are hashed on their masked key, so a lookup costs one hash probe
+ * per distinct signature instead of one match per entry.
+ *
+ * The nw_src/nw_dst prefixes of the rules are also kept in tries. A lookup
+ * walks them for the packet's addresses, and skips the subtables whose
+ * prefix length has no matching prefix; so a routing table with a subtable
+ * per prefix length is looked up in a trie walk and a probe or two.
+ ****************************************************************************/
+
+struct cls_trie_node;
+
+/* Packed representation of the fields of a standard match. The same layout
+ * is used for the values and the masks (a set mask bit means the bit is
+ * significant), so masking and comparison can be done word by word. */
+struct flow_key {
+    uint32_t   in_port;
+    uint16_t   dl_vlan;
+    uint8_t    dl_vlan_pcp;
+    uint8_t    vlan_present;    /* 1 if the packet has a VLAN tag; only used
+                                   for matching on OFPVID_ANY. */
+    uint8_t    dl_src[OFP_ETH_ALEN];
+    uint8_t    dl_dst[OFP_ETH_ALEN];
+    uint16_t   dl_type;
+    uint8_t    nw_tos;
+    uint8_t    nw_proto;
+    uint32_t   nw_src;
+    uint32_t   nw_dst;
+    uint16_t   tp_src;
+    uint16_t   tp_dst;
+    uint32_t   mpls_label;
+    uint8_t    mpls_tc;
+    uint8_t    pad[7];
+    uint64_t   metadata;
+};
+
+#define FLOW_KEY_WORDS 7
+BUILD_ASSERT_DECL(sizeof(struct flow_key) == FLOW_KEY_WORDS * sizeof(uint64_t));
+
+/* Fields whose IPv4 prefixes are indexed in tries. */
+#define CLS_TRIE_NW_SRC 0
+#define CLS_TRIE_NW_DST 1
+#define CLS_TRIES       2
+
+/* A group of rules sharing the same mask. */
+struct cls_subtable {
+    struct hmap_node  hmap_node;    /* node in classifier's mask index. */
+    struct flow_key   mask;
+    uint8_t           plen[CLS_TRIES]; /* prefix length of the trie fields in
+                                          the mask; 0 if not a prefix. */
+    struct hmap       rules;        /* rules hashed on their masked key. */
+    size_t            rules_num;
+    uint16_t          max_priority; /* upper bound of the rules' priorities. */
+};
+
+/* A classifier rule; to be embedded in the structure being classified. */
+struct cls_rule {
+    struct hmap_node         hmap_node; /* node in subtable's rules. */
+    struct list              list_node; /* node in classifier's fallback list. */
+    struct cls_subtable     *subtable;  /* NULL, if the rule is in the fallback list. */
+    struct ofl_match_header *match;
+    struct flow_key          key;       /* masked match key. */
+    uint16_t                 priority;
+    uint64_t                 serial;    /* insertion order, breaks priority ties. */
+};
+
+/* An immutable snapshot of the subtables, in decreasing max_priority order.
+ * It is replaced as a whole when subtables are added, removed or reordered. */
+struct cls_subtables {
+    size_t                subtables_num;
+    struct cls_subtable  *subtables[];
+};
+
+/* A classifier. Lookups may run concurrently with modifications, if the
+ * readers are registered with the given rcu. */
+struct classifier {
+    struct rcu            *rcu;
+    struct cls_subtables  *subtables;
+    struct hmap   subtables_map;  /* subtables indexed by their mask. */
+    struct list   fallback;       /* rules which cannot be expressed by a mask,
+                                     in priority and insertion order. */
+    struct cls_trie_node *tries[CLS_TRIES]; /* IPv4 prefixes of the rules in
+                                               prefix subtables. */
+    uint64_t      next_serial;
+    uint64_t      version;        /* advanced on every change of the rule set. */
+    size_t        rules_num;
+};
+
+/* Initializes an empty classifier. Removed rules and internal structures are
+ * released through rcu, which may be NULL. */
+void
+classifier_init(struct classifier *cls, struct rcu *rcu);
+
+/* Destroys the classifier. The rules themselves are owned by the caller.
+ * There must be no concurrent lookups. */
+void
+classifier_destroy(struct classifier *cls);
+
+/* Inserts the rule with the given match and priority. The match must remain
+ * valid while the rule is in the classifier. */
+void
+classifier_insert(struct classifier *cls, struct cls_rule *rule,
+                  struct ofl_match_header *match, uint16_t priority);
+
+/* Replaces old_rule with rule, which takes over its position among rules of
+ * equal priority. */
+void
+classifier_replace(struct classifier *cls, struct cls_rule *old_rule,
+                   struct cls_rule *rule, struct ofl_match_header *match);
+
+/* Removes the rule from the classifier. Concurrent lookups may still return
+ * the rule until the next grace period of rcu. */
+void
+classifier_remove(struct classifier *cls, struct cls_rule *rule);
+
+/* Returns the highest priority rule matching the fields extracted from a
+ * packet, or NULL if there is none. Among rules of equal priority the one
+ * inserted first wins. */
+struct cls_rule *
+classifier_lookup(struct classifier *cls, struct ofl_match_standard *pkt_match);
+
+/* Same as classifier_lookup, with the packed key of the packet fields already
+ * at hand. */
+struct cls_rule *
+classifier_lookup_key(struct classifier *cls, struct flow_key *pkt_key,
+                      struct ofl_match_standard *pkt_match);
+
+/* Fills in the packed key of the fields extracted from a packet. */
+void
+flow_key_from_pkt(struct flow_key *key, struct ofl_match_standard *pkt_match);
+
+/* Converts a flow match to a packed key and mask. Returns false if the match
+ * cannot be represented as a plain masked comparison. */
+bool
+flow_key_from_match(struct flow_key *key, struct flow_key *mask,
+                    struct ofl_match_standard *match);
+
+
+#endif /* CLASSIFIER_H */
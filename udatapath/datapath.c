@@ -45,6 +45,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include "classifier.h"
 #include "csum.h"
 #include "dp_buffers.h"
 #include "dp_control.h"
@@ -52,6 +53,10 @@
 #include "ofp.h"
 #include "ofpbuf.h"
 #include "group_table.h"
+#include "hash.h"
+#include "hmap.h"
+#include "packet.h"
+#include "packet_handle_std.h"
 #include "oflib/ofl.h"
 #include "oflib-exp/ofl-exp.h"
 #include "oflib-exp/ofl-exp-nicira.h"
@@ -65,6 +70,7 @@
 #include "poll-loop.h"
 #include "rconn.h"
 #include "stp.h"
+#include "timer_wheel.h"
 #include "vconn.h"
 #include "xtoxll.h"
 
@@ -77,6 +83,9 @@ static struct remote *remote_create(struct datapath *, struct rconn *);
 static void remote_run(struct datapath *, struct remote *);
 static void remote_wait(struct remote *);
 static void remote_destroy(struct remote *);
+static void remote_start_dump(struct remote *,
+                              int (*cb_dump)(struct datapath *, void *),
+                              void (*cb_done)(void *), void *);
 
 
 #define MFR_DESC     "Stanford University and Ericsson Research"
@@ -99,6 +108,8 @@ struct remote {
     struct rconn *rconn;
 #define TXQ_LIMIT 128           /* Max number of packets to queue for tx. */
     int n_txq;                  /* Number of packets queued for tx on rconn. */
+#define PKTIN_TXQ_LIMIT 16      /* Max number of packet in batches to queue. */
+    int n_pktin_txq;            /* Number of packet in batches queued on rconn. */
 
     /* Support for reliable, multi-message replies to requests.
      *
@@ -113,6 +124,36 @@ struct remote {
 };
 
 
+/* A reply of multiple messages in progress; see dp_start_dump(). */
+struct dump {
+    struct sender sender;
+    int (*dump)(struct datapath *, const struct sender *, void *aux);
+    void (*done)(void *aux);
+    void *aux;
+};
+
+
+/* Packet ins are packed into a batch, which is written to the remotes in one
+ * go once it reaches this size, at the end of dp_run(), or before any other
+ * message is sent, so that the order of messages is kept. */
+#define PKTIN_BATCH_BYTES  (64 * 1024)
+
+/* Maximum number of flows whose table misses are suppressed. */
+#define PKTIN_FLOWS_MAX    4096
+
+/* A flow whose table miss was recently sent to the remotes. */
+struct pktin_flow {
+    struct hmap_node node;
+    struct flow_key  key;
+    uint8_t          table_id;
+    uint64_t         expires;   /* time until repeated misses are suppressed. */
+};
+
+static void pktins_flush(struct datapath *);
+static void send_packet_in(struct datapath *, struct packet *, uint8_t table_id,
+                           uint8_t reason, uint16_t max_len);
+
+
 /* Callbacks for processing experimenter messages in OFLib. */
 static struct ofl_exp_msg dp_exp_msg =
         {.pack      = ofl_exp_msg_pack,
@@ -156,7 +197,6 @@ dp_new(void) {
 
     dp->id = gen_datapath_id();
 
-    dp->last_timeout = time_now();
     list_init(&dp->remotes);
     dp->listeners = NULL;
     dp->n_listeners = 0;
@@ -164,13 +204,25 @@ dp_new(void) {
     memset(dp->ports, 0x00, sizeof (dp->ports));
     dp->local_port = NULL;
 
+    rcu_init(&dp->rcu);
+    ofl_arena_init(&dp->arena, OFL_ARENA_CHUNK_SIZE);
+
     dp->buffers = dp_buffers_create(dp);
     dp->pipeline = pipeline_create(dp);
     dp->groups = group_table_create(dp);
 
     list_init(&dp->port_list);
     dp->ports_num = 0;
+    dp->port_monitor = NULL;
     dp->max_queues = NETDEV_MAX_QUEUES;
+    dp->rx_batch   = DP_RX_BATCH;
+    dp->pktins     = NULL;
+    dp->pktin_suppress = 0;
+    hmap_init(&dp->pktin_flows);
+    dp->select_hash = false;
+    dp->ratelimit  = NULL;
+    memset(&dp->tx, 0x00, sizeof(dp->tx));
+    dp->workers    = NULL;
 
     dp->exp = &dp_exp;
 
@@ -203,17 +255,33 @@ dp_add_pvconn(struct datapath *dp, struct pvconn *pvconn) {
 
 void
 dp_run(struct datapath *dp) {
-    time_t now = time_now();
     struct remote *r, *rn;
     size_t i;
 
-    if (now != dp->last_timeout) {
-        dp->last_timeout = now;
-        pipeline_timeout(dp->pipeline);
-    }
-    poll_timer_wait(1000);
+    /* packets processed outside of a received batch, e.g. packet outs to
+       the pipeline, use the clock stamped here. */
+    dp_workers_clock_update();
+
+    pipeline_timeout(dp->pipeline);
+    poll_timer_wait(TIMER_WHEEL_TICK_MS);
 
-    dp_ports_run(dp);
+    /* with worker threads, ports are served by the workers. */
+    if (dp->workers == NULL) {
+        dp_ports_run(dp);
+    }
+    dp_workers_run(dp);
+    dp_ports_monitor_run(dp);
+    if (dp->ratelimit != NULL) {
+        struct dp_pktin *pi;
+
+        /* limit the number of packet ins sent at once, so other work is
+           not held up. */
+        for (i = 0; i < 50 && (pi = dp_ratelimit_dequeue(dp->ratelimit)) != NULL; i++) {
+            send_packet_in(dp, pi->pkt, pi->table_id, pi->reason, pi->max_len);
+            packet_destroy(pi->pkt);
+            free(pi);
+        }
+    }
 
     /* Talk to remotes. */
     LIST_FOR_EACH_SAFE (r, rn, struct remote, node, &dp->remotes) {
@@ -233,6 +301,12 @@ dp_run(struct datapath *dp) {
         }
         i++;
     }
+
+    /* Send out the packets generated by control messages. */
+    dp_ports_flush(dp);
+    pktins_flush(dp);
+
+    rcu_run(&dp->rcu);
 }
 
 static void
@@ -258,7 +332,10 @@ remote_run(struct datapath *dp, struct remote *r)
 
                 struct sender sender = {.remote = r};
 
-                error = ofl_msg_unpack(buffer->data, buffer->size, &msg, &(sender.xid), dp->exp);
+                /* NOTE: handlers promote the parts of the message they keep,
+                 *       so the whole message is released with the arena. */
+                error = ofl_msg_unpack_arena(buffer->data, buffer->size, &msg,
+                                             &(sender.xid), &dp->arena, dp->exp);
 
                 if (!error) {
                     error = handle_control_msg(dp, msg, &sender);
@@ -278,6 +355,7 @@ remote_run(struct datapath *dp, struct remote *r)
                     dp_send_message(dp, (struct ofl_msg_header *)&err, &sender);
                 }
 
+                ofl_arena_clear(&dp->arena);
                 ofpbuf_delete(buffer);
             }
         } else {
@@ -322,6 +400,46 @@ remote_destroy(struct remote *r)
     }
 }
 
+static void
+remote_start_dump(struct remote *remote,
+                  int (*cb_dump)(struct datapath *, void *),
+                  void (*cb_done)(void *), void *aux)
+{
+    assert(!remote->cb_dump);
+    remote->cb_dump = cb_dump;
+    remote->cb_done = cb_done;
+    remote->cb_aux = aux;
+}
+
+static int
+dump_run(struct datapath *dp, void *dump_) {
+    struct dump *dump = (struct dump *)dump_;
+
+    return dump->dump(dp, &dump->sender, dump->aux);
+}
+
+static void
+dump_done(void *dump_) {
+    struct dump *dump = (struct dump *)dump_;
+
+    dump->done(dump->aux);
+    free(dump);
+}
+
+void
+dp_start_dump(struct datapath *dp UNUSED, const struct sender *sender,
+              int (*dump_fn)(struct datapath *, const struct sender *, void *aux),
+              void (*done)(void *aux), void *aux) {
+    struct dump *dump = xmalloc(sizeof(struct dump));
+
+    dump->sender = *sender;
+    dump->dump   = dump_fn;
+    dump->done   = done;
+    dump->aux    = aux;
+
+    remote_start_dump(sender->remote, dump_run, dump_done, dump);
+}
+
 static struct remote *
 remote_create(struct datapath *dp, struct rconn *rconn)
 {
@@ -330,6 +448,7 @@ remote_create(struct datapath *dp, struct rconn *rconn)
     remote->rconn = rconn;
     remote->cb_dump = NULL;
     remote->n_txq = 0;
+    remote->n_pktin_txq = 0;
     remote->role = NX_ROLE_OTHER;
     return remote;
 }
@@ -343,11 +462,16 @@ dp_wait(struct datapath *dp)
     size_t i;
 
     LIST_FOR_EACH (p, struct sw_port, node, &dp->port_list) {
-        if (IS_HW_PORT(p)) {
+        if (IS_HW_PORT(p) || dp->workers != NULL) {
             continue;
         }
         netdev_recv_wait(p->netdev);
     }
+    dp_workers_wait(dp);
+    dp_ports_monitor_wait(dp);
+    if (dp->ratelimit != NULL) {
+        dp_ratelimit_wait(dp->ratelimit);
+    }
     LIST_FOR_EACH (r, struct remote, node, &dp->remotes) {
         remote_wait(r);
     }
@@ -396,6 +520,36 @@ dp_set_max_queues(struct datapath *dp, uint32_t max_queues) {
     dp->max_queues = max_queues;
 }
 
+void
+dp_set_rx_batch(struct datapath *dp, size_t rx_batch) {
+    dp->rx_batch = rx_batch;
+}
+
+void
+dp_set_pktin_suppress(struct datapath *dp, uint32_t msec) {
+    dp->pktin_suppress = msec;
+}
+
+void
+dp_set_select_hash(struct datapath *dp, bool select_hash) {
+    dp->select_hash = select_hash;
+}
+
+void
+dp_set_pktin_rate(struct datapath *dp, uint32_t rate, uint32_t burst) {
+    dp->ratelimit = dp_ratelimit_create(dp, rate, burst);
+}
+
+void
+dp_set_buffers(struct datapath *dp, size_t buffers_num) {
+    dp_buffers_set_size(dp->buffers, buffers_num);
+}
+
+void
+dp_set_buffers_mem(struct datapath *dp, size_t mem_max) {
+    dp_buffers_set_mem(dp->buffers, mem_max);
+}
+
 
 static int
 send_openflow_buffer_to_remote(struct ofpbuf *buffer, struct remote *remote) {
@@ -412,6 +566,7 @@ static int
 send_openflow_buffer(struct datapath *dp, struct ofpbuf *buffer,
                      const struct sender *sender) {
     update_openflow_length(buffer);
+    pktins_flush(dp);
     if (sender) {
         /* Send back to the sender. */
         return send_openflow_buffer_to_remote(buffer, sender->remote);
@@ -424,7 +579,7 @@ send_openflow_buffer(struct datapath *dp, struct ofpbuf *buffer,
                 continue;
             }
             if (prev) {
-                send_openflow_buffer_to_remote(ofpbuf_clone(buffer), prev);
+                send_openflow_buffer_to_remote(ofpbuf_share(buffer), prev);
             }
             prev = r;
         }
@@ -440,7 +595,7 @@ send_openflow_buffer(struct datapath *dp, struct ofpbuf *buffer,
 int
 dp_send_message(struct datapath *dp, struct ofl_msg_header *msg,
                      const struct sender *sender) {
-    struct ofpbuf *ofpbuf;
+    struct ofpbuf *ofpbuf = NULL;
     uint8_t *buf;
     size_t buf_size;
     int error;
@@ -451,27 +606,192 @@ dp_send_message(struct datapath *dp, struct ofl_msg_header *msg,
         free(msg_str);
     }
 
-    error = ofl_msg_pack(msg, sender == NULL ? 0 : sender->xid, &buf, &buf_size, dp->exp);
+    /* NOTE: messages of known length are packed into the buffer directly;
+     *       the rest are packed by OFLib, and the buffer takes their memory. */
+    buf_size = ofl_msg_pack_length(msg, dp->exp);
+    if (buf_size > 0) {
+        ofpbuf = ofpbuf_new(buf_size);
+        buf = ofpbuf_put_uninit(ofpbuf, buf_size);
+        error = ofl_msg_pack_to(msg, sender == NULL ? 0 : sender->xid, buf, buf_size, dp->exp);
+    } else {
+        error = ofl_msg_pack(msg, sender == NULL ? 0 : sender->xid, &buf, &buf_size, dp->exp);
+        if (!error) {
+            ofpbuf = ofpbuf_new(0);
+            ofpbuf_use(ofpbuf, buf, buf_size);
+            ofpbuf_put_uninit(ofpbuf, buf_size);
+        }
+    }
     if (error) {
         VLOG_WARN_RL(LOG_MODULE, &rl, "There was an error packing the message!");
+        if (ofpbuf != NULL) {
+            ofpbuf_delete(ofpbuf);
+        }
         return error;
     }
 
-    ofpbuf = ofpbuf_new(0);
-    ofpbuf_use(ofpbuf, buf, buf_size);
-    ofpbuf_put_uninit(ofpbuf, buf_size);
-
     error = send_openflow_buffer(dp, ofpbuf, sender);
     if (error) {
         VLOG_WARN_RL(LOG_MODULE, &rl, "There was an error sending the message!");
-        /* TODO Zoltan: is delete needed? */
-        ofpbuf_delete(ofpbuf);
+        /* NOTE: the buffer is always destroyed by the rconn. */
         return error;
     }
 
     return 0;
 }
 
+/* Writes the batch of packet ins to the remotes. */
+static void
+pktins_flush(struct datapath *dp) {
+    struct ofpbuf *batch = dp->pktins;
+    struct remote *r, *prev = NULL;
+
+    if (batch == NULL) {
+        return;
+    }
+    dp->pktins = NULL;
+
+    /* NOTE: packet ins are queued on their own budget, so that a remote
+     *       flooded with them still gets the replies to its requests. */
+    LIST_FOR_EACH (r, struct remote, node, &dp->remotes) {
+        /* do not send to remotes with slave role */
+        if (r->role == NX_ROLE_SLAVE) {
+            continue;
+        }
+        if (prev) {
+            if (rconn_send_with_limit(prev->rconn, ofpbuf_share(batch), &prev->n_pktin_txq,
+                                      PKTIN_TXQ_LIMIT) == EAGAIN) {
+                VLOG_DBG_RL(LOG_MODULE, &rl, "dropping packet ins to %s.",
+                            rconn_get_name(prev->rconn));
+            }
+        }
+        prev = r;
+    }
+    if (prev) {
+        if (rconn_send_with_limit(prev->rconn, batch, &prev->n_pktin_txq,
+                                  PKTIN_TXQ_LIMIT) == EAGAIN) {
+            VLOG_DBG_RL(LOG_MODULE, &rl, "dropping packet ins to %s.",
+                        rconn_get_name(prev->rconn));
+        }
+    } else {
+        ofpbuf_delete(batch);
+    }
+}
+
+/* Packs the packet in message into the batch. */
+static void
+pktins_add(struct datapath *dp, struct ofl_msg_packet_in *msg) {
+    size_t buf_size;
+
+    if (VLOG_IS_DBG_ENABLED(LOG_MODULE)) {
+        char *msg_str = ofl_msg_to_string((struct ofl_msg_header *)msg, dp->exp);
+        VLOG_DBG_RL(LOG_MODULE, &rl, "sending: %s", msg_str);
+        free(msg_str);
+    }
+
+    if (dp->pktins == NULL) {
+        dp->pktins = ofpbuf_new(PKTIN_BATCH_BYTES);
+    }
+    /* the message is packed right at the end of the batch. */
+    buf_size = ofl_msg_pack_length((struct ofl_msg_header *)msg, dp->exp);
+    ofl_msg_pack_to((struct ofl_msg_header *)msg, 0, ofpbuf_put_uninit(dp->pktins, buf_size),
+                    buf_size, dp->exp);
+
+    if (dp->pktins->size >= PKTIN_BATCH_BYTES) {
+        pktins_flush(dp);
+    }
+}
+
+/* Returns true if a table miss of the same flow in the same table was sent
+ * recently, and no flow mod was received since. Otherwise remembers the
+ * flow, and returns false. */
+static bool
+pktin_suppressed(struct datapath *dp, struct packet *pkt, uint8_t table_id) {
+    struct pktin_flow *f;
+    struct flow_key key;
+    uint64_t now = time_msec();
+    uint32_t hash;
+
+    packet_handle_std_validate(pkt->handle_std);
+    flow_key_from_pkt(&key, pkt->handle_std->match);
+    hash = hash_words((const uint32_t *)&key, sizeof(struct flow_key) / sizeof(uint32_t), table_id);
+
+    HMAP_FOR_EACH_WITH_HASH (f, struct pktin_flow, node, hash, &dp->pktin_flows) {
+        if (f->table_id == table_id && memcmp(&f->key, &key, sizeof(struct flow_key)) == 0) {
+            if (now < f->expires) {
+                return true;
+            }
+            f->expires = now + dp->pktin_suppress;
+            return false;
+        }
+    }
+
+    if (hmap_count(&dp->pktin_flows) >= PKTIN_FLOWS_MAX) {
+        dp_pktin_flows_clear(dp);
+    }
+    f = xmalloc(sizeof(struct pktin_flow));
+    f->key      = key;
+    f->table_id = table_id;
+    f->expires  = now + dp->pktin_suppress;
+    hmap_insert(&dp->pktin_flows, &f->node, hash);
+    return false;
+}
+
+void
+dp_pktin_flows_clear(struct datapath *dp) {
+    struct pktin_flow *f, *next;
+
+    HMAP_FOR_EACH_SAFE (f, next, struct pktin_flow, node, &dp->pktin_flows) {
+        hmap_remove(&dp->pktin_flows, &f->node);
+        free(f);
+    }
+}
+
+void
+dp_send_packet_in(struct datapath *dp, struct packet *pkt, uint8_t table_id,
+                  uint8_t reason, uint16_t max_len) {
+    if (dp_workers_current() != NULL) {
+        dp_workers_packet_in(dp, packet_clone(pkt), table_id, reason, max_len);
+        return;
+    }
+
+    if (reason == OFPR_NO_MATCH && dp->pktin_suppress != 0 &&
+        pktin_suppressed(dp, pkt, table_id)) {
+        VLOG_DBG_RL(LOG_MODULE, &rl, "Suppressing repeated table miss in table %u.", table_id);
+        return;
+    }
+
+    /* NOTE: like in secchan, packet ins generated by actions the controller
+     *       set up are not limited. */
+    if (reason == OFPR_NO_MATCH && dp->ratelimit != NULL &&
+        !dp_ratelimit_admit(dp->ratelimit, pkt, table_id, reason, max_len)) {
+        return;
+    }
+
+    send_packet_in(dp, pkt, table_id, reason, max_len);
+}
+
+/* Saves the packet in a buffer, and adds the packet in to the batch. */
+static void
+send_packet_in(struct datapath *dp, struct packet *pkt, uint8_t table_id,
+               uint8_t reason, uint16_t max_len) {
+    dp_buffers_save(dp->buffers, pkt);
+
+    {
+        struct ofl_msg_packet_in msg =
+                {{.type = OFPT_PACKET_IN},
+                 .buffer_id   = pkt->buffer_id,
+                 .in_port     = pkt->in_port,
+                 .in_phy_port = pkt->in_port, // TODO: how to get phy port for v.port?
+                 .total_len   = pkt->buffer->size,
+                 .reason      = reason,
+                 .table_id    = table_id,
+                 .data_length = MIN(max_len, pkt->buffer->size),
+                 .data        = pkt->buffer->data};
+
+        pktins_add(dp, &msg);
+    }
+}
+
 ofl_err
 dp_handle_set_desc(struct datapath *dp, struct ofl_exp_openflow_msg_set_dp_desc *msg,
                                             const struct sender *sender UNUSED) {
@@ -480,6 +800,29 @@ dp_handle_set_desc(struct datapath *dp, struct ofl_exp_openflow_msg_set_dp_desc
     return 0;
 }
 
+ofl_err
+dp_handle_pktin_rate_request(struct datapath *dp, struct ofl_exp_openflow_msg_header *msg,
+                                            const struct sender *sender) {
+    struct ofl_exp_openflow_msg_pktin_rate reply =
+            {{{{.type = OFPT_EXPERIMENTER},
+               .experimenter_id = OPENFLOW_VENDOR_ID},
+              .type = OFP_EXT_PKTIN_RATE_REPLY},
+             .normal  = 0,
+             .limited = 0,
+             .dropped = 0};
+
+    if (dp->ratelimit != NULL) {
+        reply.normal  = dp->ratelimit->normal;
+        reply.limited = dp->ratelimit->limited;
+        reply.dropped = dp->ratelimit->dropped;
+    }
+
+    dp_send_message(dp, (struct ofl_msg_header *)&reply, sender);
+
+    ofl_msg_free((struct ofl_msg_header *)msg, dp->exp);
+    return 0;
+}
+
 ofl_err
 dp_handle_nx_role(struct datapath *dp, struct ofl_exp_nicira_msg_role *msg,
                                             const struct sender *sender) {
@@ -45,13 +45,18 @@
 #include <stdint.h>
 #include "dp_buffers.h"
 #include "dp_ports.h"
+#include "dp_ratelimit.h"
+#include "dp_workers.h"
+#include "rcu.h"
 #include "openflow/nicira-ext.h"
 #include "ofpbuf.h"
 #include "oflib/ofl.h"
+#include "oflib/ofl-arena.h"
 #include "oflib/ofl-messages.h"
 #include "oflib/ofl-structs.h"
 #include "oflib-exp/ofl-exp-nicira.h"
 #include "group_table.h"
+#include "hmap.h"
 #include "timeval.h"
 #include "list.h"
 
@@ -82,8 +87,6 @@ struct datapath {
     struct pvconn **listeners;
     size_t n_listeners;
 
-    time_t last_timeout;
-
     struct dp_buffers *buffers;
 
     struct pipeline *pipeline;  /* Pipeline with multi-tables. */
@@ -95,10 +98,27 @@ struct datapath {
     /* Switch ports. */
     /* NOTE: ports are numbered starting at 1 in OF 1.1 */
     uint32_t         max_queues; /* used when creating ports */
+    size_t           rx_batch;   /* max packets received per port per run. */
+    struct dp_tx_batch tx;       /* output frames waiting to be sent. */
+    struct dp_workers *workers;  /* worker threads; NULL if single threaded. */
+    struct ofpbuf   *pktins;     /* packet ins packed since the last write to
+                                    the remotes; NULL if there are none. */
+    uint32_t         pktin_suppress; /* time repeated table misses of a flow are
+                                        suppressed for in ms; 0 if disabled. */
+    struct hmap      pktin_flows; /* flows of recent table miss packet ins. */
+    bool             select_hash; /* select groups choose buckets by the flow of
+                                     packets, instead of round robin. */
+    struct dp_ratelimit *ratelimit; /* limits table miss packet ins; NULL if
+                                       they are not limited. */
+    struct rcu       rcu;        /* defers freeing state used by the workers. */
+    struct ofl_arena arena;      /* received control messages are unpacked
+                                    into; cleared after each message. */
     struct sw_port   ports[DP_MAX_PORTS + 1];
     struct sw_port  *local_port;  /* OFPP_LOCAL port, if any. */
     struct list      port_list; /* All ports, including local_port. */
     size_t           ports_num;
+    struct netdev_monitor *port_monitor; /* reports link changes of the
+                                            ports; NULL if not available. */
 
     /* Experimenter handling. */
     struct ofl_exp  *exp;
@@ -154,6 +174,28 @@ dp_set_serial_num(struct datapath *dp, char *serial_num);
 void
 dp_set_max_queues(struct datapath *dp, uint32_t max_queues);
 
+void
+dp_set_rx_batch(struct datapath *dp, size_t rx_batch);
+
+void
+dp_set_pktin_suppress(struct datapath *dp, uint32_t msec);
+
+/* Makes select groups choose buckets by hashing the flow of packets. Must be
+ * called before any group is created. */
+void
+dp_set_select_hash(struct datapath *dp, bool select_hash);
+
+/* Limits table miss packet ins to rate per second, queueing up to burst of
+ * them. */
+void
+dp_set_pktin_rate(struct datapath *dp, uint32_t rate, uint32_t burst);
+
+void
+dp_set_buffers(struct datapath *dp, size_t buffers_num);
+
+void
+dp_set_buffers_mem(struct datapath *dp, size_t mem_max);
+
 
 /* Sends the given OFLib message to the connection represented by sender,
  * or to all open connections, if sender is null. */
@@ -161,6 +203,35 @@ int
 dp_send_message(struct datapath *dp, struct ofl_msg_header *msg,
                      const struct sender *sender);
 
+/* Multipart stats replies are split into messages of at most this size. */
+#define DP_STATS_REPLY_MAX  UINT16_MAX
+
+/* Starts a reply of multiple messages to the sender of a request. The dump
+ * function is called whenever the connection of the sender has room for more
+ * messages; it returns a positive value while there is more to send, zero
+ * when the reply is complete, or a negative errno value on failure. The done
+ * function is called after that, or if the connection is closed, to free aux.
+ * No further messages of the sender are handled until the reply completes. */
+void
+dp_start_dump(struct datapath *dp, const struct sender *sender,
+              int (*dump)(struct datapath *, const struct sender *, void *aux),
+              void (*done)(void *aux), void *aux);
+
+/* Saves the packet in a buffer, and sends it to all open connections in a
+ * packet in message. Packet ins are batched, and written to the remotes
+ * together. If suppression is enabled, repeated table misses of a flow are
+ * not sent until a flow mod is received. On worker threads a copy of the
+ * packet is queued for the control thread instead. The caller keeps
+ * ownership of pkt. */
+void
+dp_send_packet_in(struct datapath *dp, struct packet *pkt, uint8_t table_id,
+                  uint8_t reason, uint16_t max_len);
+
+/* Forgets the flows whose table misses are suppressed. Called when a flow mod
+ * may have installed an entry for them. */
+void
+dp_pktin_flows_clear(struct datapath *dp);
+
 
 
 /* Handles a set description (openflow experimenter) message */
@@ -168,6 +239,11 @@ ofl_err
 dp_handle_set_desc(struct datapath *dp, struct ofl_exp_openflow_msg_set_dp_desc *msg,
                                             const struct sender *sender);
 
+/* Handles a packet in rate limiter counters (openflow experimenter) request */
+ofl_err
+dp_handle_pktin_rate_request(struct datapath *dp, struct ofl_exp_openflow_msg_header *msg,
+                                            const struct sender *sender);
+
 /* Handles a role request (nicira experimenter) message */
 ofl_err
 dp_handle_nx_role(struct datapath *dp, struct ofl_exp_nicira_msg_role *msg,
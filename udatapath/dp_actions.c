@@ -67,7 +67,7 @@ output(struct packet *pkt, struct ofl_action_output *action) {
 /* Executes a set vlan vid action. */
 static void
 set_vlan_vid(struct packet *pkt, struct ofl_action_vlan_vid *act) {
-    packet_handle_std_validate(pkt->handle_std);
+    packet_handle_std_parse(pkt->handle_std, PACKET_LAYER_L2);
     if (pkt->handle_std->proto->vlan != NULL) {
         struct vlan_header *vlan = pkt->handle_std->proto->vlan;
 
@@ -83,7 +83,7 @@ set_vlan_vid(struct packet *pkt, struct ofl_action_vlan_vid *act) {
 /* Executes set vlan pcp action. */
 static void
 set_vlan_pcp(struct packet *pkt, struct ofl_action_vlan_pcp *act) {
-    packet_handle_std_validate(pkt->handle_std);
+    packet_handle_std_parse(pkt->handle_std, PACKET_LAYER_L2);
     if (pkt->handle_std->proto->vlan != NULL) {
         struct vlan_header *vlan = pkt->handle_std->proto->vlan;
 
@@ -98,7 +98,7 @@ set_vlan_pcp(struct packet *pkt, struct ofl_action_vlan_pcp *act) {
 /* Executes set dl src action. */
 static void
 set_dl_src(struct packet *pkt, struct ofl_action_dl_addr *act) {
-    packet_handle_std_validate(pkt->handle_std);
+    packet_handle_std_parse(pkt->handle_std, PACKET_LAYER_L2);
     if (pkt->handle_std->proto->eth != NULL) {
         struct eth_header *eth = pkt->handle_std->proto->eth;
 
@@ -113,7 +113,7 @@ set_dl_src(struct packet *pkt, struct ofl_action_dl_addr *act) {
 /* Executes set dl dst action. */
 static void
 set_dl_dst(struct packet *pkt, struct ofl_action_dl_addr *act) {
-    packet_handle_std_validate(pkt->handle_std);
+    packet_handle_std_parse(pkt->handle_std, PACKET_LAYER_L2);
     if (pkt->handle_std->proto->eth != NULL) {
         struct eth_header *eth = pkt->handle_std->proto->eth;
 
@@ -128,7 +128,7 @@ set_dl_dst(struct packet *pkt, struct ofl_action_dl_addr *act) {
 /* Executes set nw src action. */
 static void
 set_nw_src(struct packet *pkt, struct ofl_action_nw_addr *act) {
-    packet_handle_std_validate(pkt->handle_std);
+    packet_handle_std_parse(pkt->handle_std, PACKET_LAYER_L4);
     if (pkt->handle_std->proto->ipv4 != NULL) {
         struct ip_header *ipv4 = pkt->handle_std->proto->ipv4;
 
@@ -156,7 +156,7 @@ set_nw_src(struct packet *pkt, struct ofl_action_nw_addr *act) {
 /* Executes set nw dst action. */
 static void
 set_nw_dst(struct packet *pkt, struct ofl_action_nw_addr *act) {
-    packet_handle_std_validate(pkt->handle_std);
+    packet_handle_std_parse(pkt->handle_std, PACKET_LAYER_L4);
     if (pkt->handle_std->proto->ipv4 != NULL) {
         struct ip_header *ipv4 = pkt->handle_std->proto->ipv4;
 
@@ -180,25 +180,25 @@ set_nw_dst(struct packet *pkt, struct ofl_action_nw_addr *act) {
     }
 }
 
-/* Executes set tp src action. */
+/* Executes set tp src action. The port is given in network byte order. */
 static void
-set_tp_src(struct packet *pkt, struct ofl_action_tp_port *act) {
-    packet_handle_std_validate(pkt->handle_std);
+set_tp_src(struct packet *pkt, uint16_t tp_port) {
+    packet_handle_std_parse(pkt->handle_std, PACKET_LAYER_L4);
     if (pkt->handle_std->proto->tcp != NULL) {
         struct tcp_header *tcp = pkt->handle_std->proto->tcp;
 
-        tcp->tcp_csum = recalc_csum16(tcp->tcp_csum, tcp->tcp_src, htons(act->tp_port));
-        tcp->tcp_src = htons(act->tp_port);
+        tcp->tcp_csum = recalc_csum16(tcp->tcp_csum, tcp->tcp_src, tp_port);
+        tcp->tcp_src = tp_port;
 
-        pkt->handle_std->match->tp_src = act->tp_port;
+        pkt->handle_std->match->tp_src = ntohs(tp_port);
 
     } else if (pkt->handle_std->proto->udp != NULL) {
         struct udp_header *udp = pkt->handle_std->proto->udp;
 
-        udp->udp_csum = recalc_csum16(udp->udp_csum, udp->udp_src, htons(act->tp_port));
-        udp->udp_src = htons(act->tp_port);
+        udp->udp_csum = recalc_csum16(udp->udp_csum, udp->udp_src, tp_port);
+        udp->udp_src = tp_port;
 
-        pkt->handle_std->match->tp_src = act->tp_port;
+        pkt->handle_std->match->tp_src = ntohs(tp_port);
 
     } else {
         VLOG_WARN_RL(LOG_MODULE, &rl, "Trying to execute SET_TP_SRC action on packet with no tp.");
@@ -206,26 +206,26 @@ set_tp_src(struct packet *pkt, struct ofl_action_tp_port *act) {
 }
 
 
-/* Executes set tp dst action. */
+/* Executes set tp dst action. The port is given in network byte order. */
 static void
-set_tp_dst(struct packet *pkt, struct ofl_action_tp_port *act) {
-    packet_handle_std_validate(pkt->handle_std);
+set_tp_dst(struct packet *pkt, uint16_t tp_port) {
+    packet_handle_std_parse(pkt->handle_std, PACKET_LAYER_L4);
     if (pkt->handle_std->proto->tcp != NULL) {
         struct tcp_header *tcp = pkt->handle_std->proto->tcp;
 
-        tcp->tcp_csum = recalc_csum16(tcp->tcp_csum, tcp->tcp_dst, htons(act->tp_port));
-        tcp->tcp_dst = htons(act->tp_port);
+        tcp->tcp_csum = recalc_csum16(tcp->tcp_csum, tcp->tcp_dst, tp_port);
+        tcp->tcp_dst = tp_port;
 
-        pkt->handle_std->match->tp_dst = act->tp_port;
+        pkt->handle_std->match->tp_dst = ntohs(tp_port);
 
     } else if (pkt->handle_std->proto->udp != NULL) {
         struct udp_header *udp = pkt->handle_std->proto->udp;
 
-        udp->udp_csum = recalc_csum16(udp->udp_csum, udp->udp_dst, htons(act->tp_port));
-        udp->udp_dst = htons(act->tp_port);
+        udp->udp_csum = recalc_csum16(udp->udp_csum, udp->udp_dst, tp_port);
+        udp->udp_dst = tp_port;
 
         // update packet match (assuming it is of type ofl_match_standard)
-        pkt->handle_std->match->tp_dst = act->tp_port;
+        pkt->handle_std->match->tp_dst = ntohs(tp_port);
 
     } else {
         VLOG_WARN_RL(LOG_MODULE, &rl, "Trying to execute SET_TP_DST action on packet with no tp.");
@@ -235,7 +235,7 @@ set_tp_dst(struct packet *pkt, struct ofl_action_tp_port *act) {
 /* Executes copy ttl out action. */
 static void
 copy_ttl_out(struct packet *pkt, struct ofl_action_header *act UNUSED) {
-    packet_handle_std_validate(pkt->handle_std);
+    packet_handle_std_parse(pkt->handle_std, PACKET_LAYER_L3);
     if (pkt->handle_std->proto->mpls != NULL) {
         struct mpls_header *mpls = pkt->handle_std->proto->mpls;
 
@@ -262,7 +262,7 @@ copy_ttl_out(struct packet *pkt, struct ofl_action_header *act UNUSED) {
 /* Executes copy ttl in action. */
 static void
 copy_ttl_in(struct packet *pkt, struct ofl_action_header *act UNUSED) {
-    packet_handle_std_validate(pkt->handle_std);
+    packet_handle_std_parse(pkt->handle_std, PACKET_LAYER_L3);
     if (pkt->handle_std->proto->mpls != NULL) {
         struct mpls_header *mpls = pkt->handle_std->proto->mpls;
 
@@ -290,14 +290,27 @@ copy_ttl_in(struct packet *pkt, struct ofl_action_header *act UNUSED) {
     }
 }
 
-/* Executes set mpls label action. */
+/* Returns the label of the action shifted into the mpls header fields. */
+static inline uint32_t
+mpls_label_fields(struct ofl_action_mpls_label *act) {
+    return htonl((act->mpls_label << MPLS_LABEL_SHIFT) & MPLS_LABEL_MASK);
+}
+
+/* Returns the tc of the action shifted into the mpls header fields. */
+static inline uint32_t
+mpls_tc_fields(struct ofl_action_mpls_tc *act) {
+    return htonl((act->mpls_tc << MPLS_TC_SHIFT) & MPLS_TC_MASK);
+}
+
+/* Executes set mpls label action. The label is given shifted into the mpls
+ * header fields, in network byte order. */
 static void
-set_mpls_label(struct packet *pkt, struct ofl_action_mpls_label *act) {
-    packet_handle_std_validate(pkt->handle_std);
+set_mpls_label(struct packet *pkt, struct ofl_action_mpls_label *act, uint32_t fields) {
+    packet_handle_std_parse(pkt->handle_std, PACKET_LAYER_L3);
     if (pkt->handle_std->proto->mpls != NULL) {
         struct mpls_header *mpls = pkt->handle_std->proto->mpls;
 
-        mpls->fields = (mpls->fields & ~ntohl(MPLS_LABEL_MASK)) | ntohl((act->mpls_label << MPLS_LABEL_SHIFT) & MPLS_LABEL_MASK);
+        mpls->fields = (mpls->fields & ~htonl(MPLS_LABEL_MASK)) | fields;
 
         pkt->handle_std->match->mpls_label = act->mpls_label;
 
@@ -306,14 +319,15 @@ set_mpls_label(struct packet *pkt, struct ofl_action_mpls_label *act) {
     }
 }
 
-/* Executes set mpls tc action. */
+/* Executes set mpls tc action. The tc is given shifted into the mpls
+ * header fields, in network byte order. */
 static void
-set_mpls_tc(struct packet *pkt, struct ofl_action_mpls_tc *act) {
-    packet_handle_std_validate(pkt->handle_std);
+set_mpls_tc(struct packet *pkt, struct ofl_action_mpls_tc *act, uint32_t fields) {
+    packet_handle_std_parse(pkt->handle_std, PACKET_LAYER_L3);
     if (pkt->handle_std->proto->mpls != NULL) {
         struct mpls_header *mpls = pkt->handle_std->proto->mpls;
 
-        mpls->fields = (mpls->fields & ~ntohl(MPLS_TC_MASK)) | ntohl((act->mpls_tc << MPLS_TC_SHIFT) & MPLS_TC_MASK);
+        mpls->fields = (mpls->fields & ~htonl(MPLS_TC_MASK)) | fields;
 
         pkt->handle_std->match->mpls_tc = act->mpls_tc;
 
@@ -325,7 +339,7 @@ set_mpls_tc(struct packet *pkt, struct ofl_action_mpls_tc *act) {
 /* Executes set nw tos action. */
 static void
 set_nw_tos(struct packet *pkt, struct ofl_action_nw_tos *act) {
-    packet_handle_std_validate(pkt->handle_std);
+    packet_handle_std_parse(pkt->handle_std, PACKET_LAYER_L3);
     if (pkt->handle_std->proto->ipv4 != NULL) {
         struct ip_header *ipv4 = pkt->handle_std->proto->ipv4;
         uint8_t new_value;
@@ -345,7 +359,7 @@ set_nw_tos(struct packet *pkt, struct ofl_action_nw_tos *act) {
 /* Executes set nw ecn action. */
 static void
 set_nw_ecn(struct packet *pkt, struct ofl_action_nw_ecn *act) {
-    packet_handle_std_validate(pkt->handle_std);
+    packet_handle_std_parse(pkt->handle_std, PACKET_LAYER_L3);
     if (pkt->handle_std->proto->ipv4 != NULL) {
         struct ip_header *ipv4 = pkt->handle_std->proto->ipv4;
         uint8_t new_value;
@@ -364,7 +378,7 @@ set_nw_ecn(struct packet *pkt, struct ofl_action_nw_ecn *act) {
 static void
 push_vlan(struct packet *pkt, struct ofl_action_push *act) {
     // TODO Zoltan: if 802.3, check if new length is still valid
-    packet_handle_std_validate(pkt->handle_std);
+    packet_handle_std_parse(pkt->handle_std, PACKET_LAYER_L2);
     if (pkt->handle_std->proto->eth != NULL) {
         struct eth_header  *eth,  *new_eth;
         struct snap_header *snap, *new_snap;
@@ -426,7 +440,7 @@ push_vlan(struct packet *pkt, struct ofl_action_push *act) {
 
         // TODO Zoltan: This could be faster if VLAN match is updated
         //              and proto pointers are shifted in case of realloc, ...
-        pkt->handle_std->valid = false;
+        packet_handle_std_invalidate(pkt->handle_std);
 
     } else {
         VLOG_WARN_RL(LOG_MODULE, &rl, "Trying to execute push vlan action on packet with no eth.");
@@ -436,7 +450,7 @@ push_vlan(struct packet *pkt, struct ofl_action_push *act) {
 /* Executes pop vlan action. */
 static void
 pop_vlan(struct packet *pkt, struct ofl_action_header *act UNUSED) {
-    packet_handle_std_validate(pkt->handle_std);
+    packet_handle_std_parse(pkt->handle_std, PACKET_LAYER_L2);
     if (pkt->handle_std->proto->eth != NULL && pkt->handle_std->proto->vlan != NULL) {
         struct eth_header *eth = pkt->handle_std->proto->eth;
         struct snap_header *eth_snap = pkt->handle_std->proto->eth_snap;
@@ -458,7 +472,7 @@ pop_vlan(struct packet *pkt, struct ofl_action_header *act UNUSED) {
         memmove(pkt->buffer->data, eth, move_size);
 
         //TODO Zoltan: revalidating might not be necessary in all cases
-        pkt->handle_std->valid = false;
+        packet_handle_std_invalidate(pkt->handle_std);
     } else {
         VLOG_WARN_RL(LOG_MODULE, &rl, "Trying to execute POP_VLAN action on packet with no eth/vlan.");
     }
@@ -468,7 +482,7 @@ pop_vlan(struct packet *pkt, struct ofl_action_header *act UNUSED) {
 /* Executes set mpls ttl action. */
 static void
 set_mpls_ttl(struct packet *pkt, struct ofl_action_mpls_ttl *act) {
-    packet_handle_std_validate(pkt->handle_std);
+    packet_handle_std_parse(pkt->handle_std, PACKET_LAYER_L3);
     if (pkt->handle_std->proto->mpls != NULL) {
         struct mpls_header *mpls = pkt->handle_std->proto->mpls;
 
@@ -482,7 +496,7 @@ set_mpls_ttl(struct packet *pkt, struct ofl_action_mpls_ttl *act) {
 /* Executes dec mpls label action. */
 static void
 dec_mpls_ttl(struct packet *pkt, struct ofl_action_header *act UNUSED) {
-    packet_handle_std_validate(pkt->handle_std);
+    packet_handle_std_parse(pkt->handle_std, PACKET_LAYER_L3);
     if (pkt->handle_std->proto->mpls != NULL) {
         struct mpls_header *mpls = pkt->handle_std->proto->mpls;
 
@@ -500,7 +514,7 @@ dec_mpls_ttl(struct packet *pkt, struct ofl_action_header *act UNUSED) {
 static void
 push_mpls(struct packet *pkt, struct ofl_action_push *act) {
     // TODO Zoltan: if 802.3, check if new length is still valid
-    packet_handle_std_validate(pkt->handle_std);
+    packet_handle_std_parse(pkt->handle_std, PACKET_LAYER_L3);
     if (pkt->handle_std->proto->eth != NULL) {
         struct eth_header  *eth,  *new_eth;
         struct snap_header *snap, *new_snap;
@@ -582,7 +596,7 @@ push_mpls(struct packet *pkt, struct ofl_action_push *act) {
 
         // in 1.1 all proto but eth and mpls will be hidden,
         // so revalidating won't be a tedious work (probably)
-        pkt->handle_std->valid = false;
+        packet_handle_std_invalidate(pkt->handle_std);
     } else {
         VLOG_WARN_RL(LOG_MODULE, &rl, "Trying to execute PUSH_MPLS action on packet with no eth.");
     }
@@ -591,7 +605,7 @@ push_mpls(struct packet *pkt, struct ofl_action_push *act) {
 /* Executes pop mpls action. */
 static void
 pop_mpls(struct packet *pkt, struct ofl_action_pop_mpls *act) {
-    packet_handle_std_validate(pkt->handle_std);
+    packet_handle_std_parse(pkt->handle_std, PACKET_LAYER_L3);
     if (pkt->handle_std->proto->eth != NULL && pkt->handle_std->proto->mpls != NULL) {
         struct eth_header *eth = pkt->handle_std->proto->eth;
         struct snap_header *snap = pkt->handle_std->proto->eth_snap;
@@ -620,7 +634,7 @@ pop_mpls(struct packet *pkt, struct ofl_action_pop_mpls *act) {
         }
 
         //TODO Zoltan: revalidating might not be necessary at all cases
-        pkt->handle_std->valid = false;
+        packet_handle_std_invalidate(pkt->handle_std);
     } else {
         VLOG_WARN_RL(LOG_MODULE, &rl, "Trying to execute POP_MPLS action on packet with no eth/mpls.");
     }
@@ -642,7 +656,7 @@ group(struct packet *pkt, struct ofl_action_group *act) {
 /* Executes set nw ttl action. */
 static void
 set_nw_ttl(struct packet *pkt, struct ofl_action_set_nw_ttl *act) {
-    packet_handle_std_validate(pkt->handle_std);
+    packet_handle_std_parse(pkt->handle_std, PACKET_LAYER_L3);
     if (pkt->handle_std->proto->ipv4 != NULL) {
         struct ip_header *ipv4 = pkt->handle_std->proto->ipv4;
 
@@ -658,7 +672,7 @@ set_nw_ttl(struct packet *pkt, struct ofl_action_set_nw_ttl *act) {
 /* Executes dec nw ttl action. */
 static void
 dec_nw_ttl(struct packet *pkt, struct ofl_action_header *act UNUSED) {
-    packet_handle_std_validate(pkt->handle_std);
+    packet_handle_std_parse(pkt->handle_std, PACKET_LAYER_L3);
     if (pkt->handle_std->proto->ipv4 != NULL) {
 
         struct ip_header *ipv4 = pkt->handle_std->proto->ipv4;
@@ -686,6 +700,12 @@ dp_execute_action(struct packet *pkt,
         free(a);
     }
 
+    /* all actions but output, set queue and group modify the packet data. */
+    if (action->type != OFPAT_OUTPUT && action->type != OFPAT_SET_QUEUE &&
+        action->type != OFPAT_GROUP) {
+        packet_unshare(pkt);
+    }
+
     switch (action->type) {
         case (OFPAT_OUTPUT): {
             output(pkt, (struct ofl_action_output *)action);
@@ -724,11 +744,11 @@ dp_execute_action(struct packet *pkt,
             break;
         }
         case (OFPAT_SET_TP_SRC): {
-            set_tp_src(pkt, (struct ofl_action_tp_port *)action);
+            set_tp_src(pkt, htons(((struct ofl_action_tp_port *)action)->tp_port));
             break;
         }
         case (OFPAT_SET_TP_DST): {
-            set_tp_dst(pkt, (struct ofl_action_tp_port *)action);
+            set_tp_dst(pkt, htons(((struct ofl_action_tp_port *)action)->tp_port));
             break;
         }
         case (OFPAT_COPY_TTL_OUT): {
@@ -740,11 +760,13 @@ dp_execute_action(struct packet *pkt,
             break;
         }
         case (OFPAT_SET_MPLS_LABEL): {
-            set_mpls_label(pkt, (struct ofl_action_mpls_label *)action);
+            struct ofl_action_mpls_label *act = (struct ofl_action_mpls_label *)action;
+            set_mpls_label(pkt, act, mpls_label_fields(act));
             break;
         }
         case (OFPAT_SET_MPLS_TC): {
-            set_mpls_tc(pkt, (struct ofl_action_mpls_tc *)action);
+            struct ofl_action_mpls_tc *act = (struct ofl_action_mpls_tc *)action;
+            set_mpls_tc(pkt, act, mpls_tc_fields(act));
             break;
         }
         case (OFPAT_SET_MPLS_TTL): {
@@ -805,6 +827,28 @@ dp_execute_action(struct packet *pkt,
 
 
 
+/* Sends the packet to the group or port set by the last executed action, if
+ * any. */
+static inline void
+execute_out(struct packet *pkt) {
+    if (pkt->out_group != OFPG_ANY) {
+        uint32_t group = pkt->out_group;
+        pkt->out_group = OFPG_ANY;
+        VLOG_DBG_RL(LOG_MODULE, &rl, "Group action; executing group (%u).", group);
+        group_table_execute(pkt->dp->groups, pkt, group);
+
+    } else if (pkt->out_port != OFPP_ANY) {
+        uint32_t port = pkt->out_port;
+        uint32_t queue = pkt->out_queue;
+        uint16_t max_len = pkt->out_port_max_len;
+        pkt->out_port = OFPP_ANY;
+        pkt->out_port_max_len = 0;
+        pkt->out_queue = 0;
+        VLOG_DBG_RL(LOG_MODULE, &rl, "Port action; sending to port (%u).", port);
+        dp_actions_output_port(pkt, port, queue, max_len);
+    }
+}
+
 void
 dp_execute_action_list(struct packet *pkt,
                 size_t actions_num, struct ofl_action_header **actions) {
@@ -814,24 +858,89 @@ dp_execute_action_list(struct packet *pkt,
 
     for (i=0; i < actions_num; i++) {
         dp_execute_action(pkt, actions[i]);
+        execute_out(pkt);
+    }
+}
+
+void
+dp_actions_compile(struct dp_op *op, struct ofl_action_header *action) {
+    op->type   = action->type;
+    op->action = action;
+
+    switch (op->type) {
+        case (OFPAT_OUTPUT): {
+            op->arg.u32 = ((struct ofl_action_output *)action)->port;
+            break;
+        }
+        case (OFPAT_SET_TP_SRC):
+        case (OFPAT_SET_TP_DST): {
+            op->arg.u16 = htons(((struct ofl_action_tp_port *)action)->tp_port);
+            break;
+        }
+        case (OFPAT_SET_MPLS_LABEL): {
+            op->arg.u32 = mpls_label_fields((struct ofl_action_mpls_label *)action);
+            break;
+        }
+        case (OFPAT_SET_MPLS_TC): {
+            op->arg.u32 = mpls_tc_fields((struct ofl_action_mpls_tc *)action);
+            break;
+        }
+        default: {
+            op->arg.u32 = 0;
+        }
+    }
+}
 
-        if (pkt->out_group != OFPG_ANY) {
-            uint32_t group = pkt->out_group;
-            pkt->out_group = OFPG_ANY;
-            VLOG_DBG_RL(LOG_MODULE, &rl, "Group action; executing group (%u).", group);
-            group_table_execute(pkt->dp->groups, pkt, group);
+void
+dp_execute_ops(struct packet *pkt, size_t ops_num, struct dp_op *ops) {
+    size_t i;
 
-        } else if (pkt->out_port != OFPP_ANY) {
-            uint32_t port = pkt->out_port;
-            uint32_t queue = pkt->out_queue;
-            uint16_t max_len = pkt->out_port_max_len;
-            pkt->out_port = OFPP_ANY;
-            pkt->out_port_max_len = 0;
-            pkt->out_queue = 0;
-            VLOG_DBG_RL(LOG_MODULE, &rl, "Port action; sending to port (%u).", port);
-            dp_actions_output_port(pkt, port, queue, max_len);
+    if (VLOG_IS_DBG_ENABLED(LOG_MODULE)) {
+        /* take the slow path, which logs each action and its result. */
+        for (i=0; i < ops_num; i++) {
+            dp_execute_action(pkt, ops[i].action);
+            execute_out(pkt);
         }
+        return;
+    }
 
+    for (i=0; i < ops_num; i++) {
+        struct dp_op *op = &ops[i];
+
+        switch (op->type) {
+            case (OFPAT_OUTPUT): {
+                uint32_t queue = pkt->out_queue;
+                uint16_t max_len = (op->arg.u32 == OFPP_CONTROLLER)
+                        ? ((struct ofl_action_output *)op->action)->max_len : 0;
+                pkt->out_queue = 0;
+                dp_actions_output_port(pkt, op->arg.u32, queue, max_len);
+                break;
+            }
+            case (OFPAT_SET_TP_SRC): {
+                packet_unshare(pkt);
+                set_tp_src(pkt, op->arg.u16);
+                break;
+            }
+            case (OFPAT_SET_TP_DST): {
+                packet_unshare(pkt);
+                set_tp_dst(pkt, op->arg.u16);
+                break;
+            }
+            case (OFPAT_SET_MPLS_LABEL): {
+                packet_unshare(pkt);
+                set_mpls_label(pkt, (struct ofl_action_mpls_label *)op->action, op->arg.u32);
+                break;
+            }
+            case (OFPAT_SET_MPLS_TC): {
+                packet_unshare(pkt);
+                set_mpls_tc(pkt, (struct ofl_action_mpls_tc *)op->action, op->arg.u32);
+                break;
+            }
+            default: {
+                dp_execute_action(pkt, op->action);
+                execute_out(pkt);
+            }
+        }
     }
 }
 
@@ -855,22 +964,7 @@ dp_actions_output_port(struct packet *pkt, uint32_t out_port, uint32_t out_queue
             break;
         }
         case (OFPP_CONTROLLER): {
-            dp_buffers_save(pkt->dp->buffers, pkt);
-
-            {
-                struct ofl_msg_packet_in msg =
-                        {{.type = OFPT_PACKET_IN},
-                         .buffer_id   = pkt->buffer_id,
-                         .in_port     = pkt->in_port,
-                         .in_phy_port = pkt->in_port, // TODO: how to get phy port for v.port?
-                         .total_len   = pkt->buffer->size,
-                         .reason      = OFPR_ACTION,
-                         .table_id    = pkt->table_id,
-                         .data_length = MIN(max_len, pkt->buffer->size),
-                         .data        = pkt->buffer->data};
-
-                dp_send_message(pkt->dp, (struct ofl_msg_header *)&msg, NULL);
-            }
+            dp_send_packet_in(pkt->dp, pkt, pkt->table_id, OFPR_ACTION, max_len);
             break;
         }
         case (OFPP_FLOOD):
@@ -53,6 +53,26 @@ void
 dp_execute_action_list(struct packet *pkt,
                 size_t actions_num, struct ofl_action_header **actions);
 
+/* An action compiled for repeated execution: the type is hoisted from the
+ * action, and arguments which are used in network byte order are converted
+ * in advance. */
+struct dp_op {
+    uint16_t                    type;
+    union {
+        uint16_t   u16;
+        uint32_t   u32;
+    }                           arg;
+    struct ofl_action_header   *action;  /* the action the op was compiled from. */
+};
+
+/* Compiles the action into the op. */
+void
+dp_actions_compile(struct dp_op *op, struct ofl_action_header *action);
+
+/* Executes the list of compiled actions on the given packet. */
+void
+dp_execute_ops(struct packet *pkt, size_t ops_num, struct dp_op *ops);
+
 /* Outputs the packet on the given port and queue. */
 void
 dp_actions_output_port(struct packet *pkt, uint32_t out_port, uint32_t out_queue, uint16_t max_len);
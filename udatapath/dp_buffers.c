@@ -41,8 +41,9 @@
 #include <stdint.h>
 
 #include "dp_buffers.h"
-#include "timeval.h"
+#include "list.h"
 #include "packet.h"
+#include "util.h"
 #include "vlog.h"
 
 #define LOG_MODULE VLM_dp_buf
@@ -50,24 +51,18 @@
 static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(60, 60);
 
 
-/* Buffers are identified by a 31-bit opaque ID.  We divide the ID
+/* Buffers are identified by a 32-bit opaque ID.  We divide the ID
  * into a buffer number (low bits) and a cookie (high bits).  The buffer number
  * is an index into an array of buffers.  The cookie distinguishes between
- * different packets that have occupied a single buffer.  Thus, the more
- * buffers we have, the lower-quality the cookie... */
-#define PKT_BUFFER_BITS 8
-#define PKT_COOKIE_BITS (32 - PKT_BUFFER_BITS)
-
-#define N_PKT_BUFFERS (1 << PKT_BUFFER_BITS)
-#define PKT_BUFFER_MASK (N_PKT_BUFFERS - 1)
-
-
-#define OVERWRITE_SECS  1
+ * different packets that have occupied a single buffer.  Free buffers are
+ * reused in the order they were freed, so an ID is only repeated after all
+ * buffers went through all of their cookies. */
 
 struct packet_buffer {
-    struct packet *pkt;
+    struct list    node;     /* node in the expiry queue, while in use. */
+    struct packet *pkt;      /* NULL if the buffer is free. */
     uint32_t       cookie;
-    time_t         timeout;
+    size_t         size;     /* memory accounted for the packet. */
 };
 
 
@@ -78,30 +73,134 @@ struct packet_buffer {
 
 struct dp_buffers {
     struct datapath       *dp;
-    size_t                 buffer_idx;
+    size_t                 buffer_bits;  /* bits of the ID selecting the buffer. */
     size_t                 buffers_num;
-    struct packet_buffer   buffers[N_PKT_BUFFERS];
+    struct packet_buffer  *buffers;
+
+    uint32_t              *free;         /* ring of free buffer numbers. */
+    size_t                 free_head;
+    size_t                 free_num;
+
+    struct list            queue;        /* buffers in use, the least recently
+                                            saved first. */
+    size_t                 mem;          /* memory used by buffered packets. */
+    size_t                 mem_max;
 };
 
+static inline uint32_t
+buffer_mask(struct dp_buffers *dpb) {
+    return dpb->buffers_num - 1;
+}
 
-struct dp_buffers *
-dp_buffers_create(struct datapath *dp) {
-    struct dp_buffers *dpb = xmalloc(sizeof(struct dp_buffers));
+static inline uint32_t
+cookie_max(struct dp_buffers *dpb) {
+    /* Don't use maximum cookie value since the all-bits-1 id is
+     * special. */
+    return (uint32_t)((1ull << (32 - dpb->buffer_bits)) - 1);
+}
+
+/* Allocates the given number of buffers, which must be a power of two. */
+static void
+alloc_buffers(struct dp_buffers *dpb, size_t buffers_num) {
     size_t i;
 
-    dpb->dp          = dp;
-    dpb->buffer_idx  = (size_t)-1;
-    dpb->buffers_num = N_PKT_BUFFERS;
+    dpb->buffer_bits = 0;
+    while (((size_t)1 << dpb->buffer_bits) < buffers_num) {
+        dpb->buffer_bits++;
+    }
+    dpb->buffers_num = buffers_num;
+    dpb->buffers     = xmalloc(sizeof(struct packet_buffer) * buffers_num);
+    dpb->free        = xmalloc(sizeof(uint32_t) * buffers_num);
+    dpb->free_head   = 0;
+    dpb->free_num    = buffers_num;
 
-    for (i=0; i<N_PKT_BUFFERS; i++) {
+    for (i = 0; i < buffers_num; i++) {
         dpb->buffers[i].pkt     = NULL;
-        dpb->buffers[i].cookie  = UINT32_MAX;
-        dpb->buffers[i].timeout = 0;
+        dpb->buffers[i].cookie  = 0;
+        dpb->buffers[i].size    = 0;
+        dpb->free[i] = i;
+    }
+}
+
+/* Returns the buffer holding the packet with the given ID; NULL if there is
+ * no such packet. */
+static struct packet_buffer *
+lookup(struct dp_buffers *dpb, uint32_t id) {
+    struct packet_buffer *p;
+
+    if (id == NO_BUFFER) {
+        return NULL;
     }
+    p = &dpb->buffers[id & buffer_mask(dpb)];
+    if (p->pkt == NULL || p->cookie != id >> dpb->buffer_bits) {
+        return NULL;
+    }
+    return p;
+}
+
+/* Takes the packet out of the buffer, and frees the buffer. */
+static struct packet *
+release(struct dp_buffers *dpb, struct packet_buffer *p) {
+    struct packet *pkt = p->pkt;
+
+    list_remove(&p->node);
+    dpb->mem -= p->size;
+    p->pkt  = NULL;
+    p->size = 0;
+
+    dpb->free[(dpb->free_head + dpb->free_num) & buffer_mask(dpb)] = p - dpb->buffers;
+    dpb->free_num++;
+
+    pkt->buffer_id = NO_BUFFER;
+    return pkt;
+}
+
+/* Frees the least recently saved buffer, destroying its packet. */
+static void
+evict(struct dp_buffers *dpb) {
+    struct packet_buffer *p = CONTAINER_OF(list_front(&dpb->queue), struct packet_buffer, node);
+
+    packet_destroy(release(dpb, p));
+}
+
+struct dp_buffers *
+dp_buffers_create(struct datapath *dp) {
+    struct dp_buffers *dpb = xmalloc(sizeof(struct dp_buffers));
+
+    dpb->dp      = dp;
+    list_init(&dpb->queue);
+    dpb->mem     = 0;
+    dpb->mem_max = DP_BUFFERS_MEM;
+    alloc_buffers(dpb, DP_BUFFERS_NUM);
 
     return dpb;
 }
 
+void
+dp_buffers_set_size(struct dp_buffers *dpb, size_t buffers_num) {
+    size_t num = 1;
+
+    while (num < buffers_num) {
+        num <<= 1;
+    }
+
+    while (!list_is_empty(&dpb->queue)) {
+        evict(dpb);
+    }
+    free(dpb->buffers);
+    free(dpb->free);
+    alloc_buffers(dpb, num);
+}
+
+void
+dp_buffers_set_mem(struct dp_buffers *dpb, size_t mem_max) {
+    dpb->mem_max = mem_max;
+
+    while (dpb->mem > dpb->mem_max) {
+        evict(dpb);
+    }
+}
+
 size_t
 dp_buffers_size(struct dp_buffers *dpb) {
     return dpb->buffers_num;
@@ -110,7 +209,8 @@ dp_buffers_size(struct dp_buffers *dpb) {
 uint32_t
 dp_buffers_save(struct dp_buffers *dpb, struct packet *pkt) {
     struct packet_buffer *p;
-    uint32_t id;
+    size_t size;
+    uint32_t idx;
 
     /* if packet is already in buffer, do not save again */
     if (pkt->buffer_id != NO_BUFFER) {
@@ -119,71 +219,72 @@ dp_buffers_save(struct dp_buffers *dpb, struct packet *pkt) {
         }
     }
 
-    dpb->buffer_idx = (dpb->buffer_idx + 1) & PKT_BUFFER_MASK;
+    /* the packet outlives the one it may share its data with. */
+    packet_unshare(pkt);
 
-    p = &dpb->buffers[dpb->buffer_idx];
-    if (p->pkt != NULL) {
-        if (time_now() < p->timeout) {
-            return NO_BUFFER;
-        } else {
-            p->pkt->buffer_id = NO_BUFFER;
-            packet_destroy(p->pkt);
-        }
+    size = sizeof(struct packet) + pkt->buffer->allocated;
+    if (size > dpb->mem_max) {
+        return NO_BUFFER;
     }
-    /* Don't use maximum cookie value since the all-bits-1 id is
-     * special. */
-    if (++p->cookie >= (1u << PKT_COOKIE_BITS) - 1)
+
+    /* NOTE: when out of buffers or memory the least recently saved packets
+     *       are dropped, so that the buffer IDs of packet ins of a burst
+     *       remain usable for as long as possible. */
+    while (dpb->free_num == 0 || dpb->mem + size > dpb->mem_max) {
+        VLOG_DBG_RL(LOG_MODULE, &rl, "evicting buffered packet (%zu buffered, %zu bytes).",
+                    dpb->buffers_num - dpb->free_num, dpb->mem);
+        evict(dpb);
+    }
+
+    idx = dpb->free[dpb->free_head];
+    dpb->free_head = (dpb->free_head + 1) & buffer_mask(dpb);
+    dpb->free_num--;
+
+    p = &dpb->buffers[idx];
+    if (++p->cookie >= cookie_max(dpb)) {
         p->cookie = 0;
-    p->pkt = pkt;
-    p->timeout = time_now() + OVERWRITE_SECS;
-    id = dpb->buffer_idx | (p->cookie << PKT_BUFFER_BITS);
+    }
+    p->pkt     = pkt;
+    p->size    = size;
+    list_push_back(&dpb->queue, &p->node);
+    dpb->mem  += size;
 
-    pkt->buffer_id  = id;
+    pkt->buffer_id = idx | (p->cookie << dpb->buffer_bits);
 
-    return id;
+    return pkt->buffer_id;
 }
 
 struct packet *
 dp_buffers_retrieve(struct dp_buffers *dpb, uint32_t id) {
-    struct packet *pkt = NULL;
-    struct packet_buffer *p;
-
-    p = &dpb->buffers[id & PKT_BUFFER_MASK];
-    if (p->cookie == id >> PKT_BUFFER_BITS) {
-        pkt = p->pkt;
-        pkt->buffer_id = NO_BUFFER;
-        pkt->packet_out = false;
+    struct packet_buffer *p = lookup(dpb, id);
+    struct packet *pkt;
 
-        p->pkt = NULL;
-    } else {
-        VLOG_WARN_RL(LOG_MODULE, &rl, "cookie mismatch: %x != %x\n",
-                          id >> PKT_BUFFER_BITS, p->cookie);
+    if (p == NULL) {
+        VLOG_WARN_RL(LOG_MODULE, &rl, "no packet is buffered with id %x.", id);
+        return NULL;
     }
 
+    pkt = release(dpb, p);
+    pkt->packet_out = false;
+
     return pkt;
 }
 
 bool
 dp_buffers_is_alive(struct dp_buffers *dpb, uint32_t id) {
-    struct packet_buffer *p;
-
-    p = &dpb->buffers[id & PKT_BUFFER_MASK];
-    return ((p->cookie == id >> PKT_BUFFER_BITS) &&
-            (time_now() < p->timeout));
+    return lookup(dpb, id) != NULL;
 }
 
 
 void
 dp_buffers_discard(struct dp_buffers *dpb, uint32_t id, bool destroy) {
-    struct packet_buffer *p;
+    struct packet_buffer *p = lookup(dpb, id);
 
-    p = &dpb->buffers[id & PKT_BUFFER_MASK];
+    if (p != NULL) {
+        struct packet *pkt = release(dpb, p);
 
-    if (p->cookie == id >> PKT_BUFFER_BITS) {
         if (destroy) {
-            p->pkt->buffer_id = NO_BUFFER;
-            packet_destroy(p->pkt);
+            packet_destroy(pkt);
         }
-        p->pkt = NULL;
     }
 }
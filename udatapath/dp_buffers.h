@@ -48,8 +48,21 @@
 /* Constant for representing "no buffer" */
 #define NO_BUFFER 0xffffffff
 
+/* Default number of buffers. */
+#define DP_BUFFERS_NUM  (1 << 16)
+
+/* Default limit of the memory used by buffered packets, in bytes. */
+#define DP_BUFFERS_MEM  (64 * 1024 * 1024)
+
+/* Maximum number of buffers; the rest of the buffer ID is the cookie. */
+#define DP_BUFFERS_MAX  (1 << 24)
+
 /****************************************************************************
  * Datapath buffers for storing packets for packet in messages.
+ *
+ * Buffered packets are kept until they are retrieved or discarded. When all
+ * buffers are in use, or the memory limit is reached, the least recently saved
+ * packets are dropped to make room for new ones.
  ****************************************************************************/
 
 struct datapath;
@@ -59,6 +72,15 @@ struct packet;
 struct dp_buffers *
 dp_buffers_create(struct datapath *dp);
 
+/* Sets the number of buffers, rounded up to a power of two. Packets already
+ * buffered are dropped. */
+void
+dp_buffers_set_size(struct dp_buffers *dpb, size_t buffers_num);
+
+/* Sets the limit of the memory used by buffered packets, in bytes. */
+void
+dp_buffers_set_mem(struct dp_buffers *dpb, size_t mem_max);
+
 /* Returns the number of buffers */
 size_t
 dp_buffers_size(struct dp_buffers *dpb);
@@ -73,7 +95,7 @@ dp_buffers_save(struct dp_buffers *dpb, struct packet *pkt);
 struct packet *
 dp_buffers_retrieve(struct dp_buffers *dpb, uint32_t id);
 
-/* Returns true if the buffered packet is not timed out. */
+/* Returns true if the packet is still buffered. */
 bool
 dp_buffers_is_alive(struct dp_buffers *dpb, uint32_t id);
 
@@ -141,10 +141,15 @@ handle_control_packet_out(struct datapath *dp, struct ofl_msg_packet_out *msg,
 
     if (msg->buffer_id == NO_BUFFER) {
         struct ofpbuf *buf;
-        /* NOTE: the created packet will take the ownership of data in msg. */
-        buf = ofpbuf_new(0);
-        ofpbuf_use(buf, msg->data, msg->data_length);
-        ofpbuf_put_uninit(buf, msg->data_length);
+        /* NOTE: the created packet will take the ownership of data in msg,
+         *       unless it is released with the arena of the datapath. */
+        if (ofl_arena_owns(&dp->arena, msg->data)) {
+            buf = ofpbuf_clone_data(msg->data, msg->data_length);
+        } else {
+            buf = ofpbuf_new(0);
+            ofpbuf_use(buf, msg->data, msg->data_length);
+            ofpbuf_put_uninit(buf, msg->data_length);
+        }
         pkt = packet_create(dp, msg->in_port, buf, true);
     } else {
         /* NOTE: in this case packet should not have data */
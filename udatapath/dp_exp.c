@@ -34,6 +34,7 @@
 #include "datapath.h"
 #include "dp_exp.h"
 #include "packet.h"
+#include "pipeline.h"
 #include "oflib/ofl.h"
 #include "oflib/ofl-actions.h"
 #include "oflib/ofl-structs.h"
@@ -87,6 +88,12 @@ dp_exp_message(struct datapath *dp,
                 case (OFP_EXT_SET_DESC): {
                     return dp_handle_set_desc(dp, (struct ofl_exp_openflow_msg_set_dp_desc *)msg, sender);
                 }
+                case (OFP_EXT_FLOW_CACHE_REQUEST): {
+                    return pipeline_handle_flow_cache_request(dp->pipeline, exp, sender);
+                }
+                case (OFP_EXT_PKTIN_RATE_REQUEST): {
+                    return dp_handle_pktin_rate_request(dp, exp, sender);
+                }
                 default: {
                 	VLOG_WARN_RL(LOG_MODULE, &rl, "Trying to handle unknown experimenter type (%u).", exp->type);
                     return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_SUBTYPE);
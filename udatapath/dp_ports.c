@@ -43,7 +43,9 @@
 #include <inttypes.h>
 #include "dp_exp.h"
 #include "dp_ports.h"
+#include "dp_workers.h"
 #include "datapath.h"
+#include "group_table.h"
 #include "packets.h"
 #include "pipeline.h"
 #include "oflib/ofl.h"
@@ -212,23 +214,56 @@ dp_hw_drv_init(struct datapath *dp)
 
 /* Runs a datapath packet through the pipeline, if the port is not set to down. */
 static void
-process_buffer(struct datapath *dp, struct sw_port *p, struct ofpbuf *buffer) {
-    struct packet *pkt;
-
+process_buffer(struct datapath *dp, struct sw_port *p, struct packet *pkt) {
     if (p->conf->config & ((OFPPC_NO_RECV | OFPPC_PORT_DOWN) != 0)) {
-        ofpbuf_delete(buffer);
+        packet_destroy(pkt);
         return;
     }
 
-    // packet takes ownership of ofpbuf buffer
-    pkt = packet_create(dp, p->stats->port_no, buffer, false);
+    pkt->in_port = p->stats->port_no;
     pipeline_process_packet(dp->pipeline, pkt);
 }
 
+size_t
+dp_ports_recv(struct datapath *dp, struct sw_port *p, struct packet **pkts) {
+    struct ofpbuf *buffers[NETDEV_MAX_BATCH];
+    size_t n_received, i;
+    int error;
+
+    for (i = 0; i < dp->rx_batch; i++) {
+        if (pkts[i] == NULL) {
+            /* Allocate buffer with some headroom to add headers in forwarding
+             * to the controller or adding a vlan tag, plus an extra 2 bytes to
+             * allow IP headers to be aligned on a 4-byte boundary.  */
+            const int headroom = 128 + 2;
+            const int hard_header = VLAN_ETH_HEADER_LEN;
+            const int mtu = netdev_get_mtu(p->netdev);
+            pkts[i] = packet_alloc(dp, hard_header + mtu, headroom);
+        }
+        buffers[i] = pkts[i]->buffer;
+    }
+    error = netdev_recv_batch(p->netdev, buffers, dp->rx_batch, &n_received);
+    if (!error) {
+        dp_workers_clock_update();
+        for (i = 0; i < n_received; i++) {
+            p->stats->rx_packets++;
+            p->stats->rx_bytes += buffers[i]->size;
+            // process_buffer takes ownership of the packet
+            process_buffer(dp, p, pkts[i]);
+            pkts[i] = NULL;
+        }
+        return n_received;
+    } else if (error != EAGAIN) {
+        VLOG_ERR_RL(LOG_MODULE, &rl, "error receiving data from %s: %s",
+                    netdev_get_name(p->netdev), strerror(error));
+    }
+    return 0;
+}
+
 void
 dp_ports_run(struct datapath *dp) {
-    // static, so an unused buffer can be reused at the dp_ports_run call
-    static struct ofpbuf *buffer = NULL;
+    // static, so unused packets can be reused at the dp_ports_run call
+    static struct packet *pkts[NETDEV_MAX_BATCH];
 
     struct sw_port *p, *pn;
 
@@ -248,33 +283,13 @@ dp_ports_run(struct datapath *dp) {
 #endif
 
     LIST_FOR_EACH_SAFE (p, pn, struct sw_port, node, &dp->port_list) {
-        int error;
-
         if (IS_HW_PORT(p)) {
             continue;
         }
-        if (buffer == NULL) {
-            /* Allocate buffer with some headroom to add headers in forwarding
-             * to the controller or adding a vlan tag, plus an extra 2 bytes to
-             * allow IP headers to be aligned on a 4-byte boundary.  */
-            const int headroom = 128 + 2;
-            const int hard_header = VLAN_ETH_HEADER_LEN;
-            const int mtu = netdev_get_mtu(p->netdev);
-            buffer = ofpbuf_new_with_headroom(hard_header + mtu, headroom);
-        }
-        error = netdev_recv(p->netdev, buffer);
-        if (!error) {
-            p->stats->rx_packets++;
-            p->stats->rx_bytes += buffer->size;
-            // process_buffer takes ownership of ofpbuf buffer
-            process_buffer(dp, p, buffer);
-            buffer = NULL;
-        } else if (error != EAGAIN) {
-            VLOG_ERR_RL(LOG_MODULE, &rl, "error receiving data from %s: %s",
-                        netdev_get_name(p->netdev), strerror(error));
-        }
+        dp_ports_recv(dp, p, pkts);
     }
 
+    dp_ports_flush(dp);
 }
 
 /* Returns the speed value in kbps of the highest bit set in the bitfield. */
@@ -293,6 +308,40 @@ static uint32_t port_speed(uint32_t conf) {
     return 0;
 }
 
+/* Returns the link state of the device. */
+static uint32_t
+link_state(const struct netdev *netdev) {
+    enum netdev_flags flags;
+
+    if (netdev_get_flags(netdev, &flags) == 0 &&
+        (flags & NETDEV_UP) && (flags & NETDEV_CARRIER)) {
+        return 0x00000000;
+    }
+    return OFPPS_LINK_DOWN;
+}
+
+/* Makes the port monitor watch the devices of all ports. */
+static void
+monitor_ports(struct datapath *dp) {
+    struct sw_port *p;
+    char **names;
+    size_t names_num = 0;
+
+    if (dp->port_monitor == NULL && netdev_monitor_create(&dp->port_monitor) != 0) {
+        VLOG_WARN(LOG_MODULE, "link changes of the ports are not monitored.");
+        return;
+    }
+
+    names = xmalloc(sizeof(char *) * dp->ports_num);
+    LIST_FOR_EACH (p, struct sw_port, node, &dp->port_list) {
+        if (p->netdev != NULL) {
+            names[names_num++] = (char *)netdev_get_name(p->netdev);
+        }
+    }
+    netdev_monitor_set_devices(dp->port_monitor, names, names_num);
+    free(names);
+}
+
 /* Creates a new port, with queues. */
 static int
 new_port(struct datapath *dp, struct sw_port *port, uint32_t port_no,
@@ -360,7 +409,7 @@ new_port(struct datapath *dp, struct sw_port *port, uint32_t port_no,
     memcpy(port->conf->hw_addr, netdev_get_etheraddr(netdev), ETH_ADDR_LEN);
     port->conf->name       = strcpy(xmalloc(strlen(netdev_name) + 1), netdev_name);
     port->conf->config     = 0x00000000;
-    port->conf->state      = 0x00000000;
+    port->conf->state      = link_state(netdev);
     port->conf->curr       = netdev_get_features(netdev, NETDEV_FEAT_CURRENT);
     port->conf->advertised = netdev_get_features(netdev, NETDEV_FEAT_ADVERTISED);
     port->conf->supported  = netdev_get_features(netdev, NETDEV_FEAT_SUPPORTED);
@@ -415,6 +464,8 @@ new_port(struct datapath *dp, struct sw_port *port, uint32_t port_no,
     list_push_back(&dp->port_list, &port->node);
     dp->ports_num++;
 
+    monitor_ports(dp);
+
     {
     /* Notify the controllers that this port has been added */
     struct ofl_msg_port_status msg =
@@ -544,6 +595,103 @@ dp_ports_lookup_queue(struct sw_port *p, uint32_t queue_id)
     return NULL;
 }
 
+/* Returns the output batch of the calling thread. */
+static struct dp_tx_batch *
+tx_batch(struct datapath *dp) {
+    struct dp_worker *w = dp_workers_current();
+
+    return (w != NULL) ? &w->tx : &dp->tx;
+}
+
+/* Copies the frame to the output batch. The frame remains owned by the
+ * caller, which may modify it further. If same is an entry of the batch
+ * holding the same frame, the frame is not copied again. Returns the new
+ * entry. */
+static struct dp_tx_entry *
+tx_enqueue(struct datapath *dp, struct sw_port *p, struct sw_queue *q,
+           uint16_t class_id, struct ofpbuf *buffer, struct dp_tx_entry *same) {
+    struct dp_tx_batch *tx = tx_batch(dp);
+    struct dp_tx_entry *e;
+
+    if (tx->entries_num == DP_TX_BATCH) {
+        dp_ports_flush(dp);
+        same = NULL;
+    }
+
+    e = &tx->entries[tx->entries_num++];
+    e->port     = p;
+    e->queue    = q;
+    e->class_id = class_id;
+    e->sent     = false;
+
+    if (same != NULL) {
+        e->frame = same->frame;
+        return e;
+    }
+
+    if (e->buffer == NULL) {
+        e->buffer = ofpbuf_new(buffer->size);
+    } else {
+        ofpbuf_clear(e->buffer);
+    }
+    ofpbuf_put(e->buffer, buffer->data, buffer->size);
+    e->frame = e->buffer;
+    return e;
+}
+
+/* Sends the frames of the batch which go to the same port and queue as the
+ * given entry, in the order they were output. */
+static void
+tx_flush_group(struct dp_tx_batch *tx, struct dp_tx_entry *first) {
+    struct ofpbuf *buffers[DP_TX_BATCH];
+    size_t bytes = 0;
+    size_t buffers_num = 0;
+    size_t sent;
+    size_t i;
+
+    for (i = first - tx->entries; i < tx->entries_num; i++) {
+        struct dp_tx_entry *e = &tx->entries[i];
+
+        if (!e->sent && e->port == first->port && e->class_id == first->class_id) {
+            buffers[buffers_num++] = e->frame;
+            bytes += e->frame->size;
+            e->sent = true;
+        }
+    }
+
+    sent = netdev_send_batch(first->port->netdev, buffers, buffers_num, first->class_id);
+
+    /* NOTE: on a partial failure byte counts are attributed in order. */
+    if (sent < buffers_num) {
+        bytes = 0;
+        for (i = 0; i < sent; i++) {
+            bytes += buffers[i]->size;
+        }
+    }
+
+    /* NOTE: ports may be output to by several workers. */
+    DP_COUNTER_ADD(first->port->stats->tx_packets, sent);
+    DP_COUNTER_ADD(first->port->stats->tx_bytes,   bytes);
+    DP_COUNTER_ADD(first->port->stats->tx_dropped, buffers_num - sent);
+    if (first->queue != NULL) {
+        DP_COUNTER_ADD(first->queue->stats->tx_packets, sent);
+        DP_COUNTER_ADD(first->queue->stats->tx_bytes,   bytes);
+    }
+}
+
+void
+dp_ports_flush(struct datapath *dp) {
+    struct dp_tx_batch *tx = tx_batch(dp);
+    size_t i;
+
+    for (i = 0; i < tx->entries_num; i++) {
+        if (!tx->entries[i].sent) {
+            tx_flush_group(tx, &tx->entries[i]);
+        }
+    }
+    tx->entries_num = 0;
+}
+
 void
 dp_ports_output(struct datapath *dp, struct ofpbuf *buffer, uint32_t out_port,
               uint32_t queue_id)
@@ -597,16 +745,7 @@ dp_ports_output(struct datapath *dp, struct ofpbuf *buffer, uint32_t out_port,
                 }
             }
 
-            if (!netdev_send(p->netdev, buffer, class_id)) {
-                p->stats->tx_packets++;
-                p->stats->tx_bytes += buffer->size;
-                if (q != NULL) {
-                    q->stats->tx_packets++;
-                    q->stats->tx_bytes += buffer->size;
-                }
-            } else {
-                p->stats->tx_dropped++;
-            }
+            tx_enqueue(dp, p, q, class_id, buffer, NULL);
         }
         /* NOTE: no need to delete buffer, it is deleted along with the packet in caller. */
         return;
@@ -621,6 +760,7 @@ dp_ports_output(struct datapath *dp, struct ofpbuf *buffer, uint32_t out_port,
 int
 dp_ports_output_all(struct datapath *dp, struct ofpbuf *buffer, int in_port, bool flood)
 {
+    struct dp_tx_entry *frame = NULL;
     struct sw_port *p;
 
     LIST_FOR_EACH (p, struct sw_port, node, &dp->port_list) {
@@ -631,7 +771,17 @@ dp_ports_output_all(struct datapath *dp, struct ofpbuf *buffer, int in_port, boo
             continue;
         }
 
-        dp_ports_output(dp, buffer, p->stats->port_no, 0);
+#if defined(OF_HW_PLAT) && !defined(USE_NETDEV)
+        if (IS_HW_PORT(p)) {
+            dp_ports_output(dp, buffer, p->stats->port_no, 0);
+            continue;
+        }
+#endif
+        /* NOTE: the frame is copied to the output batch only once, and the
+         *       entries of the other ports refer to that copy. */
+        if (p->netdev != NULL && !(p->conf->config & OFPPC_PORT_DOWN)) {
+            frame = tx_enqueue(dp, p, NULL, 0, buffer, frame);
+        }
     }
 
     return 0;
@@ -658,10 +808,115 @@ dp_ports_handle_port_mod(struct datapath *dp, struct ofl_msg_port_mod *msg,
         p->conf->config |= msg->config & msg->mask;
     }
 
+    if (msg->mask & OFPPC_PORT_DOWN) {
+        group_table_update_live(dp->groups);
+    }
+
     ofl_msg_free((struct ofl_msg_header *)msg, dp->exp);
     return 0;
 }
 
+/* Updates the link state of the port from its device. Returns true if it
+ * changed. */
+static bool
+update_link_state(struct datapath *dp, struct sw_port *p) {
+    uint32_t state = link_state(p->netdev);
+
+    if ((p->conf->state & OFPPS_LINK_DOWN) == state) {
+        return false;
+    }
+    p->conf->state = (p->conf->state & ~OFPPS_LINK_DOWN) | state;
+
+    VLOG_INFO(LOG_MODULE, "link of port %u (%s) is %s.", p->conf->port_no,
+              p->conf->name, state == 0 ? "up" : "down");
+
+    {
+    struct ofl_msg_port_status msg =
+            {{.type = OFPT_PORT_STATUS},
+             .reason = OFPPR_MODIFY, .desc = p->conf};
+
+    dp_send_message(dp, (struct ofl_msg_header *)&msg, NULL/*sender*/);
+    }
+    return true;
+}
+
+void
+dp_ports_monitor_run(struct datapath *dp) {
+    const char *name;
+    bool changed = false;
+
+    if (dp->port_monitor == NULL) {
+        return;
+    }
+
+    while ((name = netdev_monitor_poll(dp->port_monitor)) != NULL) {
+        struct sw_port *p;
+
+        LIST_FOR_EACH (p, struct sw_port, node, &dp->port_list) {
+            if (p->netdev != NULL && strcmp(netdev_get_name(p->netdev), name) == 0) {
+                changed |= update_link_state(dp, p);
+            }
+        }
+    }
+
+    /* NOTE: fast failover groups switch buckets here, without waiting for
+     *       the controllers. */
+    if (changed) {
+        group_table_update_live(dp->groups);
+    }
+}
+
+void
+dp_ports_monitor_wait(struct datapath *dp) {
+    if (dp->port_monitor != NULL) {
+        netdev_monitor_wait(dp->port_monitor);
+    }
+}
+
+/* A port stats request for all ports, answered in multiple replies. */
+struct port_stats_dump {
+    uint32_t  *ports;      /* numbers of the ports at the time of the request. */
+    size_t     ports_num;
+    size_t     next;       /* index of the next port to reply for. */
+};
+
+static int
+port_stats_dump(struct datapath *dp, const struct sender *sender, void *dump_) {
+    struct port_stats_dump *dump = (struct port_stats_dump *)dump_;
+    size_t max = (DP_STATS_REPLY_MAX - sizeof(struct ofp_stats_reply)) / sizeof(struct ofp_port_stats);
+
+    struct ofl_msg_stats_reply_port reply =
+            {{{.type = OFPT_STATS_REPLY},
+              .type = OFPST_PORT, .flags = 0x0000},
+             .stats_num   = 0,
+             .stats       = xmalloc(sizeof(struct ofl_port_stats *) * max)};
+
+    for (; dump->next < dump->ports_num && reply.stats_num < max; dump->next++) {
+        /* NOTE: ports removed since the request are skipped. */
+        struct sw_port *port = dp_ports_lookup(dp, dump->ports[dump->next]);
+
+        if (port != NULL && port->netdev != NULL) {
+            reply.stats[reply.stats_num++] = port->stats;
+        }
+    }
+    if (dump->next < dump->ports_num) {
+        reply.header.flags = OFPSF_REPLY_MORE;
+    }
+
+    dp_send_message(dp, (struct ofl_msg_header *)&reply, sender);
+
+    free(reply.stats);
+    return dump->next < dump->ports_num ? 1 : 0;
+}
+
+static void
+port_stats_dump_done(void *dump_) {
+    struct port_stats_dump *dump = (struct port_stats_dump *)dump_;
+
+    free(dump->ports);
+    free(dump);
+}
+
 ofl_err
 dp_ports_handle_stats_request_port(struct datapath *dp,
                                   struct ofl_msg_stats_request_port *msg,
@@ -675,24 +930,27 @@ dp_ports_handle_stats_request_port(struct datapath *dp,
              .stats       = NULL};
 
     if (msg->port_no == OFPP_ANY) {
-        size_t i = 0;
+        struct port_stats_dump *dump = xmalloc(sizeof(struct port_stats_dump));
 
-        reply.stats_num = dp->ports_num;
-        reply.stats     = xmalloc(sizeof(struct ofl_port_stats *) * dp->ports_num);
+        dump->ports     = xmalloc(sizeof(uint32_t) * list_size(&dp->port_list));
+        dump->ports_num = 0;
+        dump->next      = 0;
 
         LIST_FOR_EACH(port, struct sw_port, node, &dp->port_list) {
-            reply.stats[i] = port->stats;
-            i++;
+            dump->ports[dump->ports_num++] = port->stats->port_no;
         }
 
-    } else {
-        port = dp_ports_lookup(dp, msg->port_no);
+        ofl_msg_free((struct ofl_msg_header *)msg, dp->exp);
+        dp_start_dump(dp, sender, port_stats_dump, port_stats_dump_done, dump);
+        return 0;
+    }
 
-        if (port != NULL && port->netdev != NULL) {
-            reply.stats_num = 1;
-            reply.stats = xmalloc(sizeof(struct ofl_port_stats *));
-            reply.stats[0] = port->stats;
-        }
+    port = dp_ports_lookup(dp, msg->port_no);
+
+    if (port != NULL && port->netdev != NULL) {
+        reply.stats_num = 1;
+        reply.stats = xmalloc(sizeof(struct ofl_port_stats *));
+        reply.stats[0] = port->stats;
     }
 
     dp_send_message(dp, (struct ofl_msg_header *)&reply, sender);
@@ -60,6 +60,7 @@
 #endif
 
 
+struct packet;
 struct sender;
 
 struct sw_queue {
@@ -110,6 +111,31 @@ struct hw_pkt_q_entry {
 #define DP_MAX_PORTS 255
 BUILD_ASSERT_DECL(DP_MAX_PORTS <= OFPP_MAX);
 
+/* Default number of packets received from a port in one dp_ports_run call. */
+#define DP_RX_BATCH 32
+BUILD_ASSERT_DECL(DP_RX_BATCH <= NETDEV_MAX_BATCH);
+
+/* Number of output frames collected before they are flushed to the ports. */
+#define DP_TX_BATCH 256
+
+/* An output frame waiting to be sent. */
+struct dp_tx_entry {
+    struct sw_port   *port;
+    struct sw_queue  *queue;     /* NULL for best-effort traffic. */
+    uint16_t          class_id;
+    bool              sent;      /* used while flushing. */
+    struct ofpbuf    *buffer;    /* copy of the frame; kept for reuse. */
+    struct ofpbuf    *frame;     /* buffer, or the buffer of an earlier entry
+                                    of the batch with the same frame. */
+};
+
+/* Output frames collected during a pass of the pipeline. Frames are sent out
+ * grouped by port and queue, so each group needs only a few system calls. */
+struct dp_tx_batch {
+    size_t              entries_num;
+    struct dp_tx_entry  entries[DP_TX_BATCH];
+};
+
 
 
 /* Adds a port to the datapath. */
@@ -124,6 +150,20 @@ dp_ports_add_local(struct datapath *dp, const char *netdev);
 void
 dp_ports_run(struct datapath *dp);
 
+/* Updates the link state of the ports which changed, notifying the
+ * controllers and the fast failover groups. */
+void
+dp_ports_monitor_run(struct datapath *dp);
+
+void
+dp_ports_monitor_wait(struct datapath *dp);
+
+/* Receives a batch of packets from the port into the given packets, and runs
+ * them through the pipeline. Packets are allocated as needed, and the ones
+ * consumed are set to NULL. Returns the number of packets received. */
+size_t
+dp_ports_recv(struct datapath *dp, struct sw_port *p, struct packet **pkts);
+
 /* Returns the given port. */
 struct sw_port *
 dp_ports_lookup(struct datapath *, uint32_t);
@@ -132,7 +172,12 @@ dp_ports_lookup(struct datapath *, uint32_t);
 struct sw_queue *
 dp_ports_lookup_queue(struct sw_port *, uint32_t);
 
-/* Outputs a datapath packet on the port. */
+/* Sends out the output frames collected so far. */
+void
+dp_ports_flush(struct datapath *dp);
+
+/* Outputs a datapath packet on the port. The packet is sent at the next
+ * dp_ports_flush call. */
 void
 dp_ports_output(struct datapath *dp, struct ofpbuf *buffer, uint32_t out_port,
               uint32_t queue_id);
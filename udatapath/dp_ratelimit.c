@@ -0,0 +1,229 @@
+/* Copyright (c) 2011, TrafficLab, Ericsson Research, Hungary
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Ericsson Research nor the names of its
+ *     contributors may be used to endorse or promote products derived from
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "datapath.h"
+#include "dp_ports.h"
+#include "dp_ratelimit.h"
+#include "dp_workers.h"
+#include "list.h"
+#include "packet.h"
+#include "poll-loop.h"
+#include "timeval.h"
+#include "util.h"
+
+#include "vlog.h"
+#define LOG_MODULE VLM_dp_rl
+
+static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(60, 60);
+
+/* Number of tokens needed for sending a packet in. */
+#define TOKENS_PER_PKTIN 1000
+
+/* Adds tokens to the bucket based on elapsed time. */
+static void
+refill_bucket(struct dp_ratelimit *lim) {
+    long long int now = time_msec();
+    long long int tokens = (now - lim->last_fill) * lim->rate + lim->tokens;
+
+    if (tokens >= TOKENS_PER_PKTIN) {
+        lim->last_fill = now;
+        lim->tokens = MIN(tokens, (long long int)lim->burst * TOKENS_PER_PKTIN);
+    }
+}
+
+/* Attempts to remove enough tokens from the bucket to send a packet in.
+ * Returns true if successful. */
+static bool
+get_token(struct dp_ratelimit *lim) {
+    if (lim->tokens >= TOKENS_PER_PKTIN) {
+        lim->tokens -= TOKENS_PER_PKTIN;
+        return true;
+    }
+    return false;
+}
+
+/* Returns the queue of the given input port. */
+static struct dp_ratelimit_queue *
+port_queue(struct dp_ratelimit *lim, uint32_t port_no) {
+    return &lim->queues[port_no <= DP_MAX_PORTS ? port_no : 0];
+}
+
+/* Appends the packet in to the queue, keeping the round-robin and length
+ * lists up to date. */
+static void
+push(struct dp_ratelimit *lim, struct dp_ratelimit_queue *q, struct dp_pktin *pi) {
+    if (q->pktins_num == 0) {
+        list_push_back(&lim->active, &q->active_node);
+    } else {
+        list_remove(&q->len_node);
+    }
+    list_push_back(&q->pktins, &pi->node);
+    q->pktins_num++;
+    list_push_back(&lim->by_len[q->pktins_num], &q->len_node);
+    if (q->pktins_num > lim->longest) {
+        lim->longest = q->pktins_num;
+    }
+    lim->queued_num++;
+}
+
+/* Removes the oldest packet in of the queue, keeping the round-robin and
+ * length lists up to date. */
+static struct dp_pktin *
+pop(struct dp_ratelimit *lim, struct dp_ratelimit_queue *q) {
+    struct dp_pktin *pi = CONTAINER_OF(list_pop_front(&q->pktins), struct dp_pktin, node);
+
+    list_remove(&q->len_node);
+    q->pktins_num--;
+    if (q->pktins_num == 0) {
+        list_remove(&q->active_node);
+    } else {
+        list_push_back(&lim->by_len[q->pktins_num], &q->len_node);
+    }
+    while (lim->longest > 0 && list_is_empty(&lim->by_len[lim->longest])) {
+        lim->longest--;
+    }
+    lim->queued_num--;
+    return pi;
+}
+
+/* Drops the oldest packet in of the longest queue. */
+static void
+drop_pktin(struct dp_ratelimit *lim) {
+    struct dp_ratelimit_queue *q;
+    struct dp_pktin *pi;
+    struct sw_port *p;
+
+    q  = CONTAINER_OF(list_front(&lim->by_len[lim->longest]), struct dp_ratelimit_queue, len_node);
+    pi = pop(lim, q);
+
+    p = dp_ports_lookup(lim->dp, pi->pkt->in_port);
+    if (p != NULL) {
+        p->stats->rx_dropped++;
+    }
+    lim->dropped++;
+    VLOG_DBG_RL(LOG_MODULE, &rl, "Dropping packet in of port %u.", pi->pkt->in_port);
+
+    packet_destroy(pi->pkt);
+    free(pi);
+}
+
+struct dp_ratelimit *
+dp_ratelimit_create(struct datapath *dp, uint32_t rate, uint32_t burst) {
+    struct dp_ratelimit *lim = xmalloc(sizeof(struct dp_ratelimit));
+    size_t i;
+
+    lim->dp        = dp;
+    lim->rate      = rate;
+    lim->burst     = burst;
+    lim->last_fill = time_msec();
+    lim->tokens    = (long long int)rate * 100;
+
+    for (i = 0; i <= DP_MAX_PORTS; i++) {
+        list_init(&lim->queues[i].pktins);
+        lim->queues[i].pktins_num = 0;
+    }
+    list_init(&lim->active);
+    lim->by_len = xmalloc(sizeof(struct list) * (burst + 1));
+    for (i = 0; i <= burst; i++) {
+        list_init(&lim->by_len[i]);
+    }
+    lim->longest    = 0;
+    lim->queued_num = 0;
+
+    lim->normal  = 0;
+    lim->limited = 0;
+    lim->dropped = 0;
+
+    return lim;
+}
+
+bool
+dp_ratelimit_admit(struct dp_ratelimit *lim, struct packet *pkt, uint8_t table_id,
+                   uint8_t reason, uint16_t max_len) {
+    struct dp_pktin *pi;
+
+    refill_bucket(lim);
+
+    /* In the common case where the rate is not exceeded, the packet in takes
+     * the normal path. */
+    if (lim->queued_num == 0 && get_token(lim)) {
+        lim->normal++;
+        return true;
+    }
+
+    if (lim->queued_num >= lim->burst) {
+        drop_pktin(lim);
+    }
+
+    pi = xmalloc(sizeof(struct dp_pktin));
+    pi->pkt      = packet_clone(pkt);
+    pi->table_id = table_id;
+    pi->reason   = reason;
+    pi->max_len  = max_len;
+    push(lim, port_queue(lim, pkt->in_port), pi);
+    lim->limited++;
+
+    return false;
+}
+
+struct dp_pktin *
+dp_ratelimit_dequeue(struct dp_ratelimit *lim) {
+    struct dp_ratelimit_queue *q;
+
+    if (lim->queued_num == 0) {
+        return NULL;
+    }
+    refill_bucket(lim);
+    if (!get_token(lim)) {
+        return NULL;
+    }
+
+    q = CONTAINER_OF(list_front(&lim->active), struct dp_ratelimit_queue, active_node);
+    /* the queue goes to the end of the round. */
+    list_remove(&q->active_node);
+    list_push_back(&lim->active, &q->active_node);
+
+    return pop(lim, q);
+}
+
+void
+dp_ratelimit_wait(struct dp_ratelimit *lim) {
+    if (lim->queued_num == 0) {
+        return;
+    }
+    if (lim->tokens >= TOKENS_PER_PKTIN) {
+        poll_immediate_wake();
+    } else {
+        /* the time until the bucket has a token again. */
+        poll_timer_wait((TOKENS_PER_PKTIN - lim->tokens) / lim->rate + 1);
+    }
+}
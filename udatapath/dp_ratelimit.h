@@ -0,0 +1,108 @@
+/* Copyright (c) 2011, TrafficLab, Ericsson Research, Hungary
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Ericsson Research nor the names of its
+ *     contributors may be used to endorse or promote products derived from
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef DP_RATELIMIT_H
+#define DP_RATELIMIT_H 1
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "dp_ports.h"
+#include "list.h"
+
+
+/****************************************************************************
+ * Rate limiting of table miss packet ins, in the datapath. Packet ins are
+ * admitted while the token bucket has tokens. Beyond that they are queued per
+ * input port, and sent round-robin across the ports as the bucket refills.
+ * When the queues are full, the oldest packet in of the longest queue is
+ * dropped, and counted as an rx drop of its port. Packets are only saved in a
+ * buffer and packed once they leave the limiter.
+ ****************************************************************************/
+
+struct datapath;
+struct dp_pktin;
+struct packet;
+
+/* Queue of the packet ins of a port. */
+struct dp_ratelimit_queue {
+    struct list          pktins;      /* queued packet ins, oldest first. */
+    size_t               pktins_num;
+    struct list          active_node; /* node in the round-robin list, while
+                                         the queue is not empty. */
+    struct list          len_node;    /* node in the list of queues with the
+                                         same length, while not empty. */
+};
+
+struct dp_ratelimit {
+    struct datapath     *dp;
+    uint32_t             rate;        /* packets per second. */
+    uint32_t             burst;       /* max number of queued packets. */
+
+    /* Token bucket. It costs 1000 tokens to send a packet in, so that no
+     * division is needed when refilling. */
+    long long int        last_fill;
+    long long int        tokens;
+
+    /* Queues by input port; queue 0 is used for packet ins whose input port
+     * is not a switch port. */
+    struct dp_ratelimit_queue  queues[DP_MAX_PORTS + 1];
+    struct list          active;      /* non-empty queues, in round-robin order. */
+    struct list         *by_len;      /* by_len[n] lists the queues of length n. */
+    size_t               longest;     /* length of the longest queue. */
+    size_t               queued_num;  /* sum of the lengths of the queues. */
+
+    /* Counters, reported in OFP_EXT_PKTIN_RATE_REPLY. */
+    uint64_t             normal;      /* packet ins sent without queueing. */
+    uint64_t             limited;     /* packet ins queued. */
+    uint64_t             dropped;     /* packet ins dropped from the queues. */
+};
+
+/* Creates a rate limiter of rate packet ins per second, queueing up to burst
+ * packet ins. */
+struct dp_ratelimit *
+dp_ratelimit_create(struct datapath *dp, uint32_t rate, uint32_t burst);
+
+/* Returns true if the packet in may be sent right away. Otherwise a copy of
+ * the packet is queued, and false is returned. The caller keeps ownership of
+ * pkt. */
+bool
+dp_ratelimit_admit(struct dp_ratelimit *rl, struct packet *pkt, uint8_t table_id,
+                   uint8_t reason, uint16_t max_len);
+
+/* Returns the next queued packet in which may be sent, or NULL if there is
+ * none or the rate does not allow it. The caller takes ownership of it. */
+struct dp_pktin *
+dp_ratelimit_dequeue(struct dp_ratelimit *rl);
+
+/* Registers with the poll loop for when queued packet ins may be sent. */
+void
+dp_ratelimit_wait(struct dp_ratelimit *rl);
+
+
+#endif /* DP_RATELIMIT_H */
@@ -0,0 +1,256 @@
+/* Copyright (c) 2011, TrafficLab, Ericsson Research, Hungary
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Ericsson Research nor the names of its
+ *     contributors may be used to endorse or promote products derived from
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "datapath.h"
+#include "dp_ports.h"
+#include "dp_workers.h"
+#include "flow_cache.h"
+#include "netdev.h"
+#include "packet.h"
+#include "poll-loop.h"
+#include "timeval.h"
+#include "util.h"
+
+#include "vlog.h"
+#define LOG_MODULE VLM_dp_workers
+
+/* Time a worker without traffic waits in poll, in milliseconds. */
+#define WORKER_POLL_MSEC 100
+
+static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(60, 60);
+
+static __thread struct dp_worker *current_worker = NULL;
+static __thread uint64_t          current_clock  = 0;
+
+static void *
+worker_main(void *worker_) {
+    struct dp_worker *w = worker_;
+    struct pollfd fds[DP_MAX_PORTS];
+    size_t i;
+
+    current_worker = w;
+
+    for (i = 0; i < w->ports_num; i++) {
+        fds[i].fd = netdev_get_fd(w->ports[i]->netdev);
+        fds[i].events = POLLIN;
+    }
+
+    for (;;) {
+        size_t received = 0;
+
+        rcu_read_lock(&w->dp->rcu, &w->reader);
+        for (i = 0; i < w->ports_num; i++) {
+            received += dp_ports_recv(w->dp, w->ports[i], w->rx_pkts);
+        }
+        dp_ports_flush(w->dp);
+        rcu_read_unlock(&w->dp->rcu, &w->reader);
+
+        if (received == 0) {
+            if (poll(fds, w->ports_num, WORKER_POLL_MSEC) < 0 && errno != EINTR) {
+                VLOG_WARN(LOG_MODULE, "worker %zu: poll failed: %s", w->id, strerror(errno));
+            }
+        }
+    }
+
+    return NULL;
+}
+
+void
+dp_workers_start(struct datapath *dp, size_t workers_num) {
+    struct dp_workers *ws;
+    struct sw_port *p;
+    sigset_t all, old;
+    size_t next = 0;
+    size_t ports_num = 0;
+    size_t i;
+
+    LIST_FOR_EACH (p, struct sw_port, node, &dp->port_list) {
+        if (!IS_HW_PORT(p)) {
+            ports_num++;
+        }
+    }
+    if (workers_num > ports_num) {
+        VLOG_WARN(LOG_MODULE, "only %zu ports for %zu threads; starting %zu.",
+                  ports_num, workers_num, ports_num);
+        workers_num = ports_num;
+    }
+    if (workers_num == 0) {
+        return;
+    }
+
+    ws = xmalloc(sizeof(struct dp_workers));
+    ws->workers     = xmalloc(sizeof(struct dp_worker) * workers_num);
+    ws->workers_num = workers_num;
+    pthread_mutex_init(&ws->pktin_lock, NULL);
+    list_init(&ws->pktins);
+    ws->pktins_num  = 0;
+    if (pipe(ws->wake_fds) != 0) {
+        ofp_fatal(errno, "could not create pipe for threads");
+    }
+    fcntl(ws->wake_fds[0], F_SETFL, O_NONBLOCK);
+    fcntl(ws->wake_fds[1], F_SETFL, O_NONBLOCK);
+
+    for (i = 0; i < workers_num; i++) {
+        struct dp_worker *w = &ws->workers[i];
+
+        memset(w, 0x00, sizeof(struct dp_worker));
+        w->dp    = dp;
+        w->id    = i;
+        w->cache = flow_cache_create();
+        rcu_register(&dp->rcu, &w->reader);
+    }
+
+    /* ports are assigned round-robin. */
+    LIST_FOR_EACH (p, struct sw_port, node, &dp->port_list) {
+        struct dp_worker *w;
+
+        if (IS_HW_PORT(p)) {
+            continue;
+        }
+        w = &ws->workers[next];
+        w->ports[w->ports_num++] = p;
+        next = (next + 1) % workers_num;
+    }
+
+    dp->workers = ws;
+
+    /* signals are left to the control thread. */
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    for (i = 0; i < workers_num; i++) {
+        int error = pthread_create(&ws->workers[i].thread, NULL, worker_main, &ws->workers[i]);
+        if (error) {
+            ofp_fatal(error, "could not create thread");
+        }
+    }
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+    VLOG_INFO(LOG_MODULE, "started %zu threads.", workers_num);
+}
+
+struct dp_worker *
+dp_workers_current(void) {
+    return current_worker;
+}
+
+size_t
+dp_workers_slot(void) {
+    return (current_worker == NULL) ? 0 : current_worker->id + 1;
+}
+
+size_t
+dp_workers_slots(struct datapath *dp) {
+    return (dp->workers == NULL) ? 1 : dp->workers->workers_num + 1;
+}
+
+void
+dp_workers_clock_update(void) {
+    current_clock = time_msec();
+}
+
+uint64_t
+dp_workers_clock(void) {
+    return current_clock;
+}
+
+void
+dp_workers_packet_in(struct datapath *dp, struct packet *pkt, uint8_t table_id,
+                     uint8_t reason, uint16_t max_len) {
+    struct dp_workers *ws = dp->workers;
+    struct dp_pktin *pi;
+    char c = 0;
+
+    pthread_mutex_lock(&ws->pktin_lock);
+    if (ws->pktins_num == DP_WORKERS_PKTIN_MAX) {
+        pthread_mutex_unlock(&ws->pktin_lock);
+        VLOG_WARN_RL(LOG_MODULE, &rl, "packet in queue is full, dropping packet in.");
+        packet_destroy(pkt);
+        return;
+    }
+    pi = xmalloc(sizeof(struct dp_pktin));
+    pi->pkt      = pkt;
+    pi->table_id = table_id;
+    pi->reason   = reason;
+    pi->max_len  = max_len;
+    list_push_back(&ws->pktins, &pi->node);
+    ws->pktins_num++;
+    pthread_mutex_unlock(&ws->pktin_lock);
+
+    if (write(ws->wake_fds[1], &c, 1) < 0 && errno != EAGAIN) {
+        VLOG_WARN_RL(LOG_MODULE, &rl, "could not wake control thread: %s", strerror(errno));
+    }
+}
+
+void
+dp_workers_run(struct datapath *dp) {
+    struct dp_workers *ws = dp->workers;
+    struct dp_pktin *pi, *next;
+    struct list pktins;
+    char buf[64];
+
+    if (ws == NULL) {
+        return;
+    }
+
+    while (read(ws->wake_fds[0], buf, sizeof(buf)) > 0) {
+        /* drain. */
+    }
+
+    /* the queue is taken over at once, so workers are not held up while
+     * the messages are sent. */
+    pthread_mutex_lock(&ws->pktin_lock);
+    if (list_is_empty(&ws->pktins)) {
+        pthread_mutex_unlock(&ws->pktin_lock);
+        return;
+    }
+    list_replace(&pktins, &ws->pktins);
+    list_init(&ws->pktins);
+    ws->pktins_num = 0;
+    pthread_mutex_unlock(&ws->pktin_lock);
+
+    LIST_FOR_EACH_SAFE (pi, next, struct dp_pktin, node, &pktins) {
+        dp_send_packet_in(dp, pi->pkt, pi->table_id, pi->reason, pi->max_len);
+        packet_destroy(pi->pkt);
+        free(pi);
+    }
+}
+
+void
+dp_workers_wait(struct datapath *dp) {
+    if (dp->workers != NULL) {
+        poll_fd_wait(dp->workers->wake_fds[0], POLLIN);
+    }
+}
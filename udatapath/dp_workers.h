@@ -0,0 +1,141 @@
+/* Copyright (c) 2011, TrafficLab, Ericsson Research, Hungary
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Ericsson Research nor the names of its
+ *     contributors may be used to endorse or promote products derived from
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef DP_WORKERS_H
+#define DP_WORKERS_H 1
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "dp_ports.h"
+#include "list.h"
+#include "netdev.h"
+#include "rcu.h"
+
+
+/****************************************************************************
+ * Worker threads of the datapath. Each worker receives packets from a subset
+ * of the ports, runs them through the pipeline and transmits the outcome.
+ * Control channel handling and timeouts stay on the main (control) thread.
+ *
+ * Every worker is an rcu reader, and processes a batch of packets in one
+ * read side critical section. The control thread modifies the flow and group
+ * tables while the workers run; removed entries are only freed once no
+ * worker can hold a reference to them, and the few modifications which
+ * cannot be published atomically wait for the workers in an exclusive
+ * section. Packet ins of the workers are queued, and sent to the
+ * controllers by the control thread.
+ ****************************************************************************/
+
+struct datapath;
+struct flow_cache;
+struct packet;
+
+/* Adds to a counter, which may be updated by several workers concurrently. */
+#define DP_COUNTER_ADD(COUNTER, N) ((void) __sync_fetch_and_add(&(COUNTER), (N)))
+
+struct dp_worker {
+    struct datapath     *dp;
+    size_t               id;
+    pthread_t            thread;
+    struct rcu_reader    reader;
+
+    struct sw_port      *ports[DP_MAX_PORTS];
+    size_t               ports_num;
+
+    struct flow_cache   *cache;         /* private flow cache. */
+    struct dp_tx_batch   tx;            /* private output batch. */
+    struct packet       *rx_pkts[NETDEV_MAX_BATCH];
+};
+
+/* Maximum number of packet ins waiting for the control thread. */
+#define DP_WORKERS_PKTIN_MAX 1024
+
+/* A packet in queued by a worker. */
+struct dp_pktin {
+    struct list          node;
+    struct packet       *pkt;
+    uint8_t              table_id;
+    uint8_t              reason;
+    uint16_t             max_len;
+};
+
+struct dp_workers {
+    struct dp_worker    *workers;
+    size_t               workers_num;
+    pthread_mutex_t      pktin_lock;    /* protects pktins. */
+    struct list          pktins;        /* packet ins for the control thread. */
+    size_t               pktins_num;
+    int                  wake_fds[2];   /* wakes the control thread. */
+};
+
+/* Starts the given number of worker threads, and assigns the ports of the
+ * datapath to them. */
+void
+dp_workers_start(struct datapath *dp, size_t workers_num);
+
+/* Returns the worker of the calling thread; NULL on the control thread. */
+struct dp_worker *
+dp_workers_current(void);
+
+/* Returns the index of the calling thread among the threads processing
+ * packets: 0 for the control thread, and one plus the id for workers. */
+size_t
+dp_workers_slot(void);
+
+/* Returns the number of threads which may process packets; per thread state
+ * is indexed by dp_workers_slot(). */
+size_t
+dp_workers_slots(struct datapath *dp);
+
+/* Stamps the clock of the calling thread with the current time. Called once
+ * per batch of received packets, so that processing the packets of the batch
+ * does not have to read the time. */
+void
+dp_workers_clock_update(void);
+
+/* Returns the time the calling thread last stamped its clock at, in ms. */
+uint64_t
+dp_workers_clock(void);
+
+/* Queues a packet in for the control thread. Takes ownership of pkt. */
+void
+dp_workers_packet_in(struct datapath *dp, struct packet *pkt, uint8_t table_id,
+                     uint8_t reason, uint16_t max_len);
+
+/* Sends the queued packet ins on the control thread. */
+void
+dp_workers_run(struct datapath *dp);
+
+/* Registers with the poll loop for wake up requests of the workers. */
+void
+dp_workers_wait(struct datapath *dp);
+
+
+#endif /* DP_WORKERS_H */
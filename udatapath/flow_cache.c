@@ -0,0 +1,97 @@
+/* Copyright (c) 2011, TrafficLab, Ericsson Research, Hungary
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Ericsson Research nor the names of its
+ *     contributors may be used to endorse or promote products derived from
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "classifier.h"
+#include "flow_cache.h"
+#include "hash.h"
+#include "util.h"
+
+
+static inline struct flow_cache_entry *
+cache_slot(struct flow_cache *cache, uint8_t table_id, struct flow_key *key) {
+    uint32_t hash = hash_words((const uint32_t *)key,
+                               sizeof(struct flow_key) / sizeof(uint32_t), table_id);
+
+    return &cache->entries[hash & FLOW_CACHE_MASK];
+}
+
+struct flow_cache *
+flow_cache_create(void) {
+    struct flow_cache *cache = xmalloc(sizeof(struct flow_cache));
+
+    cache->hits   = 0;
+    cache->misses = 0;
+    flow_cache_flush(cache);
+
+    return cache;
+}
+
+void
+flow_cache_destroy(struct flow_cache *cache) {
+    free(cache);
+}
+
+bool
+flow_cache_lookup(struct flow_cache *cache, uint8_t table_id, uint64_t version,
+                  struct flow_key *key, struct flow_entry **entry) {
+    struct flow_cache_entry *ce = cache_slot(cache, table_id, key);
+
+    if (ce->valid && ce->table_id == table_id && ce->version == version &&
+        memcmp(&ce->key, key, sizeof(struct flow_key)) == 0) {
+        cache->hits++;
+        *entry = ce->entry;
+        return true;
+    }
+
+    cache->misses++;
+    return false;
+}
+
+void
+flow_cache_insert(struct flow_cache *cache, uint8_t table_id, uint64_t version,
+                  struct flow_key *key, struct flow_entry *entry) {
+    struct flow_cache_entry *ce = cache_slot(cache, table_id, key);
+
+    ce->key      = *key;
+    ce->version  = version;
+    ce->entry    = entry;
+    ce->table_id = table_id;
+    ce->valid    = true;
+}
+
+void
+flow_cache_flush(struct flow_cache *cache) {
+    size_t i;
+
+    for (i=0; i<FLOW_CACHE_SIZE; i++) {
+        cache->entries[i].valid = false;
+    }
+}
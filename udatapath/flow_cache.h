@@ -0,0 +1,92 @@
+/* Copyright (c) 2011, TrafficLab, Ericsson Research, Hungary
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Ericsson Research nor the names of its
+ *     contributors may be used to endorse or promote products derived from
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef FLOW_CACHE_H
+#define FLOW_CACHE_H 1
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "classifier.h"
+
+
+/****************************************************************************
+ * Exact match cache of flow table lookups. Remembers the result of each
+ * (table, packet fields) lookup, so packets of established flows skip
+ * classification in every table they visit.
+ *
+ * A cached result is only valid while the classifier of the table is at the
+ * version it was cached at. Since every addition, replacement and removal of
+ * a flow entry (due to flow_mod, timeouts or group deletion) advances the
+ * version, stale results, including dangling entry pointers, are never used.
+ ****************************************************************************/
+
+#define FLOW_CACHE_BITS 13
+#define FLOW_CACHE_SIZE (1 << FLOW_CACHE_BITS)
+#define FLOW_CACHE_MASK (FLOW_CACHE_SIZE - 1)
+
+struct flow_entry;
+
+struct flow_cache_entry {
+    struct flow_key     key;       /* fields extracted from the packet. */
+    uint64_t            version;   /* classifier version of the table. */
+    struct flow_entry  *entry;     /* result of the lookup; NULL on table miss. */
+    uint8_t             table_id;
+    bool                valid;
+};
+
+struct flow_cache {
+    uint64_t                 hits;
+    uint64_t                 misses;
+    struct flow_cache_entry  entries[FLOW_CACHE_SIZE];
+};
+
+/* Creates an empty cache. */
+struct flow_cache *
+flow_cache_create(void);
+
+/* Destroys the cache. */
+void
+flow_cache_destroy(struct flow_cache *cache);
+
+/* Looks up the cached result for the key in the given table. Returns true and
+ * sets entry if a valid result was found. */
+bool
+flow_cache_lookup(struct flow_cache *cache, uint8_t table_id, uint64_t version,
+                  struct flow_key *key, struct flow_entry **entry);
+
+/* Stores the result of a lookup in the cache. */
+void
+flow_cache_insert(struct flow_cache *cache, uint8_t table_id, uint64_t version,
+                  struct flow_key *key, struct flow_entry *entry);
+
+/* Invalidates all cached results. */
+void
+flow_cache_flush(struct flow_cache *cache);
+
+
+#endif /* FLOW_CACHE_H */
@@ -31,12 +31,14 @@
 
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 #include "datapath.h"
 #include "dp_actions.h"
 #include "flow_table.h"
 #include "flow_entry.h"
 #include "group_table.h"
 #include "group_entry.h"
+#include "pipeline.h"
 #include "oflib/ofl-messages.h"
 #include "oflib/ofl-structs.h"
 #include "oflib/ofl-actions.h"
@@ -62,6 +64,12 @@ init_group_refs(struct flow_entry *entry);
 static void
 del_group_refs(struct flow_entry *entry);
 
+static struct flow_program *
+compile_program(struct flow_entry *entry);
+
+static void
+free_program(void *program_);
+
 bool
 flow_entry_has_out_port(struct flow_entry *entry, uint32_t port) {
     size_t i;
@@ -126,23 +134,52 @@ void
 flow_entry_replace_instructions(struct flow_entry *entry,
                                       size_t instructions_num,
                                       struct ofl_instruction_header **instructions) {
+    struct flow_program *old = entry->program;
 
     /* TODO Zoltan: could be done more efficiently, but... */
     del_group_refs(entry);
 
-    OFL_UTILS_FREE_ARR_FUN2(entry->stats->instructions, entry->stats->instructions_num,
-                            ofl_structs_free_instruction, entry->dp->exp);
+    /* Packets being processed on worker threads may still execute the old
+     * program, so the old instructions are freed together with it. */
+    old->instructions_num = entry->stats->instructions_num;
+    old->instructions     = entry->stats->instructions;
 
     entry->stats->instructions_num = instructions_num;
     entry->stats->instructions     = instructions;
 
+    entry->program = compile_program(entry);
+    rcu_defer(&entry->dp->rcu, free_program, old);
+
     init_group_refs(entry);
 }
 
+/* Folds the counters of the threads into the entry. */
+static void
+fold_counters(struct flow_entry *entry) {
+    uint64_t packet_count = 0;
+    uint64_t byte_count   = 0;
+    size_t i;
+
+    /* NOTE: the counters are read while the threads may be updating them;
+     *       each value is read in a single access. */
+    for (i = 0; i < entry->counters_num; i++) {
+        struct flow_counters *c = &entry->counters[i];
+
+        packet_count += c->packet_count;
+        byte_count   += c->byte_count;
+        if (c->last_used > entry->last_used) {
+            entry->last_used = c->last_used;
+        }
+    }
+    entry->stats->packet_count = packet_count;
+    entry->stats->byte_count   = byte_count;
+}
+
 bool
 flow_entry_idle_timeout(struct flow_entry *entry) {
     bool timeout;
 
+    fold_counters(entry);
     timeout = (entry->stats->idle_timeout != 0) &&
               (time_msec() > entry->last_used + entry->stats->idle_timeout * 1000);
 
@@ -164,8 +201,32 @@ flow_entry_hard_timeout(struct flow_entry *entry) {
     return timeout;
 }
 
+/* Called when the idle timer of the entry expires. */
+static void
+idle_expired(struct timer_wheel_timer *timer) {
+    struct flow_entry *entry = CONTAINER_OF(timer, struct flow_entry, idle_timer);
+
+    /* NOTE: the timer is not moved when packets hit the entry, so it is
+     *       rescheduled here if the entry was used since. */
+    if (!flow_entry_idle_timeout(entry)) {
+        timer_wheel_add(&entry->table->timers, &entry->idle_timer,
+                        entry->last_used + entry->stats->idle_timeout * 1000 + 1);
+    }
+}
+
+/* Called when the hard timer of the entry expires. */
+static void
+hard_expired(struct timer_wheel_timer *timer) {
+    struct flow_entry *entry = CONTAINER_OF(timer, struct flow_entry, hard_timer);
+
+    if (!flow_entry_hard_timeout(entry)) {
+        timer_wheel_add(&entry->table->timers, &entry->hard_timer, entry->remove_at + 1);
+    }
+}
+
 void
 flow_entry_update(struct flow_entry *entry) {
+    fold_counters(entry);
     entry->stats->duration_sec  =  (time_msec() - entry->created) / 1000;
     entry->stats->duration_nsec = ((time_msec() - entry->created) % 1000) * 1000;
 }
@@ -278,6 +339,107 @@ del_group_refs(struct flow_entry *entry) {
     }
 }
 
+/* Compiles the instructions of the flow entry into a program. The program is
+ * allocated in a single block, and is published only after it is complete. */
+static struct flow_program *
+compile_program(struct flow_entry *entry) {
+    struct ofl_instruction_header **insts = entry->stats->instructions;
+    size_t insts_num = entry->stats->instructions_num;
+    struct flow_program *prog;
+    size_t apply_num = 0, write_num = 0, exp_num = 0;
+    size_t i, j;
+
+    for (i=0; i < insts_num; i++) {
+        if (insts[i]->type == OFPIT_APPLY_ACTIONS) {
+            apply_num += ((struct ofl_instruction_actions *)insts[i])->actions_num;
+        } else if (insts[i]->type == OFPIT_WRITE_ACTIONS) {
+            write_num += ((struct ofl_instruction_actions *)insts[i])->actions_num;
+        } else if (insts[i]->type == OFPIT_EXPERIMENTER) {
+            exp_num++;
+        }
+    }
+
+    prog = xmalloc(sizeof(struct flow_program) +
+                   apply_num * sizeof(struct dp_op) +
+                   write_num * sizeof(struct ofl_action_header *) +
+                   exp_num   * sizeof(struct ofl_instruction_experimenter *));
+    prog->apply = (struct dp_op *)(prog + 1);
+    prog->write = (struct ofl_action_header **)(prog->apply + apply_num);
+    prog->exp   = (struct ofl_instruction_experimenter **)(prog->write + write_num);
+
+    prog->apply_num      = 0;
+    prog->clear          = false;
+    prog->write_num      = 0;
+    prog->write_metadata = false;
+    prog->metadata       = 0;
+    prog->metadata_mask  = 0;
+    prog->exp_num        = 0;
+    prog->goto_table     = NULL;
+
+    prog->instructions_num = 0;
+    prog->instructions     = NULL;
+    prog->ofl_exp          = entry->dp->exp;
+
+    for (i=0; i < insts_num; i++) {
+        switch (insts[i]->type) {
+            case OFPIT_GOTO_TABLE: {
+                struct ofl_instruction_goto_table *gi = (struct ofl_instruction_goto_table *)insts[i];
+
+                prog->goto_table = entry->dp->pipeline->tables[gi->table_id];
+                break;
+            }
+            case OFPIT_WRITE_METADATA: {
+                struct ofl_instruction_write_metadata *wi = (struct ofl_instruction_write_metadata *)insts[i];
+
+                prog->write_metadata = true;
+                prog->metadata       = wi->metadata & wi->metadata_mask;
+                prog->metadata_mask  = wi->metadata_mask;
+                break;
+            }
+            case OFPIT_WRITE_ACTIONS: {
+                struct ofl_instruction_actions *wa = (struct ofl_instruction_actions *)insts[i];
+
+                for (j=0; j < wa->actions_num; j++) {
+                    prog->write[prog->write_num++] = wa->actions[j];
+                }
+                break;
+            }
+            case OFPIT_APPLY_ACTIONS: {
+                struct ofl_instruction_actions *ia = (struct ofl_instruction_actions *)insts[i];
+
+                for (j=0; j < ia->actions_num; j++) {
+                    dp_actions_compile(&prog->apply[prog->apply_num++], ia->actions[j]);
+                }
+                break;
+            }
+            case OFPIT_CLEAR_ACTIONS: {
+                prog->clear = true;
+                break;
+            }
+            case OFPIT_EXPERIMENTER: {
+                prog->exp[prog->exp_num++] = (struct ofl_instruction_experimenter *)insts[i];
+                break;
+            }
+        }
+    }
+
+    rcu_barrier();
+    return prog;
+}
+
+/* Frees the program, and the instructions it was compiled from if they were
+ * handed over to it. */
+static void
+free_program(void *program_) {
+    struct flow_program *prog = (struct flow_program *)program_;
+
+    if (prog->instructions != NULL) {
+        OFL_UTILS_FREE_ARR_FUN2(prog->instructions, prog->instructions_num,
+                                ofl_structs_free_instruction, prog->ofl_exp);
+    }
+    free(prog);
+}
+
 
 struct flow_entry *
 flow_entry_create(struct datapath *dp, struct flow_table *table, struct ofl_msg_flow_mod *mod) {
@@ -307,32 +469,67 @@ flow_entry_create(struct datapath *dp, struct flow_table *table, struct ofl_msg_
     entry->stats->instructions     = mod->instructions;
 
     entry->match = make_mod_match(mod->match);
+    entry->layer = packet_handle_std_match_layer(entry->match != NULL
+                        ? (struct ofl_match_standard *)entry->match
+                        : (struct ofl_match_standard *)mod->match);
 
     entry->created      = now;
     entry->remove_at    = mod->hard_timeout == 0 ? 0
                                   : now + mod->hard_timeout * 1000;
     entry->last_used    = now;
+    entry->counters_num = dp_workers_slots(dp);
+    if (posix_memalign((void **)&entry->counters, FLOW_COUNTERS_ALIGN,
+                       sizeof(struct flow_counters) * entry->counters_num) != 0) {
+        out_of_memory();
+    }
+    memset(entry->counters, 0x00, sizeof(struct flow_counters) * entry->counters_num);
+    entry->table_rollup  = NULL;
+    entry->cookie_rollup = NULL;
     entry->send_removed = ((mod->flags & OFPFF_SEND_FLOW_REM) != 0);
 
     list_init(&entry->match_node);
-    list_init(&entry->idle_node);
-    list_init(&entry->hard_node);
+    timer_wheel_timer_init(&entry->idle_timer, idle_expired);
+    timer_wheel_timer_init(&entry->hard_timer, hard_expired);
 
     list_init(&entry->group_refs);
     init_group_refs(entry);
 
+    entry->program = compile_program(entry);
+
     return entry;
 }
 
+static void
+free_entry(void *entry_) {
+    struct flow_entry *entry = (struct flow_entry *)entry_;
+
+    if (entry->table_rollup != NULL) {
+        uint64_t packet_count = entry->stats->packet_count;
+        uint64_t byte_count   = entry->stats->byte_count;
+
+        /* NOTE: packets counted on the entry after it was removed from the
+         *       rollups are removed now, as no thread can count it anymore. */
+        fold_counters(entry);
+        flow_table_rollups_release(entry, entry->stats->packet_count - packet_count,
+                                          entry->stats->byte_count - byte_count);
+    }
+    ofl_structs_free_flow_stats(entry->stats, entry->dp->exp);
+    free_program(entry->program);
+    // assumes it is a standard match
+    free(entry->match);
+    free(entry->counters);
+    free(entry);
+}
+
 void
 flow_entry_destroy(struct flow_entry *entry) {
     // NOTE: This will be called when the group entry itself destroys the
     //       flow; but it won't be a problem.
     del_group_refs(entry);
-    ofl_structs_free_flow_stats(entry->stats, entry->dp->exp);
-    // assumes it is a standard match
-    free(entry->match);
-    free(entry);
+    timer_wheel_del(&entry->table->timers, &entry->idle_timer);
+    timer_wheel_del(&entry->table->timers, &entry->hard_timer);
+    /* lookups running on worker threads may still use the entry. */
+    rcu_defer(&entry->dp->rcu, free_entry, entry);
 }
 
 void
@@ -349,9 +546,13 @@ flow_entry_remove(struct flow_entry *entry, uint8_t reason) {
         }
     }
 
+    flow_table_cursors_skip(entry->table, entry);
+    flow_table_rollups_remove(entry->table, entry);
     list_remove(&entry->match_node);
-    list_remove(&entry->hard_node);
-    list_remove(&entry->idle_node);
+    hmap_remove(&entry->table->strict_index, &entry->strict_node);
+    hmap_remove(&entry->table->cookie_index, &entry->cookie_node);
+    classifier_remove(&entry->table->classifier, &entry->cls_rule);
+    flow_table_del_layer(entry->table, entry->layer);
     entry->table->stats->active_count--;
     flow_entry_destroy(entry);
 }
@@ -35,33 +35,101 @@
 
 #include <stdbool.h>
 #include <sys/types.h>
+#include "classifier.h"
 #include "datapath.h"
+#include "dp_actions.h"
+#include "hmap.h"
 #include "list.h"
 #include "oflib/ofl-structs.h"
 #include "oflib/ofl-messages.h"
+#include "timer_wheel.h"
 #include "timeval.h"
 
 /****************************************************************************
  * Implementation of a flow table entry.
  ****************************************************************************/
 
+/* The instructions of a flow entry compiled for execution, in the order the
+ * spec requires them to be executed in. */
+struct flow_program {
+    size_t                                apply_num;
+    struct dp_op                         *apply;
+    bool                                  clear;
+    size_t                                write_num;
+    struct ofl_action_header            **write;
+    bool                                  write_metadata;
+    uint64_t                              metadata;      /* masked with metadata_mask. */
+    uint64_t                              metadata_mask;
+    size_t                                exp_num;
+    struct ofl_instruction_experimenter **exp;
+    struct flow_table                    *goto_table;    /* NULL if there is no goto. */
+
+    /* instructions handed over when the program is replaced, to be freed
+       together with it. */
+    size_t                                instructions_num;
+    struct ofl_instruction_header       **instructions;
+    struct ofl_exp                       *ofl_exp;
+};
+
+/* Size of a cache line; counters of different threads are kept on separate
+ * lines. */
+#define FLOW_COUNTERS_ALIGN 64
+
+/* Counters of a flow entry updated by a single thread. They are folded into
+ * the statistics of the entry when those are needed. */
+struct flow_counters {
+    uint64_t                 packet_count;
+    uint64_t                 byte_count;
+    uint64_t                 last_used;
+    uint8_t                  pad[FLOW_COUNTERS_ALIGN - 3 * sizeof(uint64_t)];
+};
+
+/* Aggregate statistics of a set of entries of a flow table, maintained as the
+ * entries are added, counted and removed, so that common aggregate stats
+ * requests can be answered without visiting the entries. The counts of
+ * removed entries are kept separately, and subtracted from the counters. */
+struct flow_rollup {
+    struct hmap_node         node;          /* in the cookie rollups of the table. */
+    uint64_t                 cookie;
+    uint32_t                 flow_count;    /* entries in the rollup. */
+    size_t                   refs;          /* entries not yet freed, and the table. */
+    uint64_t                 packets_removed;
+    uint64_t                 bytes_removed;
+    struct flow_counters    *counters;      /* indexed by dp_workers_slot();
+                                               last_used is not used. */
+    size_t                   counters_num;
+};
+
 struct flow_entry {
     struct list              match_node;  /* list nodes in flow table lists. */
-    struct list              hard_node;
-    struct list              idle_node;
+    struct timer_wheel_timer hard_timer;  /* timers in the flow table's wheel. */
+    struct timer_wheel_timer idle_timer;
+    struct cls_rule          cls_rule;    /* rule in the flow table classifier. */
+    struct hmap_node         strict_node; /* node in the strict flow mod index. */
+    struct hmap_node         cookie_node; /* node in the cookie index. */
 
     struct datapath         *dp;
     struct flow_table       *table;
     struct ofl_flow_stats   *stats;
+    struct flow_program     *program; /* compiled instructions; replaced as a
+                                         whole when the instructions change. */
     struct ofl_match_header *match; /* Original match structure is stored in stats;
                                        this one is a modified version, which reflects
                                        1.1 matching rules. */
     uint64_t                 created;  /* time the entry was created at. */
     uint64_t                 remove_at; /* time the entry should be removed at
                                            due to its hard timeout. */
-    uint64_t                 last_used; /* last time the flow entry matched a packet */
+    uint64_t                 last_used; /* last time the flow entry matched a packet,
+                                           as of the last fold of the counters. */
+    struct flow_counters    *counters;  /* counters of the threads processing
+                                           packets, indexed by dp_workers_slot(). */
+    size_t                   counters_num;
+    struct flow_rollup      *table_rollup;  /* rollups the entry is counted on; */
+    struct flow_rollup      *cookie_rollup; /* NULL until added to the table. */
     bool                     send_removed; /* true if a flow removed should be sent
                                               when removing a flow. */
+    uint8_t                  layer;       /* layer packets must be parsed up to
+                                             for matching the entry. */
 
     struct list              group_refs;  /* list of groups referencing the flow. */
 };
@@ -100,8 +168,31 @@ flow_entry_has_out_port(struct flow_entry *entry, uint32_t port);
 bool
 flow_entry_has_out_group(struct flow_entry *entry, uint32_t group);
 
-/* Updates the time fields of the flow entry statistics. Used before generating
- * flow statistics messages. */
+/* Counts a packet of the given size matching the entry, on the counters of
+ * the calling thread. */
+static inline void
+flow_entry_count(struct flow_entry *entry, size_t slot, size_t bytes, uint64_t now) {
+    struct flow_counters *c;
+
+    /* NOTE: the rollups are counted first, so the counts of an entry removed
+     *       from them never exceed what they counted. */
+    c = &entry->table_rollup->counters[slot];
+    c->packet_count++;
+    c->byte_count += bytes;
+
+    c = &entry->cookie_rollup->counters[slot];
+    c->packet_count++;
+    c->byte_count += bytes;
+
+    c = &entry->counters[slot];
+    c->packet_count++;
+    c->byte_count += bytes;
+    c->last_used   = now;
+}
+
+/* Folds the per thread counters into the statistics and last_used, and
+ * updates the time fields of the flow entry statistics. Used before
+ * generating flow statistics messages. */
 void
 flow_entry_update(struct flow_entry *entry);
 
@@ -30,8 +30,10 @@
  */
 
 #include <stdbool.h>
+#include <stdlib.h>
 #include <string.h>
 #include "dynamic-string.h"
+#include "hash.h"
 #include "datapath.h"
 #include "dp_capabilities.h"
 #include "flow_table.h"
@@ -40,65 +42,300 @@
 #include "time.h"
 #include "packet_handle_std.h"
 #include "match_std.h"
+#include "util.h"
 
 #include "vlog.h"
 #define LOG_MODULE VLM_flow_t
 
-static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(60, 60);
-
-/* When inserting an entry, this function adds the flow entry to the list of
- * hard and idle timeout entries, if appropriate. */
+/* When inserting an entry, this function schedules its hard and idle
+ * timeouts, if appropriate. */
 static void
-add_to_timeout_lists(struct flow_table *table, struct flow_entry *entry) {
+schedule_timeouts(struct flow_table *table, struct flow_entry *entry) {
+    /* NOTE: flow_entry_*_timeout only time out entries strictly after their
+     *       deadline, hence the extra millisecond. */
     if (entry->stats->idle_timeout > 0) {
-        list_insert(&table->idle_entries, &entry->idle_node);
+        timer_wheel_add(&table->timers, &entry->idle_timer,
+                        entry->last_used + entry->stats->idle_timeout * 1000 + 1);
     }
 
     if (entry->remove_at > 0) {
-        struct flow_entry *e;
+        timer_wheel_add(&table->timers, &entry->hard_timer, entry->remove_at + 1);
+    }
+}
+
+/* Returns the match the entry should be classified by. */
+static inline struct ofl_match_header *
+lookup_match(struct flow_entry *entry) {
+    return entry->match == NULL ? entry->stats->match : entry->match;
+}
+
+void
+flow_table_add_layer(struct flow_table *table, uint8_t layer) {
+    table->layer_entries[layer]++;
+
+    if (layer > table->layer) {
+        /* lookups running with the lower layer could miss the entry's
+         * fields, so wait for them to finish. This only happens when the
+         * first entry matching on a deeper layer is added. */
+        rcu_exclusive_begin(&table->dp->rcu);
+        table->layer = layer;
+        rcu_exclusive_end(&table->dp->rcu);
+    }
+}
+
+void
+flow_table_del_layer(struct flow_table *table, uint8_t layer) {
+    table->layer_entries[layer]--;
+
+    /* parsing more than needed is harmless, so no need to wait here. */
+    while (table->layer > PACKET_LAYER_L2 && table->layer_entries[table->layer] == 0) {
+        table->layer--;
+    }
+}
+
+/* Returns the hash of the entry or flow mod in the strict index. Matches
+ * other than standard ones are only hashed on the priority. */
+static inline uint32_t
+strict_hash(uint16_t priority, struct ofl_match_header *match) {
+    if (match->type != OFPMT_STANDARD) {
+        return hash_bytes(&priority, sizeof(uint16_t), 0);
+    }
+    return match_std_hash_strict((struct ofl_match_standard *)match, priority);
+}
+
+/* Returns the hash of the entry or flow mod in the cookie index. */
+static inline uint32_t
+cookie_hash(uint64_t cookie) {
+    return hash_bytes(&cookie, sizeof(uint64_t), 0);
+}
+
+/* Returns true if only entries with the cookie of the flow mod can match it,
+ * so they can be found through the cookie index. */
+static inline bool
+cookie_exact(struct ofl_msg_flow_mod *mod) {
+    return mod->cookie_mask == 0xffffffffffffffffULL;
+}
+
+/* Adds the entry to the flow mod indexes of the table. */
+static void
+index_entry(struct flow_table *table, struct flow_entry *entry) {
+    hmap_insert(&table->strict_index, &entry->strict_node,
+                strict_hash(entry->stats->priority, entry->stats->match));
+    hmap_insert(&table->cookie_index, &entry->cookie_node,
+                cookie_hash(entry->stats->cookie));
+}
+
+/* Creates a rollup with no entries, referenced once for the table. */
+static struct flow_rollup *
+rollup_create(struct flow_table *table, uint64_t cookie) {
+    struct flow_rollup *rollup = xmalloc(sizeof(struct flow_rollup));
+
+    rollup->cookie          = cookie;
+    rollup->flow_count      = 0;
+    rollup->refs            = 1;
+    rollup->packets_removed = 0;
+    rollup->bytes_removed   = 0;
+    rollup->counters_num    = dp_workers_slots(table->dp);
+    if (posix_memalign((void **)&rollup->counters, FLOW_COUNTERS_ALIGN,
+                       sizeof(struct flow_counters) * rollup->counters_num) != 0) {
+        out_of_memory();
+    }
+    memset(rollup->counters, 0x00, sizeof(struct flow_counters) * rollup->counters_num);
+
+    return rollup;
+}
+
+static void
+rollup_unref(struct flow_rollup *rollup) {
+    rollup->refs--;
+    if (rollup->refs == 0) {
+        free(rollup->counters);
+        free(rollup);
+    }
+}
+
+/* Returns the rollup of the entries with the given cookie, or NULL if the
+ * table has no such entries. */
+static struct flow_rollup *
+find_cookie_rollup(struct flow_table *table, uint64_t cookie) {
+    struct flow_rollup *rollup;
+
+    HMAP_FOR_EACH_WITH_HASH (rollup, struct flow_rollup, node, cookie_hash(cookie),
+                             &table->cookie_rollups) {
+        if (rollup->cookie == cookie) {
+            return rollup;
+        }
+    }
+    return NULL;
+}
+
+/* Adds the statistics of the rollup to the given counts. */
+static void
+rollup_stats(struct flow_rollup *rollup,
+             uint64_t *packet_count, uint64_t *byte_count, uint32_t *flow_count) {
+    uint64_t packets = 0;
+    uint64_t bytes   = 0;
+    size_t i;
+
+    /* NOTE: as with the counters of entries, each value is read in a single
+     *       access while the threads may be updating them. */
+    for (i = 0; i < rollup->counters_num; i++) {
+        packets += rollup->counters[i].packet_count;
+        bytes   += rollup->counters[i].byte_count;
+    }
+    (*packet_count) += packets - rollup->packets_removed;
+    (*byte_count)   += bytes - rollup->bytes_removed;
+    (*flow_count)   += rollup->flow_count;
+}
+
+void
+flow_table_rollups_add(struct flow_table *table, struct flow_entry *entry) {
+    struct flow_rollup *rollup = find_cookie_rollup(table, entry->stats->cookie);
+
+    /* NOTE: created with the first entry, as the worker threads counting on it
+     *       are started after the tables are created. */
+    if (table->rollup == NULL) {
+        table->rollup = rollup_create(table, 0);
+    }
+    if (rollup == NULL) {
+        rollup = rollup_create(table, entry->stats->cookie);
+        hmap_insert(&table->cookie_rollups, &rollup->node, cookie_hash(rollup->cookie));
+    }
+    rollup->flow_count++;
+    rollup->refs++;
+    table->rollup->flow_count++;
+    table->rollup->refs++;
+
+    entry->table_rollup  = table->rollup;
+    entry->cookie_rollup = rollup;
+}
+
+void
+flow_table_rollups_remove(struct flow_table *table, struct flow_entry *entry) {
+    struct flow_rollup *rollup = entry->cookie_rollup;
+
+    flow_entry_update(entry);
+
+    entry->table_rollup->packets_removed += entry->stats->packet_count;
+    entry->table_rollup->bytes_removed   += entry->stats->byte_count;
+    entry->table_rollup->flow_count--;
 
-        /* hard timeout entries are ordered by the time they should be removed at. */
-        LIST_FOR_EACH (e, struct flow_entry, hard_node, &table->hard_entries) {
-            if (e->remove_at > entry->remove_at) {
-                list_insert(&e->hard_node, &entry->hard_node);
-                return;
+    rollup->packets_removed += entry->stats->packet_count;
+    rollup->bytes_removed   += entry->stats->byte_count;
+    rollup->flow_count--;
+
+    /* NOTE: the rollup is kept until the removed entries are freed. */
+    if (rollup->flow_count == 0) {
+        hmap_remove(&table->cookie_rollups, &rollup->node);
+        rollup_unref(rollup);
+    }
+}
+
+void
+flow_table_rollups_release(struct flow_entry *entry, uint64_t packet_count, uint64_t byte_count) {
+    entry->table_rollup->packets_removed += packet_count;
+    entry->table_rollup->bytes_removed   += byte_count;
+    rollup_unref(entry->table_rollup);
+
+    entry->cookie_rollup->packets_removed += packet_count;
+    entry->cookie_rollup->bytes_removed   += byte_count;
+    rollup_unref(entry->cookie_rollup);
+}
+
+void
+flow_table_rollup_stats(struct flow_table *table, uint64_t cookie, uint64_t cookie_mask,
+                        uint64_t *packet_count, uint64_t *byte_count, uint32_t *flow_count) {
+    struct flow_rollup *rollup;
+
+    if (cookie_mask == 0) {
+        if (table->rollup != NULL) {
+            rollup_stats(table->rollup, packet_count, byte_count, flow_count);
+        }
+
+    } else if (cookie_mask == 0xffffffffffffffffULL) {
+        rollup = find_cookie_rollup(table, cookie);
+        if (rollup != NULL) {
+            rollup_stats(rollup, packet_count, byte_count, flow_count);
+        }
+
+    } else {
+        HMAP_FOR_EACH (rollup, struct flow_rollup, node, &table->cookie_rollups) {
+            if (((rollup->cookie ^ cookie) & cookie_mask) == 0) {
+                rollup_stats(rollup, packet_count, byte_count, flow_count);
             }
         }
-        list_insert(&e->hard_node, &entry->hard_node);
     }
 }
 
-/* Handles flow mod messages with ADD command. */
-static ofl_err
-flow_table_add(struct flow_table *table, struct ofl_msg_flow_mod *mod, bool check_overlap, bool *match_kept, bool *insts_kept) {
-    // Note: new entries will be placed behind those with equal priority
-    struct flow_entry *entry, *new_entry;
+/* Moves the cursors of the table pointing at the old match node to the new
+ * one. */
+static void
+replace_cursors(struct flow_table *table, struct list *old, struct list *new) {
+    struct flow_table_cursor *cursor;
 
-    LIST_FOR_EACH (entry, struct flow_entry, match_node, &table->match_entries) {
-        if (check_overlap && flow_entry_overlaps(entry, mod)) {
-            return ofl_error(OFPET_FLOW_MOD_FAILED, OFPFMFC_OVERLAP);
+    LIST_FOR_EACH (cursor, struct flow_table_cursor, node, &table->cursors) {
+        if (cursor->pos == old) {
+            cursor->pos = new;
         }
+    }
+}
 
-        /* if the entry equals, replace the old one */
-        if (flow_entry_matches(entry, mod, true/*strict*/, false/*check_cookie*/)) {
-            new_entry = flow_entry_create(table->dp, table, mod);
-            *match_kept = true;
-            *insts_kept = true;
+/* Returns the entry which strictly matches the flow mod, ignoring cookies. As
+ * such entries are replaced on add, there can be at most one. */
+static struct flow_entry *
+find_strict(struct flow_table *table, struct ofl_msg_flow_mod *mod) {
+    struct hmap_node *node;
 
-            /* NOTE: no flow removed message should be generated according to spec. */
-            list_replace(&new_entry->match_node, &entry->match_node);
-            list_remove(&entry->hard_node);
-            list_remove(&entry->idle_node);
-            flow_entry_destroy(entry);
-            add_to_timeout_lists(table, new_entry);
-            return 0;
+    /* NOTE: HMAP_FOR_EACH_WITH_HASH cannot be used, as its end condition is
+     *       optimized away for nodes not at the start of the structure. */
+    for (node = hmap_first_with_hash(&table->strict_index, strict_hash(mod->priority, mod->match));
+         node != NULL; node = hmap_next_with_hash(node)) {
+        struct flow_entry *entry = CONTAINER_OF(node, struct flow_entry, strict_node);
+
+        if (flow_entry_matches(entry, mod, true/*strict*/, false/*check_cookie*/)) {
+            return entry;
         }
+    }
+    return NULL;
+}
 
-        if (mod->priority > entry->stats->priority) {
-            break;
+/* Handles flow mod messages with ADD command. */
+static ofl_err
+flow_table_add(struct flow_table *table, struct ofl_msg_flow_mod *mod, bool check_overlap, bool *match_kept, bool *insts_kept) {
+    struct flow_entry *entry, *new_entry;
+
+    if (check_overlap) {
+        LIST_FOR_EACH (entry, struct flow_entry, match_node, &table->match_entries) {
+            if (flow_entry_overlaps(entry, mod)) {
+                return ofl_error(OFPET_FLOW_MOD_FAILED, OFPFMFC_OVERLAP);
+            }
         }
     }
 
+    /* if the entry equals, replace the old one */
+    entry = find_strict(table, mod);
+    if (entry != NULL) {
+        new_entry = flow_entry_create(table->dp, table, mod);
+        *match_kept = true;
+        *insts_kept = true;
+
+        /* NOTE: no flow removed message should be generated according to spec. */
+        replace_cursors(table, &entry->match_node, &new_entry->match_node);
+        list_replace(&new_entry->match_node, &entry->match_node);
+        hmap_remove(&table->strict_index, &entry->strict_node);
+        hmap_remove(&table->cookie_index, &entry->cookie_node);
+        flow_table_rollups_remove(table, entry);
+        index_entry(table, new_entry);
+        flow_table_rollups_add(table, new_entry);
+        flow_table_add_layer(table, new_entry->layer);
+        classifier_replace(&table->classifier, &entry->cls_rule,
+                           &new_entry->cls_rule, lookup_match(new_entry));
+        flow_table_del_layer(table, entry->layer);
+        flow_entry_destroy(entry);
+        schedule_timeouts(table, new_entry);
+        return 0;
+    }
+
     if (table->stats->active_count == FLOW_TABLE_MAX_ENTRIES) {
         return ofl_error(OFPET_FLOW_MOD_FAILED, OFPFMFC_TABLE_FULL);
     }
@@ -108,8 +345,13 @@ flow_table_add(struct flow_table *table, struct ofl_msg_flow_mod *mod, bool chec
     *match_kept = true;
     *insts_kept = true;
 
-    list_insert(&entry->match_node, &new_entry->match_node);
-    add_to_timeout_lists(table, new_entry);
+    list_push_back(&table->match_entries, &new_entry->match_node);
+    index_entry(table, new_entry);
+    flow_table_rollups_add(table, new_entry);
+    flow_table_add_layer(table, new_entry->layer);
+    classifier_insert(&table->classifier, &new_entry->cls_rule,
+                      lookup_match(new_entry), new_entry->stats->priority);
+    schedule_timeouts(table, new_entry);
 
     return 0;
 }
@@ -122,12 +364,36 @@ flow_table_modify(struct flow_table *table, struct ofl_msg_flow_mod *mod, bool s
 
     match_found = false;
 
-    LIST_FOR_EACH (entry, struct flow_entry, match_node, &table->match_entries) {
-        if (flow_entry_matches(entry, mod, strict, true/*check_cookie*/)) {
+    if (strict) {
+        entry = find_strict(table, mod);
+        if (entry != NULL && flow_entry_matches(entry, mod, true/*strict*/, true/*check_cookie*/)) {
             flow_entry_replace_instructions(entry, mod->instructions_num, mod->instructions);
             *insts_kept = true;
             match_found = true;
         }
+
+    } else if (cookie_exact(mod)) {
+        struct hmap_node *node;
+
+        for (node = hmap_first_with_hash(&table->cookie_index, cookie_hash(mod->cookie));
+             node != NULL; node = hmap_next_with_hash(node)) {
+            entry = CONTAINER_OF(node, struct flow_entry, cookie_node);
+
+            if (flow_entry_matches(entry, mod, false/*strict*/, true/*check_cookie*/)) {
+                flow_entry_replace_instructions(entry, mod->instructions_num, mod->instructions);
+                *insts_kept = true;
+                match_found = true;
+            }
+        }
+
+    } else {
+        LIST_FOR_EACH (entry, struct flow_entry, match_node, &table->match_entries) {
+            if (flow_entry_matches(entry, mod, false/*strict*/, true/*check_cookie*/)) {
+                flow_entry_replace_instructions(entry, mod->instructions_num, mod->instructions);
+                *insts_kept = true;
+                match_found = true;
+            }
+        }
     }
 
     /* NOTE: if modify does not modify any entries, it acts like an add according to spec. */
@@ -143,10 +409,31 @@ static ofl_err
 flow_table_delete(struct flow_table *table, struct ofl_msg_flow_mod *mod, bool strict) {
     struct flow_entry *entry, *next;
 
-    LIST_FOR_EACH_SAFE (entry, next, struct flow_entry, match_node, &table->match_entries) {
-        if (flow_entry_matches(entry, mod, strict, true/*check_cookie*/)) {
+    if (strict) {
+        entry = find_strict(table, mod);
+        if (entry != NULL && flow_entry_matches(entry, mod, true/*strict*/, true/*check_cookie*/)) {
             flow_entry_remove(entry, OFPRR_DELETE);
         }
+
+    } else if (cookie_exact(mod)) {
+        struct hmap_node *node, *next_node;
+
+        for (node = hmap_first_with_hash(&table->cookie_index, cookie_hash(mod->cookie));
+             node != NULL; node = next_node) {
+            next_node = hmap_next_with_hash(node);
+            entry = CONTAINER_OF(node, struct flow_entry, cookie_node);
+
+            if (flow_entry_matches(entry, mod, false/*strict*/, true/*check_cookie*/)) {
+                flow_entry_remove(entry, OFPRR_DELETE);
+            }
+        }
+
+    } else {
+        LIST_FOR_EACH_SAFE (entry, next, struct flow_entry, match_node, &table->match_entries) {
+            if (flow_entry_matches(entry, mod, false/*strict*/, true/*check_cookie*/)) {
+                flow_entry_remove(entry, OFPRR_DELETE);
+            }
+        }
     }
 
     return 0;
@@ -180,35 +467,35 @@ flow_table_flow_mod(struct flow_table *table, struct ofl_msg_flow_mod *mod, bool
 
 
 struct flow_entry *
-flow_table_lookup(struct flow_table *table, struct packet *pkt) {
+flow_table_lookup(struct flow_table *table, struct packet *pkt, struct flow_cache *cache) {
     struct flow_entry *entry;
+    struct flow_key key;
+    uint64_t version;
 
-    table->stats->lookup_count++;
+    DP_COUNTER_ADD(table->stats->lookup_count, 1);
 
-    LIST_FOR_EACH(entry, struct flow_entry, match_node, &table->match_entries) {
-        struct ofl_match_header *m;
+    packet_handle_std_parse(pkt->handle_std, table->layer);
+    flow_key_from_pkt(&key, pkt->handle_std->match);
 
-        m = entry->match == NULL ? entry->stats->match : entry->match;
+    /* NOTE: the version is read before the lookup, so a result cached while
+     *       the table is being modified is never used after the change. */
+    version = table->classifier.version;
+    rcu_barrier();
 
-        /* select appropriate handler, based on match type of flow entry. */
-        switch (m->type) {
-            case (OFPMT_STANDARD): {
-                if (packet_handle_std_match(pkt->handle_std,
-                                            (struct ofl_match_standard *)m)) {
-                    entry->stats->byte_count += pkt->buffer->size;
-                    entry->stats->packet_count++;
-                    entry->last_used = time_msec();
+    if (!flow_cache_lookup(cache, table->stats->table_id, version, &key, &entry)) {
+        struct cls_rule *rule = classifier_lookup_key(&table->classifier, &key,
+                                                      pkt->handle_std->match);
 
-                    table->stats->matched_count++;
+        entry = (rule == NULL) ? NULL : CONTAINER_OF(rule, struct flow_entry, cls_rule);
+        flow_cache_insert(cache, table->stats->table_id, version, &key, entry);
+    }
 
-                    return entry;
-                }
-                break;
-            }
-            default: {
-                VLOG_WARN_RL(LOG_MODULE, &rl, "Trying to process flow entry with unknown match type (%u).", m->type);
-            }
-        }
+    if (entry != NULL) {
+        flow_entry_count(entry, dp_workers_slot(), pkt->buffer->size, dp_workers_clock());
+
+        DP_COUNTER_ADD(table->stats->matched_count, 1);
+
+        return entry;
     }
 
     return NULL;
@@ -218,19 +505,7 @@ flow_table_lookup(struct flow_table *table, struct packet *pkt) {
 
 void
 flow_table_timeout(struct flow_table *table) {
-    struct flow_entry *entry, *next;
-
-    /* NOTE: hard timeout entries are ordered by the time they should be removed at,
-     * so if one is not removed, the rest will not be either. */
-    LIST_FOR_EACH_SAFE (entry, next, struct flow_entry, hard_node, &table->hard_entries) {
-        if (!flow_entry_hard_timeout(entry)) {
-            break;
-        }
-    }
-
-    LIST_FOR_EACH_SAFE (entry, next, struct flow_entry, idle_node, &table->idle_entries) {
-        flow_entry_idle_timeout(entry);
-    }
+    timer_wheel_run(&table->timers, time_msec());
 }
 
 struct flow_table *
@@ -258,8 +533,16 @@ flow_table_create(struct datapath *dp, uint8_t table_id) {
     table->stats->matched_count = 0;
 
     list_init(&table->match_entries);
-    list_init(&table->hard_entries);
-    list_init(&table->idle_entries);
+    list_init(&table->cursors);
+    timer_wheel_init(&table->timers, time_msec());
+    classifier_init(&table->classifier, &dp->rcu);
+    hmap_init(&table->strict_index);
+    hmap_init(&table->cookie_index);
+    table->rollup = NULL;
+    hmap_init(&table->cookie_rollups);
+
+    memset(table->layer_entries, 0x00, sizeof(table->layer_entries));
+    table->layer = PACKET_LAYER_L2;
 
     return table;
 }
@@ -267,10 +550,24 @@ flow_table_create(struct datapath *dp, uint8_t table_id) {
 void
 flow_table_destroy(struct flow_table *table) {
     struct flow_entry *entry, *next;
+    struct flow_rollup *rollup, *rollup_next;
 
     LIST_FOR_EACH_SAFE (entry, next, struct flow_entry, match_node, &table->match_entries) {
         flow_entry_destroy(entry);
     }
+    classifier_destroy(&table->classifier);
+    hmap_destroy(&table->strict_index);
+    hmap_destroy(&table->cookie_index);
+
+    /* NOTE: rollups are freed once the destroyed entries are freed. */
+    HMAP_FOR_EACH_SAFE (rollup, rollup_next, struct flow_rollup, node, &table->cookie_rollups) {
+        hmap_remove(&table->cookie_rollups, &rollup->node);
+        rollup_unref(rollup);
+    }
+    hmap_destroy(&table->cookie_rollups);
+    if (table->rollup != NULL) {
+        rollup_unref(table->rollup);
+    }
 
     free(table->stats->name);
     free(table->stats);
@@ -278,15 +575,48 @@ flow_table_destroy(struct flow_table *table) {
 }
 
 void
+flow_table_cursor_init(struct flow_table *table, struct flow_table_cursor *cursor) {
+    cursor->pos = table->match_entries.next;
+    list_push_back(&table->cursors, &cursor->node);
+}
+
+void
+flow_table_cursor_destroy(struct flow_table_cursor *cursor) {
+    list_remove(&cursor->node);
+}
+
+void
+flow_table_cursors_skip(struct flow_table *table, struct flow_entry *entry) {
+    replace_cursors(table, &entry->match_node, entry->match_node.next);
+}
+
+/* Returns true if the entry is selected by the flow stats request. */
+static bool
+stats_request_matches(struct flow_entry *entry, struct ofl_msg_stats_request_flow *msg) {
+    return ((entry->stats->cookie ^ msg->cookie) & msg->cookie_mask) == 0 &&
+           (msg->out_port == OFPP_ANY || flow_entry_has_out_port(entry, msg->out_port)) &&
+           (msg->out_group == OFPG_ANY || flow_entry_has_out_group(entry, msg->out_group)) &&
+           match_std_nonstrict((struct ofl_match_standard *)msg->match,
+                               (struct ofl_match_standard *)entry->stats->match);
+}
+
+bool
 flow_table_stats(struct flow_table *table, struct ofl_msg_stats_request_flow *msg,
+                 struct flow_table_cursor *cursor, size_t max_visit, size_t *bytes,
                  struct ofl_flow_stats ***stats, size_t *stats_size, size_t *stats_num) {
-    struct flow_entry *entry;
+    size_t visited;
+
+    for (visited = 0; cursor->pos != &table->match_entries && visited < max_visit; visited++) {
+        struct flow_entry *entry = CONTAINER_OF(cursor->pos, struct flow_entry, match_node);
 
-    LIST_FOR_EACH(entry, struct flow_entry, match_node, &table->match_entries) {
-        if ((msg->out_port == OFPP_ANY || flow_entry_has_out_port(entry, msg->out_port)) &&
-            (msg->out_group == OFPG_ANY || flow_entry_has_out_group(entry, msg->out_group)) &&
-            match_std_nonstrict((struct ofl_match_standard *)msg->match,
-                                (struct ofl_match_standard *)entry->stats->match)) {
+        if (stats_request_matches(entry, msg)) {
+            size_t len = ofl_structs_flow_stats_ofp_len(entry->stats, table->dp->exp);
+
+            /* NOTE: an entry is always taken into an empty reply. */
+            if (len > *bytes && *stats_num > 0) {
+                return false;
+            }
+            *bytes = len > *bytes ? 0 : *bytes - len;
 
             flow_entry_update(entry);
             if ((*stats_size) == (*stats_num)) {
@@ -296,24 +626,29 @@ flow_table_stats(struct flow_table *table, struct ofl_msg_stats_request_flow *ms
             (*stats)[(*stats_num)] = entry->stats;
             (*stats_num)++;
         }
+        cursor->pos = cursor->pos->next;
     }
+
+    return cursor->pos == &table->match_entries;
 }
 
-void
+bool
 flow_table_aggregate_stats(struct flow_table *table, struct ofl_msg_stats_request_flow *msg,
+                           struct flow_table_cursor *cursor, size_t max_visit,
                            uint64_t *packet_count, uint64_t *byte_count, uint32_t *flow_count) {
-    struct flow_entry *entry;
+    size_t visited;
 
-    LIST_FOR_EACH(entry, struct flow_entry, match_node, &table->match_entries) {
-        if ((msg->out_port == OFPP_ANY || flow_entry_has_out_port(entry, msg->out_port)) &&
-            (msg->out_group == OFPG_ANY || flow_entry_has_out_group(entry, msg->out_group)) &&
-            match_std_nonstrict((struct ofl_match_standard *)msg->match,
-                                (struct ofl_match_standard *)entry->stats->match)) {
+    for (visited = 0; cursor->pos != &table->match_entries && visited < max_visit; visited++) {
+        struct flow_entry *entry = CONTAINER_OF(cursor->pos, struct flow_entry, match_node);
 
+        if (stats_request_matches(entry, msg)) {
+            flow_entry_update(entry);
             (*packet_count) += entry->stats->packet_count;
             (*byte_count)   += entry->stats->byte_count;
             (*flow_count)++;
         }
+        cursor->pos = cursor->pos->next;
     }
 
+    return cursor->pos == &table->match_entries;
 }
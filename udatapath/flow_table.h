@@ -31,41 +31,79 @@
 
 #ifndef FLOW_TABLE_H
 #define FLOW_TABLE_H 1
+#include "classifier.h"
+#include "flow_cache.h"
 #include "oflib/ofl.h"
 #include "oflib/ofl-messages.h"
 #include "oflib/ofl-structs.h"
+#include "packet_handle_std.h"
 #include "pipeline.h"
+#include "timer_wheel.h"
 #include "timeval.h"
 
 
-#define FLOW_TABLE_MAX_ENTRIES 1024
+#define FLOW_TABLE_MAX_ENTRIES (1 << 20)
 
 /****************************************************************************
  * Implementation of a flow table. The current implementation stores flow
- * entries in priority and then insertion order.
+ * entries in insertion order; packet lookups are done through a tuple space
+ * search classifier, which decides on precedence. Flow mods find the entries
+ * they strictly match through a (priority, match) index, and cookie filtered
+ * flow mods through a cookie index.
  ****************************************************************************/
 
 
+/* Position of a stats dump in the entries of a flow table, which can be
+ * resumed after the table changed. An entry being removed moves the cursors
+ * pointing at it to the next entry. */
+struct flow_table_cursor {
+    struct list              node;  /* in the cursors of the table. */
+    struct list             *pos;   /* match node of the next entry to visit;
+                                       the list head at the end. */
+};
+
 struct flow_table {
     struct datapath         *dp;
     struct ofl_table_stats  *stats;  /* structure storing table statistics. */
 
-    struct list              match_entries; /* list of entries in order. */
-    struct list              hard_entries;  /* list of entries with hard timeout;
-                                               ordered by their timeout times. */
-    struct list              idle_entries;  /* unordered list of entries with
-                                               idle timeout. */
+    struct list              match_entries; /* list of entries in insertion order. */
+    struct list              cursors;       /* cursors of dumps in progress. */
+    struct classifier        classifier;    /* classifier for packet lookups. */
+    struct hmap              strict_index;  /* entries by priority and match. */
+    struct hmap              cookie_index;  /* entries by cookie. */
+    struct flow_rollup      *rollup;        /* statistics of all entries; NULL
+                                               until the first one is added. */
+    struct hmap              cookie_rollups; /* statistics of entries by cookie. */
+    struct timer_wheel       timers;        /* idle and hard timeouts of the
+                                               entries. */
+
+    size_t                   layer_entries[PACKET_LAYERS]; /* number of entries
+                                               needing packets parsed up to each
+                                               layer. */
+    volatile uint8_t         layer;         /* layer packets are parsed up to
+                                               for lookups in the table. */
 };
 
 /* Handles a flow mod message. */
 ofl_err
 flow_table_flow_mod(struct flow_table *table, struct ofl_msg_flow_mod *mod, bool *match_kept, bool *insts_kept);
 
-/* Finds the flow entry with the highest priority, which matches the packet. */
+/* Finds the flow entry with the highest priority, which matches the packet.
+ * Results are remembered in the given cache. */
 struct flow_entry *
-flow_table_lookup(struct flow_table *table, struct packet *pkt);
+flow_table_lookup(struct flow_table *table, struct packet *pkt, struct flow_cache *cache);
+
+/* Accounts for an entry needing packets parsed up to the given layer being
+ * added to the table. Must be called before the entry is classified. */
+void
+flow_table_add_layer(struct flow_table *table, uint8_t layer);
 
-/* Orders the flow table to check the timeout its flows. */
+/* Accounts for an entry needing packets parsed up to the given layer being
+ * removed from the table. Must be called after the entry is unclassified. */
+void
+flow_table_del_layer(struct flow_table *table, uint8_t layer);
+
+/* Removes the entries of the table whose idle or hard timeout expired. */
 void
 flow_table_timeout(struct flow_table *table);
 
@@ -77,14 +115,54 @@ flow_table_create(struct datapath *dp, uint8_t table_id);
 void
 flow_table_destroy(struct flow_table *table);
 
-/* Collects statistics of the flow entries of the table. */
+/* Points the cursor at the first entry of the table. */
 void
+flow_table_cursor_init(struct flow_table *table, struct flow_table_cursor *cursor);
+
+void
+flow_table_cursor_destroy(struct flow_table_cursor *cursor);
+
+/* Moves the cursors pointing at the entry to the next one. Must be called
+ * before the entry is unlinked from the table. */
+void
+flow_table_cursors_skip(struct flow_table *table, struct flow_entry *entry);
+
+/* Collects statistics of the flow entries of the table matching the request,
+ * from the cursor on. At most max_visit entries are visited, and collection
+ * stops before the packed statistics would exceed *bytes, which is decreased
+ * by their length. Returns true if the end of the table was reached. */
+bool
 flow_table_stats(struct flow_table *table, struct ofl_msg_stats_request_flow *msg,
+                 struct flow_table_cursor *cursor, size_t max_visit, size_t *bytes,
                  struct ofl_flow_stats ***stats, size_t *stats_size, size_t *stats_num);
 
-/* Collects aggregate statistics of the flow entries of the table. */
+/* Adds the entry to the rollups of the table. Must be called before the entry
+ * can be counted. */
 void
+flow_table_rollups_add(struct flow_table *table, struct flow_entry *entry);
+
+/* Removes the entry from the rollups of the table, with the statistics it
+ * collected so far. */
+void
+flow_table_rollups_remove(struct flow_table *table, struct flow_entry *entry);
+
+/* Removes the given counts of the entry, collected after it was removed from
+ * the rollups, and releases the rollups. Called when the entry is freed. */
+void
+flow_table_rollups_release(struct flow_entry *entry, uint64_t packet_count, uint64_t byte_count);
+
+/* Collects aggregate statistics of all flow entries of the table with the
+ * given cookie under the cookie mask, from the rollups of the table. */
+void
+flow_table_rollup_stats(struct flow_table *table, uint64_t cookie, uint64_t cookie_mask,
+                        uint64_t *packet_count, uint64_t *byte_count, uint32_t *flow_count);
+
+/* Collects aggregate statistics of the flow entries of the table, visiting at
+ * most max_visit entries from the cursor on. Returns true if the end of the
+ * table was reached. */
+bool
 flow_table_aggregate_stats(struct flow_table *table, struct ofl_msg_stats_request_flow *msg,
+                           struct flow_table_cursor *cursor, size_t max_visit,
                            uint64_t *packet_count, uint64_t *byte_count, uint32_t *flow_count);
 
 #endif /* FLOW_TABLE_H */
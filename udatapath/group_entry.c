@@ -30,11 +30,16 @@
  */
 
 #include <stdbool.h>
+#include <stdint.h>
 #include "flow_entry.h"
 #include "group_entry.h"
 #include "group_table.h"
 #include "dp_actions.h"
+#include "dp_ports.h"
 #include "datapath.h"
+#include "hash.h"
+#include "packet_handle_std.h"
+#include "packets.h"
 #include "util.h"
 #include "oflib/ofl.h"
 #include "oflib/ofl-structs.h"
@@ -64,11 +69,26 @@ struct group_entry_wrr_data {
     size_t   curr_bucket; /* bucket executed last time. */
 };
 
+/* Number of slots of the lookup table of select groups choosing buckets by
+ * hash; a prime, so the probe sequence of each bucket visits every slot. */
+#define SELECT_HASH_SLOTS 1021
+
+#define SELECT_HASH_EMPTY UINT16_MAX
+
+/* Private data for select groups choosing buckets by the hash of the flow of
+ * packets. The slots are filled in proportion to the bucket weights, each
+ * bucket probing them in its own order (as in Maglev hashing), so changing
+ * the buckets of the group moves few flows. It is not modified once built,
+ * so worker threads can select buckets concurrently. */
+struct group_entry_hash_data {
+    uint16_t slots[SELECT_HASH_SLOTS]; /* index of the bucket of each slot. */
+};
+
 static uint16_t
 gcd(uint16_t a, uint16_t b);
 
 static bool
-bucket_is_alive(struct ofl_bucket *bucket);
+bucket_is_alive(struct group_entry *entry, struct ofl_bucket *bucket);
 
 static void
 init_select_group(struct group_entry *entry, struct ofl_msg_group_mod *mod);
@@ -76,6 +96,12 @@ init_select_group(struct group_entry *entry, struct ofl_msg_group_mod *mod);
 static size_t
 select_from_select_group(struct group_entry *entry);
 
+static void
+init_hash_group(struct group_entry *entry);
+
+static size_t
+select_from_hash_group(struct group_entry *entry, struct packet *pkt);
+
 static size_t
 select_from_ff_group(struct group_entry *entry);
 
@@ -112,7 +138,11 @@ group_entry_create(struct datapath *dp, struct group_table *table, struct ofl_ms
 
     switch (mod->type) {
         case (OFPGT_SELECT): {
-            init_select_group(entry, mod);
+            if (dp->select_hash) {
+                init_hash_group(entry);
+            } else {
+                init_select_group(entry, mod);
+            }
             break;
         }
         default: {
@@ -122,10 +152,23 @@ group_entry_create(struct datapath *dp, struct group_table *table, struct ofl_ms
 
     list_init(&entry->flow_refs);
 
+    entry->live_bucket = -1;
+    group_entry_update_live(entry);
+
     return entry;
 }
 
 
+static void
+free_entry(void *entry_) {
+    struct group_entry *entry = (struct group_entry *)entry_;
+
+    ofl_structs_free_group_desc_stats(entry->desc, entry->dp->exp);
+    ofl_structs_free_group_stats(entry->stats);
+    free(entry->data);
+    free(entry);
+}
+
 void
 group_entry_destroy(struct group_entry *entry) {
     struct flow_ref_entry *ref, *next;
@@ -138,10 +181,8 @@ group_entry_destroy(struct group_entry *entry) {
 
     }
 
-    ofl_structs_free_group_desc_stats(entry->desc, entry->dp->exp);
-    ofl_structs_free_group_stats(entry->stats);
-    free(entry->data);
-    free(entry);
+    /* packets on worker threads may still be executing the group. */
+    rcu_defer(&entry->dp->rcu, free_entry, entry);
 }
 
 /* Executes a group entry of type ALL. */
@@ -149,11 +190,11 @@ static void
 execute_all(struct group_entry *entry, struct packet *pkt) {
     size_t i;
 
-    /* TODO Zoltan: Currently packets are always cloned. However it should
-     * be possible to see if cloning is necessary, or not, based on bucket actions. */
+    /* NOTE: clones share the data of the packet; it is only copied for the
+     * buckets which modify it. */
     for (i=0; i<entry->desc->buckets_num; i++) {
         struct ofl_bucket *bucket = entry->desc->buckets[i];
-        struct packet *p = packet_clone(pkt);
+        struct packet *p = packet_share(pkt);
 
         if (VLOG_IS_DBG_ENABLED(LOG_MODULE)) {
             char *b = ofl_structs_bucket_to_string(bucket, entry->dp->exp);
@@ -163,10 +204,10 @@ execute_all(struct group_entry *entry, struct packet *pkt) {
 
         action_set_write_actions(p->action_set, bucket->actions_num, bucket->actions);
 
-        entry->stats->byte_count += p->buffer->size;
-        entry->stats->packet_count++;
-        entry->stats->counters[i]->byte_count += p->buffer->size;
-        entry->stats->counters[i]->packet_count++;
+        DP_COUNTER_ADD(entry->stats->byte_count, p->buffer->size);
+        DP_COUNTER_ADD(entry->stats->packet_count, 1);
+        DP_COUNTER_ADD(entry->stats->counters[i]->byte_count, p->buffer->size);
+        DP_COUNTER_ADD(entry->stats->counters[i]->packet_count, 1);
 
         action_set_execute(p->action_set, p);
 
@@ -177,11 +218,12 @@ execute_all(struct group_entry *entry, struct packet *pkt) {
 /* Executes a group entry of type SELECT. */
 static void
 execute_select(struct group_entry *entry, struct packet *pkt) {
-    size_t b  = select_from_select_group(entry);
+    size_t b  = entry->dp->select_hash ? select_from_hash_group(entry, pkt)
+                                       : select_from_select_group(entry);
 
     if (b != -1) {
         struct ofl_bucket *bucket = entry->desc->buckets[b];
-        struct packet *p = packet_clone(pkt);
+        struct packet *p = packet_share(pkt);
 
         if (VLOG_IS_DBG_ENABLED(LOG_MODULE)) {
             char *b = ofl_structs_bucket_to_string(bucket, entry->dp->exp);
@@ -191,10 +233,10 @@ execute_select(struct group_entry *entry, struct packet *pkt) {
 
         action_set_write_actions(p->action_set, bucket->actions_num, bucket->actions);
 
-        entry->stats->byte_count += p->buffer->size;
-        entry->stats->packet_count++;
-        entry->stats->counters[b]->byte_count += p->buffer->size;
-        entry->stats->counters[b]->packet_count++;
+        DP_COUNTER_ADD(entry->stats->byte_count, p->buffer->size);
+        DP_COUNTER_ADD(entry->stats->packet_count, 1);
+        DP_COUNTER_ADD(entry->stats->counters[b]->byte_count, p->buffer->size);
+        DP_COUNTER_ADD(entry->stats->counters[b]->packet_count, 1);
 
         action_set_execute(p->action_set, p);
         packet_destroy(p);
@@ -209,7 +251,7 @@ execute_indirect(struct group_entry *entry, struct packet *pkt) {
 
     if (entry->desc->buckets_num > 0) {
         struct ofl_bucket *bucket = entry->desc->buckets[0];
-        struct packet *p = packet_clone(pkt);
+        struct packet *p = packet_share(pkt);
 
         if (VLOG_IS_DBG_ENABLED(LOG_MODULE)) {
             char *b = ofl_structs_bucket_to_string(bucket, entry->dp->exp);
@@ -219,10 +261,10 @@ execute_indirect(struct group_entry *entry, struct packet *pkt) {
 
         action_set_write_actions(p->action_set, bucket->actions_num, bucket->actions);
 
-        entry->stats->byte_count += p->buffer->size;
-        entry->stats->packet_count++;
-        entry->stats->counters[0]->byte_count += p->buffer->size;
-        entry->stats->counters[0]->packet_count++;
+        DP_COUNTER_ADD(entry->stats->byte_count, p->buffer->size);
+        DP_COUNTER_ADD(entry->stats->packet_count, 1);
+        DP_COUNTER_ADD(entry->stats->counters[0]->byte_count, p->buffer->size);
+        DP_COUNTER_ADD(entry->stats->counters[0]->packet_count, 1);
 
         action_set_execute(p->action_set, p);
         packet_destroy(p);
@@ -238,7 +280,7 @@ execute_ff(struct group_entry *entry, struct packet *pkt) {
 
     if (b != -1) {
         struct ofl_bucket *bucket = entry->desc->buckets[b];
-        struct packet *p = packet_clone(pkt);
+        struct packet *p = packet_share(pkt);
 
         if (VLOG_IS_DBG_ENABLED(LOG_MODULE)) {
             char *b = ofl_structs_bucket_to_string(bucket, entry->dp->exp);
@@ -248,10 +290,10 @@ execute_ff(struct group_entry *entry, struct packet *pkt) {
 
         action_set_write_actions(p->action_set, bucket->actions_num, bucket->actions);
 
-        entry->stats->byte_count += p->buffer->size;
-        entry->stats->packet_count++;
-        entry->stats->counters[b]->byte_count += p->buffer->size;
-        entry->stats->counters[b]->packet_count++;
+        DP_COUNTER_ADD(entry->stats->byte_count, p->buffer->size);
+        DP_COUNTER_ADD(entry->stats->packet_count, 1);
+        DP_COUNTER_ADD(entry->stats->counters[b]->byte_count, p->buffer->size);
+        DP_COUNTER_ADD(entry->stats->counters[b]->packet_count, 1);
 
         action_set_execute(p->action_set, p);
         packet_destroy(p);
@@ -268,9 +310,10 @@ group_entry_execute(struct group_entry *entry,
 
     VLOG_DBG_RL(LOG_MODULE, &rl, "Executing group %u.", entry->stats->group_id);
 
-    /* NOTE: Packet is copied for all buckets now (even if there is only one).
+    /* NOTE: Packet is cloned for all buckets now (even if there is only one).
      * This allows execution of the original packet onward. It is not clear
-     * whether that is allowed or not according to the spec. though. */
+     * whether that is allowed or not according to the spec. though. Clones
+     * share the packet data, until a bucket action modifies it. */
 
     switch (entry->desc->type) {
         case (OFPGT_ALL): {
@@ -345,10 +388,43 @@ group_entry_del_flow_ref(struct group_entry *entry, struct flow_entry *fe) {
 }
 
 
-/* Returns true if the bucket is alive. */
+/* Returns true if the bucket is alive, i.e. its watched port is up, and its
+ * watched group has a live bucket. */
 static bool
-bucket_is_alive(struct ofl_bucket *bucket UNUSED) {
-    // TODO Zoltan: Implement port up/down detection
+bucket_is_alive(struct group_entry *entry, struct ofl_bucket *bucket) {
+    if (bucket->watch_port != OFPP_ANY) {
+        struct sw_port *p = dp_ports_lookup(entry->dp, bucket->watch_port);
+
+        if (p == NULL || p->conf == NULL || (p->conf->config & OFPPC_PORT_DOWN) ||
+                                         (p->conf->state & OFPPS_LINK_DOWN)) {
+            return false;
+        }
+    }
+    if (bucket->watch_group != OFPG_ANY) {
+        struct group_entry *g = group_table_find(entry->table, bucket->watch_group);
+
+        if (g == NULL || g->live_bucket == -1) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool
+group_entry_update_live(struct group_entry *entry) {
+    size_t live = -1;
+    size_t i;
+
+    for (i=0; i<entry->desc->buckets_num; i++) {
+        if (bucket_is_alive(entry, entry->desc->buckets[i])) {
+            live = i;
+            break;
+        }
+    }
+    if (live == entry->live_bucket) {
+        return false;
+    }
+    entry->live_bucket = live;
     return true;
 }
 
@@ -393,10 +469,13 @@ select_from_select_group(struct group_entry *entry) {
     data = (struct group_entry_wrr_data *)entry->data;
     guard = 0;
 
+    /* NOTE: the local copy keeps the result in range, even if workers
+     *       update the state concurrently. */
     while (guard < entry->desc->buckets_num) {
-        data->curr_bucket = (data->curr_bucket + 1) % entry->desc->buckets_num;
+        size_t b = (data->curr_bucket + 1) % entry->desc->buckets_num;
+        data->curr_bucket = b;
 
-        if (data->curr_bucket == 0) {
+        if (b == 0) {
             if (data->curr_weight <= data->gcd_weight) {
                 data->curr_weight = data->max_weight;
             } else {
@@ -404,8 +483,8 @@ select_from_select_group(struct group_entry *entry) {
             }
         }
 
-        if (entry->desc->buckets[data->curr_bucket]->weight >= data->curr_weight) {
-            return data->curr_bucket;
+        if (entry->desc->buckets[b]->weight >= data->curr_weight) {
+            return b;
         }
         guard++;
     }
@@ -413,17 +492,118 @@ select_from_select_group(struct group_entry *entry) {
     return -1;
 }
 
-/* Selects the first live bucket from the failfast group. */
-static size_t
-select_from_ff_group(struct group_entry *entry) {
-    size_t i;
+/* Per bucket state while filling the slots of a select group. */
+struct hash_bucket {
+    uint32_t offset;  /* first slot the bucket probes. */
+    uint32_t skip;    /* distance between the slots it probes. */
+    uint32_t next;    /* number of slots probed so far. */
+    uint32_t weight;
+    uint32_t credit;  /* weight accumulated towards the next slot. */
+};
 
-    for (i=0; i<entry->desc->buckets_num; i++) {
-        if (bucket_is_alive(entry->desc->buckets[i])) {
-            return i;
+/* Builds the lookup table of a select group choosing buckets by hash. */
+static void
+init_hash_group(struct group_entry *entry) {
+    struct group_entry_hash_data *data;
+    struct hash_bucket *buckets;
+    size_t buckets_num = entry->desc->buckets_num;
+    uint32_t max_weight = 0;
+    size_t filled, i;
+
+    if (buckets_num == 0) {
+        entry->data = NULL;
+        return;
+    }
+
+    buckets = xmalloc(sizeof(struct hash_bucket) * buckets_num);
+    for (i = 0; i < buckets_num; i++) {
+        uint32_t index = i;
+
+        buckets[i].offset = hash_words(&index, 1, 0) % SELECT_HASH_SLOTS;
+        buckets[i].skip   = hash_words(&index, 1, 1) % (SELECT_HASH_SLOTS - 1) + 1;
+        buckets[i].next   = 0;
+        buckets[i].weight = entry->desc->buckets[i]->weight;
+        buckets[i].credit = 0;
+        max_weight = MAX(max_weight, buckets[i].weight);
+    }
+    /* NOTE: buckets of a group with no weights set are selected equally. */
+    if (max_weight == 0) {
+        for (i = 0; i < buckets_num; i++) {
+            buckets[i].weight = 1;
         }
+        max_weight = 1;
     }
-    return -1;
+
+    data = xmalloc(sizeof(struct group_entry_hash_data));
+    for (i = 0; i < SELECT_HASH_SLOTS; i++) {
+        data->slots[i] = SELECT_HASH_EMPTY;
+    }
+
+    /* In each round every bucket accumulates its weight, and takes its next
+     * free slot for each maximum weight accumulated; so the buckets of the
+     * maximum weight take a slot in every round. */
+    filled = 0;
+    while (filled < SELECT_HASH_SLOTS) {
+        for (i = 0; i < buckets_num && filled < SELECT_HASH_SLOTS; i++) {
+            struct hash_bucket *b = &buckets[i];
+            uint32_t slot;
+
+            b->credit += b->weight;
+            if (b->credit < max_weight) {
+                continue;
+            }
+            b->credit -= max_weight;
+
+            do {
+                slot = (b->offset + b->next * b->skip) % SELECT_HASH_SLOTS;
+                b->next++;
+            } while (data->slots[slot] != SELECT_HASH_EMPTY);
+
+            data->slots[slot] = i;
+            filled++;
+        }
+    }
+
+    free(buckets);
+    entry->data = data;
+}
+
+/* Selects a bucket from a select group, based on the hash of the addresses,
+ * protocol and ports of the packet. */
+static size_t
+select_from_hash_group(struct group_entry *entry, struct packet *pkt) {
+    struct group_entry_hash_data *data = (struct group_entry_hash_data *)entry->data;
+    struct ofl_match_standard *m;
+    uint32_t key[4];
+    uint32_t hash;
+
+    if (data == NULL) {
+        return -1;
+    }
+
+    packet_handle_std_parse(pkt->handle_std, PACKET_LAYER_L4);
+    m = pkt->handle_std->match;
+
+    if (m->dl_type == ETH_TYPE_IP) {
+        key[0] = m->nw_src;
+        key[1] = m->nw_dst;
+        key[2] = ((uint32_t)m->tp_src << 16) | m->tp_dst;
+        key[3] = m->nw_proto;
+        hash = hash_words(key, 4, 0);
+    } else {
+        hash = hash_bytes(m->dl_src, ETH_ADDR_LEN,
+                          hash_bytes(m->dl_dst, ETH_ADDR_LEN, m->dl_type));
+    }
+
+    return data->slots[hash % SELECT_HASH_SLOTS];
+}
+
+/* Selects the first live bucket from the failfast group. */
+static size_t
+select_from_ff_group(struct group_entry *entry) {
+    /* NOTE: the live bucket is updated when ports or groups change, and not
+     *       looked up for each packet. */
+    return entry->live_bucket;
 }
 
 /* Returns the g.c.d. of the two numbers. */
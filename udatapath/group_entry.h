@@ -58,6 +58,8 @@ struct group_entry {
     struct ofl_group_stats      *stats;
 
     void                        *data;     /* private data for group implementation. */
+    size_t                       live_bucket; /* first live bucket; -1 if there is
+                                                 none. See group_entry_update_live. */
 
     struct list                  flow_refs; /* references to flows referencing the group. */
 };
@@ -82,6 +84,11 @@ group_entry_destroy(struct group_entry *entry);
 bool
 group_entry_has_out_group(struct group_entry *entry, uint32_t group_id);
 
+/* Recalculates the first live bucket of the group entry, from the state of
+ * the watched ports and groups. Returns true if it changed. */
+bool
+group_entry_update_live(struct group_entry *entry);
+
 /* Adds a flow reference to the group entry. */
 void
 group_entry_add_flow_ref(struct group_entry *entry, struct flow_entry *fe);
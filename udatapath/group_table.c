@@ -41,6 +41,7 @@
 #include "openflow/openflow.h"
 #include "oflib/ofl.h"
 #include "oflib/ofl-messages.h"
+#include "oflib/ofl-utils.h"
 
 #include "vlog.h"
 #define LOG_MODULE VLM_group_t
@@ -70,6 +71,26 @@ group_table_find(struct group_table *table, uint32_t group_id) {
     return CONTAINER_OF(hnode, struct group_entry, node);
 }
 
+/* Replaces the buckets of a group mod unpacked into the arena of the datapath
+ * by owned copies, as the group entry keeps them. */
+static void
+promote_group_mod(struct group_table *table, struct ofl_msg_group_mod *mod) {
+    struct ofl_bucket **buckets;
+    size_t i;
+
+    if (!ofl_arena_owns(&table->dp->arena, mod)) {
+        return;
+    }
+
+    buckets = xmalloc(sizeof(struct ofl_bucket *) * mod->buckets_num);
+    for (i=0; i < mod->buckets_num; i++) {
+        buckets[i] = ofl_structs_bucket_clone(mod->buckets[i], table->dp->exp);
+    }
+    OFL_UTILS_FREE_ARR_FUN2(mod->buckets, mod->buckets_num,
+                            ofl_structs_free_bucket, table->dp->exp);
+    mod->buckets = buckets;
+}
+
 /* Handles group mod messages with ADD command. */
 static ofl_err
 group_table_add(struct group_table *table, struct ofl_msg_group_mod *mod) {
@@ -88,13 +109,16 @@ group_table_add(struct group_table *table, struct ofl_msg_group_mod *mod) {
         return ofl_error(OFPET_GROUP_MOD_FAILED, OFPGMFC_OUT_OF_BUCKETS);
     }
 
+    promote_group_mod(table, mod);
     entry = group_entry_create(table->dp, table, mod);
 
-    hmap_insert(&table->entries, &entry->node, entry->stats->group_id);
+    rcu_hmap_insert(&table->dp->rcu, &table->entries, &entry->node, entry->stats->group_id);
 
     table->entries_num++;
     table->buckets_num += entry->desc->buckets_num;
 
+    group_table_update_live(table);
+
     ofl_msg_free_group_mod(mod, false, table->dp->exp);
     return 0;
 }
@@ -117,10 +141,13 @@ group_table_modify(struct group_table *table, struct ofl_msg_group_mod *mod) {
         return ofl_error(OFPET_GROUP_MOD_FAILED, OFPGMFC_LOOP);
     }
 
+    promote_group_mod(table, mod);
     new_entry = group_entry_create(table->dp, table, mod);
 
+    /* NOTE: the new entry is linked in front of the old one, so concurrent
+     *       lookups find either of them. */
+    rcu_hmap_insert(&table->dp->rcu, &table->entries, &new_entry->node, mod->group_id);
     hmap_remove(&table->entries, &entry->node);
-    hmap_insert_fast(&table->entries, &new_entry->node, mod->group_id);
 
     table->buckets_num = table->buckets_num - entry->desc->buckets_num + new_entry->desc->buckets_num;
 
@@ -130,6 +157,8 @@ group_table_modify(struct group_table *table, struct ofl_msg_group_mod *mod) {
 
     group_entry_destroy(entry);
 
+    group_table_update_live(table);
+
     ofl_msg_free_group_mod(mod, false, table->dp->exp);
     return 0;
 }
@@ -141,10 +170,9 @@ group_table_delete(struct group_table *table, struct ofl_msg_group_mod *mod) {
         struct group_entry *entry, *next;
 
         HMAP_FOR_EACH_SAFE(entry, next, struct group_entry, node, &table->entries) {
+            hmap_remove(&table->entries, &entry->node);
             group_entry_destroy(entry);
         }
-        hmap_destroy(&table->entries);
-        hmap_init(&table->entries);
 
         table->entries_num = 0;
         table->buckets_num = 0;
@@ -172,6 +200,8 @@ group_table_delete(struct group_table *table, struct ofl_msg_group_mod *mod) {
 
             hmap_remove(&table->entries, &entry->node);
             group_entry_destroy(entry);
+
+            group_table_update_live(table);
         }
 
         /* NOTE: In 1.1 no error should be sent, if delete is for a non-existing group. */
@@ -181,6 +211,23 @@ group_table_delete(struct group_table *table, struct ofl_msg_group_mod *mod) {
     }
 }
 
+void
+group_table_update_live(struct group_table *table) {
+    struct group_entry *entry;
+    bool changed = true;
+    size_t i;
+
+    /* NOTE: groups may watch groups, so changes are propagated until the
+     *       liveness settles; each round settles a further level of the
+     *       watch chains. */
+    for (i=0; changed && i <= table->entries_num; i++) {
+        changed = false;
+        HMAP_FOR_EACH(entry, struct group_entry, node, &table->entries) {
+            changed |= group_entry_update_live(entry);
+        }
+    }
+}
+
 ofl_err
 group_table_handle_group_mod(struct group_table *table, struct ofl_msg_group_mod *mod,
                                                           const struct sender *sender UNUSED) {
@@ -210,6 +257,66 @@ group_table_handle_group_mod(struct group_table *table, struct ofl_msg_group_mod
     }
 }
 
+/* A group stats request for all groups, answered in multiple replies. */
+struct group_stats_dump {
+    struct group_table  *table;
+    uint32_t            *groups;      /* ids of the groups at the time of the request. */
+    size_t               groups_num;
+    size_t               next;        /* index of the next group to reply for. */
+};
+
+static int
+group_stats_dump(struct datapath *dp, const struct sender *sender, void *dump_) {
+    struct group_stats_dump *dump = (struct group_stats_dump *)dump_;
+    size_t bytes = DP_STATS_REPLY_MAX - sizeof(struct ofp_stats_reply);
+    size_t stats_size = 1;
+
+    struct ofl_msg_stats_reply_group reply =
+            {{{.type = OFPT_STATS_REPLY},
+              .type = OFPST_GROUP, .flags = 0x0000},
+             .stats_num = 0,
+             .stats     = xmalloc(sizeof(struct ofl_group_stats *))
+            };
+
+    for (; dump->next < dump->groups_num; dump->next++) {
+        /* NOTE: groups deleted since the request are skipped. */
+        struct group_entry *entry = group_table_find(dump->table, dump->groups[dump->next]);
+        size_t len;
+
+        if (entry == NULL) {
+            continue;
+        }
+
+        len = ofl_structs_group_stats_ofp_len(entry->stats);
+        if (reply.stats_num > 0 && len > bytes) {
+            break;
+        }
+        bytes = len > bytes ? 0 : bytes - len;
+
+        if (reply.stats_num == stats_size) {
+            stats_size *= 2;
+            reply.stats = xrealloc(reply.stats, sizeof(struct ofl_group_stats *) * stats_size);
+        }
+        reply.stats[reply.stats_num++] = entry->stats;
+    }
+    if (dump->next < dump->groups_num) {
+        reply.header.flags = OFPSF_REPLY_MORE;
+    }
+
+    dp_send_message(dp, (struct ofl_msg_header *)&reply, sender);
+
+    free(reply.stats);
+    return dump->next < dump->groups_num ? 1 : 0;
+}
+
+static void
+group_stats_dump_done(void *dump_) {
+    struct group_stats_dump *dump = (struct group_stats_dump *)dump_;
+
+    free(dump->groups);
+    free(dump);
+}
+
 ofl_err
 group_table_handle_stats_request_group(struct group_table *table,
                                   struct ofl_msg_stats_request_group *msg,
@@ -217,39 +324,38 @@ group_table_handle_stats_request_group(struct group_table *table,
     struct group_entry *entry;
 
     if (msg->group_id == OFPG_ALL) {
-        entry = NULL;
-    } else {
-        entry = group_table_find(table, msg->group_id);
+        struct group_stats_dump *dump = xmalloc(sizeof(struct group_stats_dump));
 
-        if (entry == NULL) {
-            return ofl_error(OFPET_GROUP_MOD_FAILED, OFPGMFC_UNKNOWN_GROUP);
+        dump->table      = table;
+        dump->groups     = xmalloc(sizeof(uint32_t) * table->entries_num);
+        dump->groups_num = 0;
+        dump->next       = 0;
+
+        HMAP_FOR_EACH(entry, struct group_entry, node, &table->entries) {
+            dump->groups[dump->groups_num++] = entry->stats->group_id;
         }
+
+        ofl_msg_free((struct ofl_msg_header *)msg, table->dp->exp);
+        dp_start_dump(table->dp, sender, group_stats_dump, group_stats_dump_done, dump);
+        return 0;
+    }
+
+    entry = group_table_find(table, msg->group_id);
+
+    if (entry == NULL) {
+        return ofl_error(OFPET_GROUP_MOD_FAILED, OFPGMFC_UNKNOWN_GROUP);
     }
 
     {
         struct ofl_msg_stats_reply_group reply =
                 {{{.type = OFPT_STATS_REPLY},
                   .type = OFPST_GROUP, .flags = 0x0000},
-                 .stats_num = msg->group_id == OFPG_ALL ? table->entries_num : 1,
-                 .stats     = xmalloc(sizeof(struct ofl_group_stats *) * (msg->group_id == OFPG_ALL ? table->entries_num : 1))
+                 .stats_num = 1,
+                 .stats     = &entry->stats
                 };
 
-        if (msg->group_id == OFPG_ALL) {
-            struct group_entry *e;
-            size_t i = 0;
-
-            HMAP_FOR_EACH(e, struct group_entry, node, &table->entries) {
-                 reply.stats[i] = e->stats;
-                 i++;
-             }
-
-        } else {
-            reply.stats[0] = entry->stats;
-        }
-
         dp_send_message(table->dp, (struct ofl_msg_header *)&reply, sender);
 
-        free(reply.stats);
         ofl_msg_free((struct ofl_msg_header *)msg, table->dp->exp);
         return 0;
     }
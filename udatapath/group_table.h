@@ -79,6 +79,10 @@ group_table_handle_stats_request_group_desc(struct group_table *table,
 struct group_entry *
 group_table_find(struct group_table *table, uint32_t group_id);
 
+/* Updates the live buckets of the groups, after ports or groups changed. */
+void
+group_table_update_live(struct group_table *table);
+
 /* Executes the given group entry on the packet. */
 void
 group_table_execute(struct group_table *table, struct packet *packet, uint32_t group_id);
@@ -31,6 +31,7 @@
 
 #include <stdbool.h>
 #include <string.h>
+#include "hash.h"
 #include "match_std.h"
 #include "oflib/ofl-structs.h"
 
@@ -57,19 +58,19 @@ match_std_overlap(struct ofl_match_standard *a, struct ofl_match_standard *b) {
 static inline bool
 strict_wild8(uint8_t a, uint8_t b, uint32_t aw, uint32_t bw, uint32_t f) {
 	return (wc(aw, f) && wc(bw, f)) ||
-	      (~wc(aw, f) && ~wc(bw, f) && a == b);
+	      (!wc(aw, f) && !wc(bw, f) && a == b);
 }
 
 static inline bool
 strict_wild16(uint16_t a, uint16_t b, uint32_t aw, uint32_t bw, uint32_t f) {
 	return (wc(aw, f) && wc(bw, f)) ||
-	      (~wc(aw, f) && ~wc(bw, f) && a == b);
+	      (!wc(aw, f) && !wc(bw, f) && a == b);
 }
 
 static inline bool
 strict_wild32(uint32_t a, uint32_t b, uint32_t aw, uint32_t bw, uint32_t f) {
 	return (wc(aw, f) && wc(bw, f)) ||
-	      (~wc(aw, f) && ~wc(bw, f) && a == b);
+	      (!wc(aw, f) && !wc(bw, f) && a == b);
 }
 
 static inline bool
@@ -112,6 +113,50 @@ match_std_strict(struct ofl_match_standard *a, struct ofl_match_standard *b) {
 		   strict_mask64(a->metadata, b->metadata, a->metadata_mask, b->metadata_mask);
 }
 
+/* Wildcard bits of the fields compared by match_std_strict. */
+#define STRICT_WILDCARDS (OFPFW_IN_PORT | OFPFW_DL_VLAN | OFPFW_DL_VLAN_PCP |   \
+                          OFPFW_DL_TYPE | OFPFW_NW_TOS | OFPFW_NW_PROTO |       \
+                          OFPFW_TP_SRC | OFPFW_TP_DST | OFPFW_MPLS_LABEL |      \
+                          OFPFW_MPLS_TC)
+
+uint32_t
+match_std_hash_strict(struct ofl_match_standard *m, uint32_t basis) {
+    /* NOTE: the match is normalized so that wildcarded fields and masked bits,
+     *       which match_std_strict ignores, do not affect the hash. */
+    struct ofl_match_standard h;
+    uint32_t w = m->wildcards;
+    size_t i;
+
+    memset(&h, 0x00, sizeof(struct ofl_match_standard));
+    h.wildcards = w & STRICT_WILDCARDS;
+
+    if (!wc(w, OFPFW_IN_PORT))     { h.in_port     = m->in_port; }
+    if (!wc(w, OFPFW_DL_VLAN))     { h.dl_vlan     = m->dl_vlan; }
+    if (!wc(w, OFPFW_DL_VLAN_PCP)) { h.dl_vlan_pcp = m->dl_vlan_pcp; }
+    if (!wc(w, OFPFW_DL_TYPE))     { h.dl_type     = m->dl_type; }
+    if (!wc(w, OFPFW_NW_TOS))      { h.nw_tos      = m->nw_tos; }
+    if (!wc(w, OFPFW_NW_PROTO))    { h.nw_proto    = m->nw_proto; }
+    if (!wc(w, OFPFW_TP_SRC))      { h.tp_src      = m->tp_src; }
+    if (!wc(w, OFPFW_TP_DST))      { h.tp_dst      = m->tp_dst; }
+    if (!wc(w, OFPFW_MPLS_LABEL))  { h.mpls_label  = m->mpls_label; }
+    if (!wc(w, OFPFW_MPLS_TC))     { h.mpls_tc     = m->mpls_tc; }
+
+    for (i=0; i<OFP_ETH_ALEN; i++) {
+        h.dl_src_mask[i] = m->dl_src_mask[i];
+        h.dl_src[i]      = m->dl_src[i] & ~m->dl_src_mask[i];
+        h.dl_dst_mask[i] = m->dl_dst_mask[i];
+        h.dl_dst[i]      = m->dl_dst[i] & ~m->dl_dst_mask[i];
+    }
+    h.nw_src_mask   = m->nw_src_mask;
+    h.nw_src        = m->nw_src & ~m->nw_src_mask;
+    h.nw_dst_mask   = m->nw_dst_mask;
+    h.nw_dst        = m->nw_dst & ~m->nw_dst_mask;
+    h.metadata_mask = m->metadata_mask;
+    h.metadata      = m->metadata & ~m->metadata_mask;
+
+    return hash_bytes(&h, sizeof(struct ofl_match_standard), basis);
+}
+
 
 /* A match (a) non-strictly matches match (b), if for each field they are both
  * wildcarded, or (a) is wildcarded, and (b) isn't, or if neither is wildcarded
@@ -126,19 +171,19 @@ match_std_strict(struct ofl_match_standard *a, struct ofl_match_standard *b) {
 static inline bool
 nonstrict_wild8(uint8_t a, uint8_t b, uint32_t aw, uint32_t bw, uint32_t f) {
 	return (wc(bw, f) && wc(aw, f)) ||
-	      (~wc(bw, f) && (wc(aw, f) || a == b));
+	      (!wc(bw, f) && (wc(aw, f) || a == b));
 }
 
 static inline bool
 nonstrict_wild16(uint16_t a, uint16_t b, uint32_t aw, uint32_t bw, uint32_t f) {
 	return (wc(bw, f) && wc(aw, f)) ||
-	      (~wc(bw, f) && (wc(aw, f) || a == b));
+	      (!wc(bw, f) && (wc(aw, f) || a == b));
 }
 
 static inline bool
 nonstrict_wild32(uint32_t a, uint32_t b, uint32_t aw, uint32_t bw, uint32_t f) {
 	return (wc(bw, f) && wc(aw, f)) ||
-	      (~wc(bw, f) && (wc(aw, f) || a == b));
+	      (!wc(bw, f) && (wc(aw, f) || a == b));
 }
 
 static inline bool
@@ -166,14 +211,14 @@ static inline bool
 nonstrict_dlvlan(uint16_t a, uint16_t b, uint32_t aw, uint32_t bw) {
 	uint32_t f = OFPFW_DL_VLAN;
 	return (wc(bw, f) && wc(aw, f)) ||
-	      (~wc(bw, f) && (wc(aw, f) || (a == OFPVID_ANY && b != OFPVID_NONE) || a == b));
+	      (!wc(bw, f) && (wc(aw, f) || (a == OFPVID_ANY && b != OFPVID_NONE) || a == b));
 }
 
 static inline bool
 nonstrict_dlvpcp(uint16_t avlan, uint16_t apcp, uint16_t bvlan, uint16_t bpcp, uint32_t aw, uint32_t bw) {
 	uint32_t f = OFPFW_DL_VLAN_PCP;
 	return (wc(bw, f) && wc(aw, f)) ||
-	      (~wc(bw, f) && (wc(aw, f) || (avlan == OFPVID_NONE && bvlan == OFPVID_NONE) || apcp == bpcp));
+	      (!wc(bw, f) && (wc(aw, f) || (avlan == OFPVID_NONE && bvlan == OFPVID_NONE) || apcp == bpcp));
 }
 
 bool
@@ -196,6 +241,18 @@ match_std_nonstrict(struct ofl_match_standard *a, struct ofl_match_standard *b)
 }
 
 
+bool
+match_std_all(struct ofl_match_standard *m) {
+    static const uint8_t dl_all[OFP_ETH_ALEN] = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
+
+    return (m->wildcards & OFPFW_ALL) == OFPFW_ALL &&
+           memcmp(m->dl_src_mask, dl_all, OFP_ETH_ALEN) == 0 &&
+           memcmp(m->dl_dst_mask, dl_all, OFP_ETH_ALEN) == 0 &&
+           m->nw_src_mask == 0xffffffff &&
+           m->nw_dst_mask == 0xffffffff &&
+           m->metadata_mask == 0xffffffffffffffffULL;
+}
+
 
 /* A special match, where it is assumed that the wildcards and masks of (b) are
  * not used. Specifically used for matching on packets. */
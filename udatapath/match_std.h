@@ -48,10 +48,20 @@ match_std_overlap(struct ofl_match_standard *a, struct ofl_match_standard *b);
 bool
 match_std_strict(struct ofl_match_standard *a, struct ofl_match_standard *b);
 
+/* Returns a hash of the match, which is the same for any two matches which
+ * match each other in a strict manner. */
+uint32_t
+match_std_hash_strict(struct ofl_match_standard *m, uint32_t basis);
+
 /* Returns true if match a matches match b, in a non-strict manner. */
 bool
 match_std_nonstrict(struct ofl_match_standard *a, struct ofl_match_standard *b);
 
+/* Returns true if the match wildcards or masks all fields, so it matches any
+ * other match. */
+bool
+match_std_all(struct ofl_match_standard *m);
+
 /* Returns true if match a matches match b, where b's wildcards and masks are ignored. */
 bool
 match_std_pkt(struct ofl_match_standard *a, struct ofl_match_standard *b);
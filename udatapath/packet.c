@@ -44,17 +44,32 @@
 #include "util.h"
 
 
-struct packet *
-packet_create(struct datapath *dp, uint32_t in_port,
-    struct ofpbuf *buf, bool packet_out) {
+/* Free packets of the thread. */
+struct packet_pool {
+    struct list   packets;
+    size_t        packets_num;
+};
+
+static __thread struct packet_pool pool = {{NULL, NULL}, 0};
+
+/* Returns a packet from the pool, or a new one, with default packet state. */
+static struct packet *
+pool_get(struct datapath *dp, uint32_t in_port, bool packet_out) {
     struct packet *pkt;
 
-    pkt = xmalloc(sizeof(struct packet));
+    if (pool.packets_num > 0) {
+        pkt = CONTAINER_OF(list_pop_front(&pool.packets), struct packet, pool_node);
+        pool.packets_num--;
+    } else {
+        pkt = xmalloc(sizeof(struct packet));
+        ofpbuf_init(&pkt->pool_buffer, 0);
+    }
 
     pkt->dp         = dp;
-    pkt->buffer     = buf;
+    pkt->buffer     = &pkt->pool_buffer;
     pkt->in_port    = in_port;
-    pkt->action_set = action_set_create(dp->exp);
+    pkt->action_set = &pkt->pool_action_set;
+    action_set_init(pkt->action_set, dp->exp);
 
     pkt->packet_out       = packet_out;
     pkt->out_group        = OFPG_ANY;
@@ -62,9 +77,62 @@ packet_create(struct datapath *dp, uint32_t in_port,
     pkt->out_port_max_len = 0;
     pkt->out_queue        = 0;
     pkt->buffer_id        = NO_BUFFER;
+    pkt->buffer_shared    = false;
     pkt->table_id         = 0;
 
-    pkt->handle_std = packet_handle_std_create(pkt);
+    pkt->handle_std = &pkt->pool_handle_std;
+    packet_handle_std_init(pkt->handle_std, pkt);
+
+    return pkt;
+}
+
+static void
+pool_put(struct packet *pkt) {
+    if (pool.packets_num == PACKET_POOL_MAX) {
+        ofpbuf_uninit(&pkt->pool_buffer);
+        free(pkt);
+        return;
+    }
+    if (pool.packets.next == NULL) {
+        list_init(&pool.packets);
+    }
+    list_push_front(&pool.packets, &pkt->pool_node);
+    pool.packets_num++;
+}
+
+/* Empties the pool buffer of the packet, making room for size bytes after
+ * headroom. */
+static void
+reset_buffer(struct packet *pkt, size_t size, size_t headroom) {
+    struct ofpbuf *b = &pkt->pool_buffer;
+
+    if (b->allocated < size + headroom) {
+        ofpbuf_uninit(b);
+        ofpbuf_init(b, size + headroom);
+    }
+    ofpbuf_clear(b);
+    ofpbuf_reserve(b, headroom);
+    b->l2 = b->l3 = b->l4 = b->l7 = NULL;
+}
+
+struct packet *
+packet_create(struct datapath *dp, uint32_t in_port,
+    struct ofpbuf *buf, bool packet_out) {
+    struct packet *pkt;
+
+    pkt = pool_get(dp, in_port, packet_out);
+    pkt->buffer = buf;
+
+    return pkt;
+}
+
+struct packet *
+packet_alloc(struct datapath *dp, size_t size, size_t headroom) {
+    struct packet *pkt;
+
+    pkt = pool_get(dp, 0, false);
+    reset_buffer(pkt, size, headroom);
+
     return pkt;
 }
 
@@ -72,27 +140,53 @@ struct packet *
 packet_clone(struct packet *pkt) {
     struct packet *clone;
 
-    clone = xmalloc(sizeof(struct packet));
-    clone->dp         = pkt->dp;
-    clone->buffer     = ofpbuf_clone(pkt->buffer);
-    clone->in_port    = pkt->in_port;
-    clone->action_set = action_set_clone(pkt->action_set);
+    clone = pool_get(pkt->dp, pkt->in_port, pkt->packet_out);
+    /* NOTE: headroom is kept, as actions on the clone may push headers. */
+    reset_buffer(clone, pkt->buffer->size, ofpbuf_headroom(pkt->buffer));
+    ofpbuf_put(clone->buffer, pkt->buffer->data, pkt->buffer->size);
+
+    action_set_copy(clone->action_set, pkt->action_set);
+
+    // the original is saved in buffer, but this buffer is a copy of that,
+    // and might be altered later
+    clone->buffer_id = NO_BUFFER;
+    clone->table_id  = pkt->table_id;
+
+    packet_handle_std_copy(clone->handle_std, pkt->handle_std);
+
+    return clone;
+}
+
+struct packet *
+packet_share(struct packet *pkt) {
+    struct packet *clone;
+
+    clone = pool_get(pkt->dp, pkt->in_port, pkt->packet_out);
+    clone->buffer        = pkt->buffer;
+    clone->buffer_shared = true;
+
+    action_set_copy(clone->action_set, pkt->action_set);
 
-    clone->packet_out       = pkt->packet_out;
-    clone->out_group        = OFPG_ANY;
-    clone->out_port         = OFPP_ANY;
-    clone->out_port_max_len = 0;
-    clone->out_queue        = 0;
-    clone->buffer_id        = NO_BUFFER; // the original is saved in buffer,
-                                         // but this buffer is a copy of that,
-                                         // and might be altered later
-    clone->table_id         = pkt->table_id;
+    clone->table_id = pkt->table_id;
 
-    clone->handle_std = packet_handle_std_clone(clone, pkt->handle_std);
+    packet_handle_std_copy(clone->handle_std, pkt->handle_std);
 
     return clone;
 }
 
+void
+packet_unshare_buffer(struct packet *pkt) {
+    struct ofpbuf *shared = pkt->buffer;
+
+    reset_buffer(pkt, shared->size, ofpbuf_headroom(shared));
+    pkt->buffer = &pkt->pool_buffer;
+    pkt->buffer_shared = false;
+    ofpbuf_put(pkt->buffer, shared->data, shared->size);
+
+    packet_handle_std_move(pkt->handle_std,
+            (uint8_t *)pkt->buffer->data - (uint8_t *)shared->data);
+}
+
 void
 packet_destroy(struct packet *pkt) {
     /* If packet is saved in a buffer, do not destroy it,
@@ -105,10 +199,11 @@ packet_destroy(struct packet *pkt) {
         }
     }
 
-    action_set_destroy(pkt->action_set);
-    ofpbuf_delete(pkt->buffer);
-    packet_handle_std_destroy(pkt->handle_std);
-    free(pkt);
+    action_set_clear_actions(pkt->action_set);
+    if (pkt->buffer != &pkt->pool_buffer && !pkt->buffer_shared) {
+        ofpbuf_delete(pkt->buffer);
+    }
+    pool_put(pkt);
 }
 
 char *
@@ -35,6 +35,7 @@
 #include <stdbool.h>
 #include "action_set.h"
 #include "datapath.h"
+#include "list.h"
 #include "ofpbuf.h"
 #include "oflib/ofl-structs.h"
 #include "packets.h"
@@ -43,12 +44,26 @@
 /****************************************************************************
  * Represents a packet received on the datapath, and its associated processing
  * state.
+ *
+ * Packets are recycled through a pool kept by each thread, so in the steady
+ * state receiving and forwarding a packet does not call the allocator. The
+ * action set, the handler and (usually) the buffer are embedded in the packet
+ * object, and are reused along with it.
+ *
+ * Packets cloned for the buckets of a group share the data of the packet
+ * they were cloned from, until an action is about to modify it (see
+ * packet_share); output-only buckets therefore never copy the frame.
  ****************************************************************************/
 
+/* Maximum number of free packets a thread keeps for reuse. */
+#define PACKET_POOL_MAX 1024
+
 
 struct packet {
     struct datapath    *dp;
     struct ofpbuf      *buffer;    /* buffer containing the packet */
+    bool                buffer_shared; /* buffer belongs to the packet this
+                                          one was shared from. */
     uint32_t            in_port;
     struct action_set  *action_set; /* action set associated with the packet */
     bool                packet_out; /* true if the packet arrived in a packet out msg */
@@ -62,17 +77,30 @@ struct packet {
                                       otherwise 0xffffffff */
 
     struct packet_handle_std  *handle_std; /* handler for standard match structure */
+
+    /* storage behind the pointers above; buffer points elsewhere if the
+     * packet was created with a buffer of the caller. */
+    struct ofpbuf              pool_buffer;
+    struct action_set          pool_action_set;
+    struct packet_handle_std   pool_handle_std;
+    struct list                pool_node;  /* node in the pool, if free. */
 };
 
-/* Creates a packet. */
+/* Creates a packet, which takes ownership of the given buffer. */
 struct packet *
 packet_create(struct datapath *dp, uint32_t in_port, struct ofpbuf *buf, bool packet_out);
 
+/* Returns a packet with an empty buffer, which can hold size bytes after the
+ * given headroom. The caller fills in the buffer and the in port. */
+struct packet *
+packet_alloc(struct datapath *dp, size_t size, size_t headroom);
+
 /* Converts the packet to a string representation. */
 char *
 packet_to_string(struct packet *pkt);
 
-/* Destroys a packet along with all its associated structures */
+/* Destroys a packet along with all its associated structures, and returns
+ * it to the pool of the calling thread. */
 void
 packet_destroy(struct packet *pkt);
 
@@ -80,4 +108,25 @@ packet_destroy(struct packet *pkt);
 struct packet *
 packet_clone(struct packet *pkt);
 
+/* Clones a packet, sharing the data of the original. The clone must be
+ * destroyed before the original is modified or destroyed; the data is only
+ * copied once the clone itself is about to be modified or kept, by calling
+ * packet_unshare. */
+struct packet *
+packet_share(struct packet *pkt);
+
+/* Gives the packet a copy of the shared data. Use packet_unshare instead. */
+void
+packet_unshare_buffer(struct packet *pkt);
+
+/* Makes sure the packet owns its data; must be called before the data is
+ * modified, or before the packet is kept beyond the processing of the packet
+ * it was shared from. */
+static inline void
+packet_unshare(struct packet *pkt) {
+    if (pkt->buffer_shared) {
+        packet_unshare_buffer(pkt);
+    }
+}
+
 #endif /* PACKET_H */
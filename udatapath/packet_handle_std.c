@@ -58,282 +58,376 @@ protocol_reset(struct protocols_std *proto) {
     proto->icmp      = NULL;
 }
 
-void
-packet_handle_std_validate(struct packet_handle_std *handle) {
-    if (handle->valid) {
-        return;
+/* Parses the ethernet and VLAN headers; fields of the other layers are
+ * reset. */
+static void
+parse_l2(struct packet_handle_std *handle) {
+    struct packet *pkt = handle->pkt;
+    struct ofl_match_standard *m = handle->match;
+    struct protocols_std *proto = handle->proto;
+    uint64_t current_metadata;
+    size_t offset = 0;
 
-    } else {
-        struct packet *pkt = handle->pkt;
-        struct ofl_match_standard *m = handle->match;
-        struct protocols_std *proto = handle->proto;
-        uint64_t current_metadata;
-        size_t offset = 0;
+    /* NOTE: fields of layers which are not parsed are left zero, so they
+     *       are consistent for matching and flow cache keys. */
+    protocol_reset(proto);
 
-        handle->valid = true;
+    current_metadata = m->metadata;
+    memset(m, 0x00, sizeof(struct ofl_match_standard));
+    m->header.type = OFPMT_STANDARD;
+    m->in_port     = pkt->in_port;
+    m->metadata    = current_metadata;
 
-        protocol_reset(handle->proto);
+    handle->more = false;
 
-        current_metadata = m->metadata;
-        memset(m, 0x00, sizeof(struct ofl_match_standard));
-        m->header.type = OFPMT_STANDARD;
-        m->in_port     = pkt->in_port;
-        m->metadata    = current_metadata;
+    /* Ethernet */
 
-        /* Ethernet */
+    if (pkt->buffer->size < offset + sizeof(struct eth_header)) {
+        return;
+    }
 
-        if (pkt->buffer->size < offset + sizeof(struct eth_header)) {
-            return;
-        }
+    proto->eth = (struct eth_header *)((uint8_t *)pkt->buffer->data + offset);
+    offset += sizeof(struct eth_header);
 
-        proto->eth = (struct eth_header *)((uint8_t *)pkt->buffer->data + offset);
-        offset += sizeof(struct eth_header);
+    if (ntohs(proto->eth->eth_type) >= ETH_TYPE_II_START) {
+        /* Ethernet II */
+        memcpy(m->dl_src, proto->eth->eth_src, ETH_ADDR_LEN);
+        memcpy(m->dl_dst, proto->eth->eth_dst, ETH_ADDR_LEN);
+        m->dl_type = ntohs(proto->eth->eth_type);
 
-        if (ntohs(proto->eth->eth_type) >= ETH_TYPE_II_START) {
-            /* Ethernet II */
-            memcpy(m->dl_src, proto->eth->eth_src, ETH_ADDR_LEN);
-            memcpy(m->dl_dst, proto->eth->eth_dst, ETH_ADDR_LEN);
-            m->dl_type = ntohs(proto->eth->eth_type);
+    } else {
+        /* Ethernet 802.3 */
+        struct llc_header *llc;
 
-        } else {
-            /* Ethernet 802.3 */
-            struct llc_header *llc;
+        // TODO Zoltan: compare packet length with ofpbuf length for validity
 
-            // TODO Zoltan: compare packet length with ofpbuf length for validity
+        if (pkt->buffer->size < offset + sizeof(struct llc_header)) {
+            return;
+        }
 
-            if (pkt->buffer->size < offset + sizeof(struct llc_header)) {
-                return;
-            }
+        llc = (struct llc_header *)((uint8_t *)pkt->buffer->data + offset);
+        offset += sizeof(struct llc_header);
 
-            llc = (struct llc_header *)((uint8_t *)pkt->buffer->data + offset);
-            offset += sizeof(struct llc_header);
+        if (!(llc->llc_dsap == LLC_DSAP_SNAP &&
+              llc->llc_ssap == LLC_SSAP_SNAP &&
+              llc->llc_cntl == LLC_CNTL_SNAP)) {
+            return;
+        }
 
-            if (!(llc->llc_dsap == LLC_DSAP_SNAP &&
-                  llc->llc_ssap == LLC_SSAP_SNAP &&
-                  llc->llc_cntl == LLC_CNTL_SNAP)) {
-                return;
-            }
+        if (pkt->buffer->size < offset + sizeof(struct snap_header)) {
+            return;
+        }
 
-            if (pkt->buffer->size < offset + sizeof(struct snap_header)) {
-                return;
-            }
+        proto->eth_snap = (struct snap_header *)((uint8_t *)pkt->buffer->data + offset);
+        offset += sizeof(struct snap_header);
+
+        if (memcmp(proto->eth_snap->snap_org, SNAP_ORG_ETHERNET, sizeof(SNAP_ORG_ETHERNET)) != 0) {
+            return;
+        }
 
-            proto->eth_snap = (struct snap_header *)((uint8_t *)pkt->buffer->data + offset);
-            offset += sizeof(struct snap_header);
+        memcpy(m->dl_src, proto->eth->eth_src, ETH_ADDR_LEN);
+        memcpy(m->dl_dst, proto->eth->eth_dst, ETH_ADDR_LEN);
+        m->dl_type = ntohs(proto->eth_snap->snap_type);
+    }
 
-            if (memcmp(proto->eth_snap->snap_org, SNAP_ORG_ETHERNET, sizeof(SNAP_ORG_ETHERNET)) != 0) {
-                return;
-            }
+    /* VLAN */
 
-            memcpy(m->dl_src, proto->eth->eth_src, ETH_ADDR_LEN);
-            memcpy(m->dl_dst, proto->eth->eth_dst, ETH_ADDR_LEN);
-            m->dl_type = ntohs(proto->eth_snap->snap_type);
+    if (m->dl_type == ETH_TYPE_VLAN ||
+        m->dl_type == ETH_TYPE_VLAN_PBB) {
+        if (pkt->buffer->size < offset + sizeof(struct vlan_header)) {
+            return;
         }
+        proto->vlan = (struct vlan_header *)((uint8_t *)pkt->buffer->data + offset);
+        proto->vlan_last = proto->vlan;
+        offset += sizeof(struct vlan_header);
+
+        m->dl_vlan = (ntohs(proto->vlan->vlan_tci) & VLAN_VID_MASK) >> VLAN_VID_SHIFT;
+        m->dl_vlan_pcp = (ntohs(proto->vlan->vlan_tci) & VLAN_PCP_MASK) >> VLAN_PCP_SHIFT;
+        // Note: DL type is updated
+        m->dl_type = ntohs(proto->vlan->vlan_next_type);
+    } else {
+        m->dl_vlan = OFPVID_NONE;
+    }
 
-        /* VLAN */
+    /* skip through rest of VLAN tags */
+    while (m->dl_type == ETH_TYPE_VLAN ||
+           m->dl_type == ETH_TYPE_VLAN_PBB) {
 
-        if (m->dl_type == ETH_TYPE_VLAN ||
-            m->dl_type == ETH_TYPE_VLAN_PBB) {
-            if (pkt->buffer->size < offset + sizeof(struct vlan_header)) {
-                return;
-            }
-            proto->vlan = (struct vlan_header *)((uint8_t *)pkt->buffer->data + offset);
-            proto->vlan_last = proto->vlan;
-            offset += sizeof(struct vlan_header);
-
-            m->dl_vlan = (ntohs(proto->vlan->vlan_tci) & VLAN_VID_MASK) >> VLAN_VID_SHIFT;
-            m->dl_vlan_pcp = (ntohs(proto->vlan->vlan_tci) & VLAN_PCP_MASK) >> VLAN_PCP_SHIFT;
-            // Note: DL type is updated
-            m->dl_type = ntohs(proto->vlan->vlan_next_type);
-        } else {
-            m->dl_vlan = OFPVID_NONE;
+        if (pkt->buffer->size < offset + sizeof(struct vlan_header)) {
+            return;
         }
+        proto->vlan_last = (struct vlan_header *)((uint8_t *)pkt->buffer->data + offset);
+        offset += sizeof(struct vlan_header);
 
-        /* skip through rest of VLAN tags */
-        while (m->dl_type == ETH_TYPE_VLAN ||
-               m->dl_type == ETH_TYPE_VLAN_PBB) {
-
-            if (pkt->buffer->size < offset + sizeof(struct vlan_header)) {
-                return;
-            }
-            proto->vlan_last = (struct vlan_header *)((uint8_t *)pkt->buffer->data + offset);
-            offset += sizeof(struct vlan_header);
+        m->dl_type = ntohs(proto->vlan_last->vlan_next_type);
+    }
 
-            m->dl_type = ntohs(proto->vlan_last->vlan_next_type);
-        }
+    handle->offset = offset;
+    handle->more   = true;
+}
 
-        /* MPLS */
+/* Parses the MPLS, ARP and IPv4 headers. */
+static void
+parse_l3(struct packet_handle_std *handle) {
+    struct packet *pkt = handle->pkt;
+    struct ofl_match_standard *m = handle->match;
+    struct protocols_std *proto = handle->proto;
+    size_t offset = handle->offset;
 
-        if (m->dl_type == ETH_TYPE_MPLS ||
-            m->dl_type == ETH_TYPE_MPLS_MCAST) {
+    if (!handle->more) {
+        return;
+    }
+    handle->more = false;
 
-            if (pkt->buffer->size < offset + sizeof(struct mpls_header)) {
-                return;
-            }
-            proto->mpls = (struct mpls_header *)((uint8_t *)pkt->buffer->data + offset);
-            offset += sizeof(struct mpls_header);
+    /* MPLS */
 
-            m->mpls_label = (ntohl(proto->mpls->fields) & MPLS_LABEL_MASK) >> MPLS_LABEL_SHIFT;
-            m->mpls_tc =    (ntohl(proto->mpls->fields) & MPLS_TC_MASK) >> MPLS_TC_SHIFT;
+    if (m->dl_type == ETH_TYPE_MPLS ||
+        m->dl_type == ETH_TYPE_MPLS_MCAST) {
 
-            /* no processing past MPLS */
+        if (pkt->buffer->size < offset + sizeof(struct mpls_header)) {
             return;
         }
+        proto->mpls = (struct mpls_header *)((uint8_t *)pkt->buffer->data + offset);
+        offset += sizeof(struct mpls_header);
 
-        /* ARP */
+        m->mpls_label = (ntohl(proto->mpls->fields) & MPLS_LABEL_MASK) >> MPLS_LABEL_SHIFT;
+        m->mpls_tc =    (ntohl(proto->mpls->fields) & MPLS_TC_MASK) >> MPLS_TC_SHIFT;
 
-        if (m->dl_type == ETH_TYPE_ARP) {
-            if (pkt->buffer->size < offset + sizeof(struct arp_eth_header)) {
-                return;
-            }
-            proto->arp = (struct arp_eth_header *)((uint8_t *)pkt->buffer->data + offset);
-            offset += sizeof(struct arp_eth_header);
-
-            if (ntohs(proto->arp->ar_hrd) == 1 &&
-                ntohs(proto->arp->ar_pro) == ETH_TYPE_IP &&
-                proto->arp->ar_hln == ETH_ADDR_LEN &&
-                proto->arp->ar_pln == 4) {
-
-                if (ntohs(proto->arp->ar_op) <= 0xff) {
-                    m->nw_proto = ntohs(proto->arp->ar_op);
-                }
-                if (m->nw_proto == ARP_OP_REQUEST ||
-                    m->nw_proto == ARP_OP_REPLY) {
-
-                    m->nw_src = proto->arp->ar_spa;
-                    m->nw_dst = proto->arp->ar_tpa;
-                }
-            }
+        /* no processing past MPLS */
+        return;
+    }
 
+    /* ARP */
+
+    if (m->dl_type == ETH_TYPE_ARP) {
+        if (pkt->buffer->size < offset + sizeof(struct arp_eth_header)) {
             return;
         }
+        proto->arp = (struct arp_eth_header *)((uint8_t *)pkt->buffer->data + offset);
+        offset += sizeof(struct arp_eth_header);
 
-        /* Network Layer */
-        else if (m->dl_type == ETH_TYPE_IP) {
-            if (pkt->buffer->size < offset + sizeof(struct ip_header)) {
-                return;
-            }
-            proto->ipv4 = (struct ip_header *)((uint8_t *)pkt->buffer->data + offset);
-            offset += sizeof(struct ip_header);
+        if (ntohs(proto->arp->ar_hrd) == 1 &&
+            ntohs(proto->arp->ar_pro) == ETH_TYPE_IP &&
+            proto->arp->ar_hln == ETH_ADDR_LEN &&
+            proto->arp->ar_pln == 4) {
 
-            m->nw_src =   proto->ipv4->ip_src;
-            m->nw_dst =   proto->ipv4->ip_dst;
-            m->nw_tos =  (proto->ipv4->ip_tos >> 2) & IP_DSCP_MASK;
-            m->nw_proto = proto->ipv4->ip_proto;
+            if (ntohs(proto->arp->ar_op) <= 0xff) {
+                m->nw_proto = ntohs(proto->arp->ar_op);
+            }
+            if (m->nw_proto == ARP_OP_REQUEST ||
+                m->nw_proto == ARP_OP_REPLY) {
 
-            if (IP_IS_FRAGMENT(proto->ipv4->ip_frag_off)) {
-                /* No further processing for fragmented IPv4 */
-                return;
+                m->nw_src = proto->arp->ar_spa;
+                m->nw_dst = proto->arp->ar_tpa;
             }
+        }
 
-            /* Transport */
+        return;
+    }
 
-            if (m->nw_proto == IP_TYPE_TCP) {
-                if (pkt->buffer->size < offset + sizeof(struct tcp_header)) {
-                    return;
-                }
-                proto->tcp = (struct tcp_header *)((uint8_t *)pkt->buffer->data + offset);
-                offset += sizeof(struct tcp_header);
+    /* Network Layer */
+    else if (m->dl_type == ETH_TYPE_IP) {
+        if (pkt->buffer->size < offset + sizeof(struct ip_header)) {
+            return;
+        }
+        proto->ipv4 = (struct ip_header *)((uint8_t *)pkt->buffer->data + offset);
+        offset += sizeof(struct ip_header);
 
-                m->tp_src = ntohs(proto->tcp->tcp_src);
-                m->tp_dst = ntohs(proto->tcp->tcp_dst);
+        m->nw_src =   proto->ipv4->ip_src;
+        m->nw_dst =   proto->ipv4->ip_dst;
+        m->nw_tos =  (proto->ipv4->ip_tos >> 2) & IP_DSCP_MASK;
+        m->nw_proto = proto->ipv4->ip_proto;
 
-                return;
-            }
+        if (IP_IS_FRAGMENT(proto->ipv4->ip_frag_off)) {
+            /* No further processing for fragmented IPv4 */
+            return;
+        }
 
-            else if (m->nw_proto == IP_TYPE_UDP) {
-                if (pkt->buffer->size < offset + sizeof(struct udp_header)) {
-                    return;
-                }
-                proto->udp = (struct udp_header *)((uint8_t *)pkt->buffer->data + offset);
-                offset += sizeof(struct udp_header);
+        handle->offset = offset;
+        handle->more   = true;
+    }
+}
 
-                m->tp_src = ntohs(proto->udp->udp_src);
-                m->tp_dst = ntohs(proto->udp->udp_dst);
+/* Parses the transport headers. */
+static void
+parse_l4(struct packet_handle_std *handle) {
+    struct packet *pkt = handle->pkt;
+    struct ofl_match_standard *m = handle->match;
+    struct protocols_std *proto = handle->proto;
+    size_t offset = handle->offset;
 
-                return;
+    if (!handle->more) {
+        return;
+    }
+    handle->more = false;
 
-            } else if (m->nw_proto == IP_TYPE_ICMP) {
-                if (pkt->buffer->size < offset + sizeof(struct icmp_header)) {
-                    return;
-                }
-                proto->icmp = (struct icmp_header *)((uint8_t *)pkt->buffer->data + offset);
-                offset += sizeof(struct icmp_header);
+    if (m->nw_proto == IP_TYPE_TCP) {
+        if (pkt->buffer->size < offset + sizeof(struct tcp_header)) {
+            return;
+        }
+        proto->tcp = (struct tcp_header *)((uint8_t *)pkt->buffer->data + offset);
 
-                m->tp_src = proto->icmp->icmp_type;
-                m->tp_dst = proto->icmp->icmp_code;
+        m->tp_src = ntohs(proto->tcp->tcp_src);
+        m->tp_dst = ntohs(proto->tcp->tcp_dst);
 
-                return;
+    } else if (m->nw_proto == IP_TYPE_UDP) {
+        if (pkt->buffer->size < offset + sizeof(struct udp_header)) {
+            return;
+        }
+        proto->udp = (struct udp_header *)((uint8_t *)pkt->buffer->data + offset);
 
-            } else if (m->nw_proto == IP_TYPE_SCTP) {
-                if (pkt->buffer->size < offset + sizeof(struct sctp_header)) {
-                    return;
-                }
-                proto->sctp = (struct sctp_header *)((uint8_t *)pkt->buffer->data + offset);
-                offset += sizeof(struct sctp_header);
+        m->tp_src = ntohs(proto->udp->udp_src);
+        m->tp_dst = ntohs(proto->udp->udp_dst);
 
-                m->tp_src = ntohs(proto->sctp->sctp_src);
-                m->tp_dst = ntohs(proto->sctp->sctp_dst);
+    } else if (m->nw_proto == IP_TYPE_ICMP) {
+        if (pkt->buffer->size < offset + sizeof(struct icmp_header)) {
+            return;
+        }
+        proto->icmp = (struct icmp_header *)((uint8_t *)pkt->buffer->data + offset);
 
-                return;
+        m->tp_src = proto->icmp->icmp_type;
+        m->tp_dst = proto->icmp->icmp_code;
+
+    } else if (m->nw_proto == IP_TYPE_SCTP) {
+        if (pkt->buffer->size < offset + sizeof(struct sctp_header)) {
+            return;
+        }
+        proto->sctp = (struct sctp_header *)((uint8_t *)pkt->buffer->data + offset);
+
+        m->tp_src = ntohs(proto->sctp->sctp_src);
+        m->tp_dst = ntohs(proto->sctp->sctp_dst);
+    }
+}
+
+void
+packet_handle_std_parse_layers(struct packet_handle_std *handle, enum packet_layer layer) {
+    /* NOTE: layers are parsed from the current contents of the buffer, so
+     *       actions which modified an already parsed layer in place are
+     *       reflected in the layers parsed later. */
+    while (handle->layer < layer) {
+        switch (handle->layer) {
+            case PACKET_LAYER_NONE: {
+                parse_l2(handle);
+                break;
+            }
+            case PACKET_LAYER_L2: {
+                parse_l3(handle);
+                break;
+            }
+            default: {
+                parse_l4(handle);
+                break;
             }
         }
+        handle->layer++;
     }
 }
 
-struct packet_handle_std *
-packet_handle_std_create(struct packet *pkt) {
-    struct packet_handle_std *handle = xmalloc(sizeof(struct packet_handle_std));
+enum packet_layer
+packet_handle_std_match_layer(struct ofl_match_standard *match) {
+    uint32_t w = match->wildcards;
 
+    if ((w & OFPFW_TP_SRC) == 0 || (w & OFPFW_TP_DST) == 0) {
+        return PACKET_LAYER_L4;
+    }
+    if ((w & OFPFW_NW_TOS) == 0 || (w & OFPFW_NW_PROTO) == 0 ||
+        (w & OFPFW_MPLS_LABEL) == 0 || (w & OFPFW_MPLS_TC) == 0 ||
+        match->nw_src_mask != 0xffffffff || match->nw_dst_mask != 0xffffffff) {
+        return PACKET_LAYER_L3;
+    }
+    return PACKET_LAYER_L2;
+}
+
+void
+packet_handle_std_init(struct packet_handle_std *handle, struct packet *pkt) {
     handle->pkt   = pkt;
-    handle->proto = xmalloc(sizeof(struct protocols_std));
-    handle->match = xmalloc(sizeof(struct ofl_match_standard));
+    handle->proto = &handle->proto_data;
+    handle->match = &handle->match_data;
     handle->match->metadata = 0x0000000000000000ULL; /* intialized for validate */
-    handle->valid = false;
-
-    packet_handle_std_validate(handle);
-
-    return handle;
+    handle->layer = PACKET_LAYER_NONE;
+    handle->more  = false;
 }
-struct packet_handle_std *
-packet_handle_std_clone(struct packet *pkt, struct packet_handle_std *handle UNUSED) {
-    struct packet_handle_std *clone = xmalloc(sizeof(struct packet_handle_std));
 
-    clone->pkt = pkt;
-    clone->proto = xmalloc(sizeof(struct protocols_std));
-    clone->match = xmalloc(sizeof(struct ofl_match_standard));
-    clone->valid = false;
-
-    // TODO Zoltan: if handle->valid, then match could be memcpy'd, and protocol
-    //              could be offset
-    packet_handle_std_validate(clone);
-
-    return clone;
+void
+packet_handle_std_copy(struct packet_handle_std *handle, struct packet_handle_std *src) {
+    handle->match_data = src->match_data;
+    handle->layer  = src->layer;
+    handle->more   = src->more;
+    handle->offset = src->offset;
+
+    if (src->layer != PACKET_LAYER_NONE) {
+        handle->proto_data = src->proto_data;
+        packet_handle_std_move(handle, (uint8_t *)handle->pkt->buffer->data -
+                                       (uint8_t *)src->pkt->buffer->data);
+    }
 }
 
+/* Moves a reference into the packet data, if it is set. */
+#define MOVE_PROTO(FIELD, DELTA)                                              \
+    do {                                                                      \
+        if ((FIELD) != NULL) {                                                \
+            (FIELD) = (void *)((uint8_t *)(FIELD) + (DELTA));                 \
+        }                                                                     \
+    } while (0)
+
 void
-packet_handle_std_destroy(struct packet_handle_std *handle) {
-    free(handle->proto);
-    free(handle->match);
-    free(handle);
+packet_handle_std_move(struct packet_handle_std *handle, ptrdiff_t delta) {
+    struct protocols_std *proto = handle->proto;
+
+    if (delta == 0 || handle->layer == PACKET_LAYER_NONE) {
+        return;
+    }
+    MOVE_PROTO(proto->eth, delta);
+    MOVE_PROTO(proto->eth_snap, delta);
+    MOVE_PROTO(proto->vlan, delta);
+    MOVE_PROTO(proto->vlan_last, delta);
+    MOVE_PROTO(proto->mpls, delta);
+    MOVE_PROTO(proto->ipv4, delta);
+    MOVE_PROTO(proto->arp, delta);
+    MOVE_PROTO(proto->tcp, delta);
+    MOVE_PROTO(proto->udp, delta);
+    MOVE_PROTO(proto->sctp, delta);
+    MOVE_PROTO(proto->icmp, delta);
 }
 
 bool
 packet_handle_std_is_ttl_valid(struct packet_handle_std *handle) {
-    packet_handle_std_validate(handle);
+    struct packet *pkt = handle->pkt;
+    uint8_t *l3;
 
-    if (handle->proto->mpls != NULL) {
-        uint32_t ttl = ntohl(handle->proto->mpls->fields) & MPLS_TTL_MASK;
+    packet_handle_std_parse(handle, PACKET_LAYER_L2);
 
-        if (ttl <= 1) {
+    if (handle->layer > PACKET_LAYER_L2) {
+        if (handle->proto->mpls != NULL &&
+            (ntohl(handle->proto->mpls->fields) & MPLS_TTL_MASK) <= 1) {
             return false;
         }
+        if (handle->proto->ipv4 != NULL && handle->proto->ipv4->ip_ttl <= 1) {
+            return false;
+        }
+        return true;
     }
 
-    if (handle->proto->ipv4 != NULL) {
-        if (handle->proto->ipv4->ip_ttl <= 1) {
-            return false;
+    /* NOTE: the TTL is read in place, with the same bounds as parse_l3, so
+     *       that checking it does not parse the network layer. */
+    if (!handle->more) {
+        return true;
+    }
+    l3 = (uint8_t *)pkt->buffer->data + handle->offset;
+
+    if (handle->match->dl_type == ETH_TYPE_MPLS ||
+        handle->match->dl_type == ETH_TYPE_MPLS_MCAST) {
+        if (pkt->buffer->size < handle->offset + sizeof(struct mpls_header)) {
+            return true;
+        }
+        return (ntohl(((struct mpls_header *)l3)->fields) & MPLS_TTL_MASK) > 1;
+    }
+
+    if (handle->match->dl_type == ETH_TYPE_IP) {
+        if (pkt->buffer->size < handle->offset + sizeof(struct ip_header)) {
+            return true;
         }
+        return ((struct ip_header *)l3)->ip_ttl > 1;
     }
 
     return true;
@@ -341,7 +435,7 @@ packet_handle_std_is_ttl_valid(struct packet_handle_std *handle) {
 
 bool
 packet_handle_std_is_fragment(struct packet_handle_std *handle) {
-    packet_handle_std_validate(handle);
+    packet_handle_std_parse(handle, PACKET_LAYER_L3);
 
     return ((handle->proto->ipv4 != NULL) &&
             IP_IS_FRAGMENT(handle->proto->ipv4->ip_frag_off));
@@ -33,15 +33,29 @@
 #define PACKET_HANDLE_STD_H 1
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdio.h>
-#include "packet.h"
-#include "packets.h"
 #include "oflib/ofl-structs.h"
+#include "packets.h"
+
+struct packet;
 
 /****************************************************************************
  * A handler processing a datapath packet for standard matches.
  ****************************************************************************/
 
+/* Protocol layers the handler parses the packet in. Each layer is only parsed
+ * when something needs its fields, so a packet which is only matched on
+ * in_port and ethernet fields is never parsed past its VLAN tags. */
+enum packet_layer {
+    PACKET_LAYER_NONE = 0,  /* nothing is parsed; the handler is invalid. */
+    PACKET_LAYER_L2   = 1,  /* ethernet and VLAN. */
+    PACKET_LAYER_L3   = 2,  /* MPLS, ARP and IPv4. */
+    PACKET_LAYER_L4   = 3   /* TCP, UDP, ICMP and SCTP; everything is parsed. */
+};
+
+#define PACKET_LAYERS (PACKET_LAYER_L4 + 1)
+
 /* A structure holding references to supported protocols within the packet. */
 struct protocols_std {
     struct eth_header      *eth;
@@ -64,18 +78,56 @@ struct packet_handle_std {
     struct ofl_match_standard  *match; /* Match fields extracted from the packet
                                             are also stored in a match structure
                                             for convenience */
-    bool                        valid; /* Set to true if the handler data is valid.
-                                            if false, it is revalidated before
-                                            executing any methods. */
+    uint8_t                     layer; /* Layer up to which the handler data is
+                                            valid. Further layers are parsed on
+                                            demand. */
+    bool                        more;  /* true if the next layer may have
+                                            headers to parse. */
+    size_t                      offset; /* offset of the next layer's headers. */
+
+    struct protocols_std        proto_data; /* storage behind proto */
+    struct ofl_match_standard   match_data; /* storage behind match */
 };
 
-/* Creates a handler */
-struct packet_handle_std *
-packet_handle_std_create(struct packet *pkt);
+/* Initializes a handler of the packet. The handler is validated on first
+ * use. */
+void
+packet_handle_std_init(struct packet_handle_std *handle, struct packet *pkt);
 
-/* Destroys a handler */
+/* Parses the layers of the packet past the ones already parsed, up to and
+ * including the given one. Use packet_handle_std_parse instead. */
 void
-packet_handle_std_destroy(struct packet_handle_std *handle);
+packet_handle_std_parse_layers(struct packet_handle_std *handle, enum packet_layer layer);
+
+/* Makes sure the handler data is valid up to the given layer. */
+static inline void
+packet_handle_std_parse(struct packet_handle_std *handle, enum packet_layer layer) {
+    if (handle->layer < layer) {
+        packet_handle_std_parse_layers(handle, layer);
+    }
+}
+
+/* Invalidates the handler data; e.g. after headers were pushed or popped.
+ * The metadata in the match is kept. */
+static inline void
+packet_handle_std_invalidate(struct packet_handle_std *handle) {
+    handle->layer = PACKET_LAYER_NONE;
+}
+
+/* Copies the parsed data of a handler to the handler of a packet with the
+ * same contents, e.g. a clone. */
+void
+packet_handle_std_copy(struct packet_handle_std *handle, struct packet_handle_std *src);
+
+/* Moves the references of the handler into the packet by delta bytes, after
+ * the packet data was moved. */
+void
+packet_handle_std_move(struct packet_handle_std *handle, ptrdiff_t delta);
+
+/* Returns the deepest layer a packet must be parsed to, so that the match
+ * can be decided on. */
+enum packet_layer
+packet_handle_std_match_layer(struct ofl_match_standard *match);
 
 /* Returns true if the TTL fields of the supported protocols are valid. */
 bool
@@ -96,13 +148,11 @@ packet_handle_std_to_string(struct packet_handle_std *handle);
 void
 packet_handle_std_print(FILE *stream, struct packet_handle_std *handle);
 
-/* Clones the handler, and associates it with the new packet. */
-struct packet_handle_std *
-packet_handle_std_clone(struct packet *pkt, struct packet_handle_std *handle);
-
-/* Revalidates the handler data */
-void
-packet_handle_std_validate(struct packet_handle_std *handle);
+/* Revalidates the handler data, parsing all layers. */
+static inline void
+packet_handle_std_validate(struct packet_handle_std *handle) {
+    packet_handle_std_parse(handle, PACKET_LAYER_L4);
+}
 
 
 #endif /* PACKET_HANDLE_STD_H */
@@ -30,6 +30,7 @@
  */
 
 #include <sys/types.h>
+#include <inttypes.h>
 #include <stdbool.h>
 #include <stdlib.h>
 
@@ -39,13 +40,17 @@
 #include "dp_buffers.h"
 #include "dp_exp.h"
 #include "dp_ports.h"
+#include "dp_workers.h"
 #include "datapath.h"
 #include "packet.h"
 #include "pipeline.h"
 #include "flow_table.h"
 #include "flow_entry.h"
+#include "match_std.h"
 #include "oflib/ofl.h"
 #include "oflib/ofl-structs.h"
+#include "oflib/ofl-utils.h"
+#include "openflow/openflow-ext.h"
 #include "util.h"
 #include "vlog.h"
 
@@ -53,6 +58,9 @@
 
 static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(60, 60);
 
+/* Maximum number of flow entries visited by a stats dump in one go. */
+#define STATS_DUMP_VISIT 4096
+
 static void
 execute_entry(struct pipeline *pl, struct flow_entry *entry,
               struct flow_table **table, struct packet *pkt);
@@ -70,6 +78,7 @@ pipeline_create(struct datapath *dp) {
     for (i=0; i<PIPELINE_TABLES; i++) {
         pl->tables[i] = flow_table_create(dp, i);
     }
+    pl->cache = flow_cache_create();
     pl->dp = dp;
 
     return pl;
@@ -78,26 +87,13 @@ pipeline_create(struct datapath *dp) {
 /* Sends a packet to the controller in a packet_in message */
 static void
 send_packet_to_controller(struct pipeline *pl, struct packet *pkt, uint8_t table_id, uint8_t reason) {
-    dp_buffers_save(pl->dp->buffers, pkt);
-
-    {
-        struct ofl_msg_packet_in msg =
-                {{.type = OFPT_PACKET_IN},
-                 .buffer_id   = pkt->buffer_id,
-                 .in_port     = pkt->in_port,
-                 .in_phy_port = pkt->in_port, // TODO: how to get phy port for v.port?
-                 .total_len   = pkt->buffer->size,
-                 .reason      = reason,
-                 .table_id    = table_id,
-                 .data_length = MIN(pl->dp->config.miss_send_len, pkt->buffer->size),
-                 .data        = pkt->buffer->data};
-
-        dp_send_message(pl->dp, (struct ofl_msg_header *)&msg, NULL);
-    }
+    dp_send_packet_in(pl->dp, pkt, table_id, reason, pl->dp->config.miss_send_len);
 }
 
 void
 pipeline_process_packet(struct pipeline *pl, struct packet *pkt) {
+    struct dp_worker *worker = dp_workers_current();
+    struct flow_cache *cache = (worker != NULL) ? worker->cache : pl->cache;
     struct flow_table *table, *next_table;
 
     if (VLOG_IS_DBG_ENABLED(LOG_MODULE)) {
@@ -130,7 +126,7 @@ pipeline_process_packet(struct pipeline *pl, struct packet *pkt) {
         table         = next_table;
         next_table    = NULL;
 
-        entry = flow_table_lookup(table, pkt);
+        entry = flow_table_lookup(table, pkt, cache);
 
         if (entry != NULL) {
             if (VLOG_IS_DBG_ENABLED(LOG_MODULE)) {
@@ -160,6 +156,31 @@ pipeline_process_packet(struct pipeline *pl, struct packet *pkt) {
 }
 
 
+/* Replaces the match and instructions of a flow mod unpacked into the arena of
+ * the datapath by owned copies, as the flow table may keep them. */
+static void
+promote_flow_mod(struct pipeline *pl, struct ofl_msg_flow_mod *msg) {
+    struct ofl_instruction_header **insts;
+    struct ofl_match_header *match;
+    size_t i;
+
+    if (!ofl_arena_owns(&pl->dp->arena, msg)) {
+        return;
+    }
+
+    match = ofl_structs_match_clone(msg->match, pl->dp->exp);
+    ofl_structs_free_match(msg->match, pl->dp->exp);
+    msg->match = match;
+
+    insts = xmalloc(sizeof(struct ofl_instruction_header *) * msg->instructions_num);
+    for (i=0; i < msg->instructions_num; i++) {
+        insts[i] = ofl_structs_instruction_clone(msg->instructions[i], pl->dp->exp);
+    }
+    OFL_UTILS_FREE_ARR_FUN2(msg->instructions, msg->instructions_num,
+                            ofl_structs_free_instruction, pl->dp->exp);
+    msg->instructions = insts;
+}
+
 ofl_err
 pipeline_handle_flow_mod(struct pipeline *pl, struct ofl_msg_flow_mod *msg,
                                                 const struct sender *sender UNUSED) {
@@ -206,10 +227,16 @@ pipeline_handle_flow_mod(struct pipeline *pl, struct ofl_msg_flow_mod *msg,
             return ofl_error(OFPET_FLOW_MOD_FAILED, OFPFMFC_BAD_TABLE_ID);
         }
     } else {
+        if (msg->command == OFPFC_ADD || msg->command == OFPFC_MODIFY || msg->command == OFPFC_MODIFY_STRICT) {
+            promote_flow_mod(pl, msg);
+        }
         error = flow_table_flow_mod(pl->tables[msg->table_id], msg, &match_kept, &insts_kept);
         if (error) {
             return error;
         }
+        if (msg->command != OFPFC_DELETE && msg->command != OFPFC_DELETE_STRICT) {
+            dp_pktin_flows_clear(pl->dp);
+        }
         if ((msg->command == OFPFC_ADD || msg->command == OFPFC_MODIFY || msg->command == OFPFC_MODIFY_STRICT) &&
                             msg->buffer_id != NO_BUFFER) {
             /* run buffered message through pipeline */
@@ -248,37 +275,96 @@ pipeline_handle_table_mod(struct pipeline *pl,
     return 0;
 }
 
-ofl_err
-pipeline_handle_stats_request_flow(struct pipeline *pl,
-                                   struct ofl_msg_stats_request_flow *msg,
-                                   const struct sender *sender) {
+/* A flow or aggregate stats request being answered over several runs. */
+struct stats_dump {
+    struct pipeline                     *pl;
+    struct ofl_msg_stats_request_flow    req;       /* copy of the request,
+                                                       owning its match. */
+    size_t                               table_id;  /* table being dumped. */
+    size_t                               table_last;
+    struct flow_table_cursor             cursor;
+    struct ofl_msg_stats_reply_aggregate aggregate; /* sums collected so far. */
+};
+
+/* Starts dumping the tables selected by the request; the request is freed. */
+static struct stats_dump *
+stats_dump_create(struct pipeline *pl, struct ofl_msg_stats_request_flow *msg) {
+    struct stats_dump *dump = xmalloc(sizeof(struct stats_dump));
+
+    dump->pl = pl;
+    dump->req = *msg;
+    dump->req.match = ofl_structs_match_clone(msg->match, pl->dp->exp);
+    dump->table_id   = msg->table_id == 0xff ? 0 : msg->table_id;
+    dump->table_last = msg->table_id == 0xff ? PIPELINE_TABLES - 1 : msg->table_id;
+    flow_table_cursor_init(pl->tables[dump->table_id], &dump->cursor);
+
+    ofl_msg_free((struct ofl_msg_header *)msg, pl->dp->exp);
+    return dump;
+}
 
+/* Moves the dump to the next table. Returns false if there are no more. */
+static bool
+stats_dump_next_table(struct stats_dump *dump) {
+    if (dump->table_id == dump->table_last) {
+        return false;
+    }
+    flow_table_cursor_destroy(&dump->cursor);
+    dump->table_id++;
+    flow_table_cursor_init(dump->pl->tables[dump->table_id], &dump->cursor);
+    return true;
+}
+
+static void
+stats_dump_done(void *dump_) {
+    struct stats_dump *dump = (struct stats_dump *)dump_;
+
+    flow_table_cursor_destroy(&dump->cursor);
+    ofl_structs_free_match(dump->req.match, dump->pl->dp->exp);
+    free(dump);
+}
+
+/* Sends the next reply of a flow stats dump. */
+static int
+stats_dump_flow(struct datapath *dp, const struct sender *sender, void *dump_) {
+    struct stats_dump *dump = (struct stats_dump *)dump_;
     struct ofl_flow_stats **stats = xmalloc(sizeof(struct ofl_flow_stats *));
     size_t stats_size = 1;
     size_t stats_num = 0;
-
-    if (msg->table_id == 0xff) {
-        size_t i;
-        for (i=0; i<PIPELINE_TABLES; i++) {
-            flow_table_stats(pl->tables[i], msg, &stats, &stats_size, &stats_num);
+    size_t bytes = DP_STATS_REPLY_MAX - sizeof(struct ofp_stats_reply);
+    size_t visit = STATS_DUMP_VISIT;
+    bool more = true;
+
+    while (flow_table_stats(dump->pl->tables[dump->table_id], &dump->req, &dump->cursor,
+                            visit, &bytes, &stats, &stats_size, &stats_num)) {
+        if (!stats_dump_next_table(dump)) {
+            more = false;
+            break;
         }
-    } else {
-        flow_table_stats(pl->tables[msg->table_id], msg, &stats, &stats_size, &stats_num);
     }
 
-    {
+    /* NOTE: if only non-matching entries were visited so far, the reply is
+     *       sent in the next run. */
+    if (stats_num > 0 || !more) {
         struct ofl_msg_stats_reply_flow reply =
                 {{{.type = OFPT_STATS_REPLY},
-                  .type = OFPST_FLOW, .flags = 0x0000},
+                  .type = OFPST_FLOW, .flags = more ? OFPSF_REPLY_MORE : 0x0000},
                  .stats     = stats,
                  .stats_num = stats_num
                 };
 
-        dp_send_message(pl->dp, (struct ofl_msg_header *)&reply, sender);
+        dp_send_message(dp, (struct ofl_msg_header *)&reply, sender);
     }
 
     free(stats);
-    ofl_msg_free((struct ofl_msg_header *)msg, pl->dp->exp);
+    return more ? 1 : 0;
+}
+
+ofl_err
+pipeline_handle_stats_request_flow(struct pipeline *pl,
+                                   struct ofl_msg_stats_request_flow *msg,
+                                   const struct sender *sender) {
+    dp_start_dump(pl->dp, sender, stats_dump_flow, stats_dump_done,
+                  stats_dump_create(pl, msg));
     return 0;
 }
 
@@ -310,10 +396,56 @@ pipeline_handle_stats_request_table(struct pipeline *pl,
     return 0;
 }
 
+ofl_err
+pipeline_handle_flow_cache_request(struct pipeline *pl,
+                                   struct ofl_exp_openflow_msg_header *msg,
+                                   const struct sender *sender) {
+    struct ofl_exp_openflow_msg_flow_cache reply =
+            {{{{.type = OFPT_EXPERIMENTER},
+               .experimenter_id = OPENFLOW_VENDOR_ID},
+              .type = OFP_EXT_FLOW_CACHE_REPLY},
+             .hits   = pl->cache->hits,
+             .misses = pl->cache->misses};
+    size_t i;
+
+    /* NOTE: the workers keep counting meanwhile; the sums are a snapshot. */
+    if (pl->dp->workers != NULL) {
+        for (i=0; i<pl->dp->workers->workers_num; i++) {
+            reply.hits   += pl->dp->workers->workers[i].cache->hits;
+            reply.misses += pl->dp->workers->workers[i].cache->misses;
+        }
+    }
+
+    dp_send_message(pl->dp, (struct ofl_msg_header *)&reply, sender);
+
+    ofl_msg_free((struct ofl_msg_header *)msg, pl->dp->exp);
+    return 0;
+}
+
+/* Collects the next part of an aggregate stats dump, and sends the reply when
+ * all tables are done. */
+static int
+stats_dump_aggregate(struct datapath *dp, const struct sender *sender, void *dump_) {
+    struct stats_dump *dump = (struct stats_dump *)dump_;
+
+    if (!flow_table_aggregate_stats(dump->pl->tables[dump->table_id], &dump->req, &dump->cursor,
+                                    STATS_DUMP_VISIT, &dump->aggregate.packet_count,
+                                    &dump->aggregate.byte_count, &dump->aggregate.flow_count)) {
+        return 1;
+    }
+    if (stats_dump_next_table(dump)) {
+        return 1;
+    }
+
+    dp_send_message(dp, (struct ofl_msg_header *)&dump->aggregate, sender);
+    return 0;
+}
+
 ofl_err
 pipeline_handle_stats_request_aggregate(struct pipeline *pl,
                                   struct ofl_msg_stats_request_flow *msg,
                                   const struct sender *sender) {
+    struct stats_dump *dump;
     struct ofl_msg_stats_reply_aggregate reply =
             {{{.type = OFPT_STATS_REPLY},
               .type = OFPST_AGGREGATE, .flags = 0x0000},
@@ -321,26 +453,32 @@ pipeline_handle_stats_request_aggregate(struct pipeline *pl,
               .byte_count   = 0,
               .flow_count   = 0};
 
-    if (msg->table_id == 0xff) {
+    /* Requests selecting entries by cookie only are answered from the
+     * rollups of the tables; the others visit the entries. */
+    if (msg->out_port == OFPP_ANY && msg->out_group == OFPG_ANY &&
+        msg->match->type == OFPMT_STANDARD &&
+        match_std_all((struct ofl_match_standard *)msg->match)) {
+        size_t first = msg->table_id == 0xff ? 0 : msg->table_id;
+        size_t last  = msg->table_id == 0xff ? PIPELINE_TABLES - 1 : msg->table_id;
         size_t i;
 
-        for (i=0; i<PIPELINE_TABLES; i++) {
-            flow_table_aggregate_stats(pl->tables[i], msg,
-                                       &reply.packet_count, &reply.byte_count, &reply.flow_count);
+        for (i = first; i <= last; i++) {
+            flow_table_rollup_stats(pl->tables[i], msg->cookie, msg->cookie_mask,
+                                    &reply.packet_count, &reply.byte_count, &reply.flow_count);
         }
 
-    } else {
-        flow_table_aggregate_stats(pl->tables[msg->table_id], msg,
-                                   &reply.packet_count, &reply.byte_count, &reply.flow_count);
-    }
+        dp_send_message(pl->dp, (struct ofl_msg_header *)&reply, sender);
 
-    dp_send_message(pl->dp, (struct ofl_msg_header *)&reply, sender);
+        ofl_msg_free((struct ofl_msg_header *)msg, pl->dp->exp);
+        return 0;
+    }
 
-    ofl_msg_free((struct ofl_msg_header *)msg, pl->dp->exp);
+    dump = stats_dump_create(pl, msg);
+    dump->aggregate = reply;
+    dp_start_dump(pl->dp, sender, stats_dump_aggregate, stats_dump_done, dump);
     return 0;
 }
 
-
 void
 pipeline_destroy(struct pipeline *pl) {
     struct flow_table *table;
@@ -352,6 +490,7 @@ pipeline_destroy(struct pipeline *pl) {
             flow_table_destroy(table);
         }
     }
+    flow_cache_destroy(pl->cache);
     free(pl);
 }
 
@@ -366,89 +505,39 @@ pipeline_timeout(struct pipeline *pl) {
 }
 
 
-/* Returns the instruction with the given type from the set of instructions. */
-static struct ofl_instruction_header *
-get_instruction(size_t insts_num, struct ofl_instruction_header **insts, uint16_t type) {
-    size_t i;
-
-    for (i=0; i < insts_num; i++) {
-        if (insts[i]->type == type) {
-            return insts[i];
-        }
-    }
-
-    return NULL;
-}
-
-
 /* Executes the instructions associated with a flow entry */
 static void
-execute_entry(struct pipeline *pl, struct flow_entry *entry,
+execute_entry(struct pipeline *pl UNUSED, struct flow_entry *entry,
               struct flow_table **next_table, struct packet *pkt) {
-    /* NOTE: CLEAR instruction must be executed before WRITE_ACTIONS;
-     *       GOTO instruction must be executed last according to spec. */
-    struct ofl_instruction_header *inst, *cinst;
+    /* NOTE: the program is compiled in the order the spec requires: CLEAR
+     *       before WRITE_ACTIONS, and GOTO last. */
+    struct flow_program *prog = entry->program;
     size_t i;
-    bool clear_execd = false;
 
-    for (i=0; i < entry->stats->instructions_num; i++) {
-        inst = entry->stats->instructions[i];
-
-        switch (inst->type) {
-            case OFPIT_GOTO_TABLE: {
-                struct ofl_instruction_goto_table *gi = (struct ofl_instruction_goto_table *)inst;
+    if (prog->apply_num > 0) {
+        dp_execute_ops(pkt, prog->apply_num, prog->apply);
+    }
+    if (prog->clear) {
+        action_set_clear_actions(pkt->action_set);
+    }
+    if (prog->write_num > 0) {
+        action_set_write_actions(pkt->action_set, prog->write_num, prog->write);
+    }
+    if (prog->write_metadata) {
+        struct ofl_match_standard *m;
 
-                *next_table = pl->tables[gi->table_id];
-                break;
-            }
-            case OFPIT_WRITE_METADATA: {
-                struct ofl_instruction_write_metadata *wi = (struct ofl_instruction_write_metadata *)inst;
-                struct ofl_match_standard *m;
-
-                /* NOTE: Hackish solution. If packet had multiple handles, metadata
-                 *       should be updated in all. */
-                packet_handle_std_validate(pkt->handle_std);
-                m = (struct ofl_match_standard *)pkt->handle_std->match;
-
-                m->metadata =
-                        (m->metadata & ~wi->metadata_mask) | (wi->metadata & wi->metadata_mask);
-                break;
-            }
-            case OFPIT_WRITE_ACTIONS: {
-                struct ofl_instruction_actions *wa = (struct ofl_instruction_actions *)inst;
-
-                /* If no clear action was executed before, check if there is one,
-                   and execute it out of order */
-                if (!clear_execd) {
-                    cinst = get_instruction(entry->stats->instructions_num, entry->stats->instructions, OFPIT_CLEAR_ACTIONS);
-                    if (cinst != NULL) {
-                        action_set_clear_actions(pkt->action_set);
-                        clear_execd = true;
-                    }
-                    action_set_write_actions(pkt->action_set, wa->actions_num, wa->actions);
-                }
-                break;
-            }
-            case OFPIT_APPLY_ACTIONS: {
-                struct ofl_instruction_actions *ia = (struct ofl_instruction_actions *)inst;
+        /* NOTE: Hackish solution. If packet had multiple handles, metadata
+         *       should be updated in all. */
+        packet_handle_std_parse(pkt->handle_std, PACKET_LAYER_L2);
+        m = (struct ofl_match_standard *)pkt->handle_std->match;
 
-                dp_execute_action_list(pkt, ia->actions_num, ia->actions);
-                break;
-            }
-            case OFPIT_CLEAR_ACTIONS: {
-                /* Only execute clear if it has not been executed out of order */
-                if (!clear_execd) {
-                    action_set_clear_actions(pkt->action_set);
-                    clear_execd = true;
-                }
-                break;
-            }
-            case OFPIT_EXPERIMENTER: {
-                dp_exp_inst(pkt, (struct ofl_instruction_experimenter *)inst);
-                break;
-            }
-        }
+        m->metadata = (m->metadata & ~prog->metadata_mask) | prog->metadata;
+    }
+    for (i=0; i < prog->exp_num; i++) {
+        dp_exp_inst(pkt, prog->exp[i]);
     }
+
+    *next_table = prog->goto_table;
 }
 
 /* Executes the instructions associated to the flow table, if no matching flow
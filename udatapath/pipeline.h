@@ -36,8 +36,10 @@
 #include "datapath.h"
 #include "packet.h"
 #include "flow_table.h"
+#include "flow_cache.h"
 #include "oflib/ofl.h"
 #include "oflib/ofl-messages.h"
+#include "oflib-exp/ofl-exp-openflow.h"
 
 /* Number of tables in the pipeline */
 #define PIPELINE_TABLES 255
@@ -53,6 +55,7 @@ struct sender;
 struct pipeline {
     struct datapath    *dp;
     struct flow_table  *tables[PIPELINE_TABLES];
+    struct flow_cache  *cache;   /* exact match cache of table lookups. */
 };
 
 
@@ -94,6 +97,13 @@ pipeline_handle_stats_request_aggregate(struct pipeline *pl,
                                   struct ofl_msg_stats_request_flow *msg,
                                   const struct sender *sender);
 
+/* Handles a flow cache counters request; the counters of the caches of all
+ * threads processing packets are summed. */
+ofl_err
+pipeline_handle_flow_cache_request(struct pipeline *pl,
+                                   struct ofl_exp_openflow_msg_header *msg,
+                                   const struct sender *sender);
+
 
 /* Commands pipeline to check if any flow in any table is timed out. */
 void
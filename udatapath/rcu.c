@@ -0,0 +1,180 @@
+/* Copyright (c) 2011, TrafficLab, Ericsson Research, Hungary
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Ericsson Research nor the names of its
+ *     contributors may be used to endorse or promote products derived from
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sched.h>
+#include <stdlib.h>
+#include "hmap.h"
+#include "list.h"
+#include "rcu.h"
+#include "util.h"
+
+struct rcu_callback {
+    struct list   node;
+    uint64_t      epoch;
+    void        (*cb)(void *);
+    void         *arg;
+};
+
+void
+rcu_init(struct rcu *rcu) {
+    rcu->epoch       = RCU_OFFLINE + 1;
+    rcu->pending     = 0;
+    rcu->exclusive   = 0;
+    rcu->readers     = NULL;
+    rcu->readers_num = 0;
+    list_init(&rcu->deferred);
+}
+
+void
+rcu_register(struct rcu *rcu, struct rcu_reader *reader) {
+    pthread_mutex_init(&reader->lock, NULL);
+    reader->epoch = RCU_OFFLINE;
+
+    rcu->readers = xrealloc(rcu->readers, sizeof(struct rcu_reader *) * (rcu->readers_num + 1));
+    rcu->readers[rcu->readers_num++] = reader;
+}
+
+void
+rcu_read_lock(struct rcu *rcu, struct rcu_reader *reader) {
+    /* give way to the writer, mutexes are not fair. */
+    while (rcu->pending) {
+        sched_yield();
+    }
+    pthread_mutex_lock(&reader->lock);
+
+    reader->epoch = rcu->epoch;
+    /* the epoch must be visible before any shared data is read. */
+    rcu_barrier();
+}
+
+void
+rcu_read_unlock(struct rcu *rcu UNUSED, struct rcu_reader *reader) {
+    rcu_barrier();
+    reader->epoch = RCU_OFFLINE;
+
+    pthread_mutex_unlock(&reader->lock);
+}
+
+void
+rcu_defer(struct rcu *rcu, void (*cb)(void *), void *arg) {
+    struct rcu_callback *c;
+
+    if (rcu == NULL) {
+        cb(arg);
+        return;
+    }
+
+    c = xmalloc(sizeof(struct rcu_callback));
+    c->cb    = cb;
+    c->arg   = arg;
+    c->epoch = rcu->epoch;
+    list_push_back(&rcu->deferred, &c->node);
+
+    /* readers entering from now on cannot see the object. */
+    rcu_barrier();
+    rcu->epoch++;
+}
+
+void
+rcu_run(struct rcu *rcu) {
+    struct rcu_callback *c, *next;
+    uint64_t oldest = rcu->epoch;
+    size_t i;
+
+    for (i = 0; i < rcu->readers_num; i++) {
+        uint64_t epoch = rcu->readers[i]->epoch;
+
+        if (epoch != RCU_OFFLINE && epoch < oldest) {
+            oldest = epoch;
+        }
+    }
+    rcu_barrier();
+
+    LIST_FOR_EACH_SAFE (c, next, struct rcu_callback, node, &rcu->deferred) {
+        if (c->epoch >= oldest) {
+            break;
+        }
+        list_remove(&c->node);
+        c->cb(c->arg);
+        free(c);
+    }
+}
+
+void
+rcu_exclusive_begin(struct rcu *rcu) {
+    size_t i;
+
+    if (rcu == NULL || rcu->exclusive++ > 0) {
+        return;
+    }
+
+    rcu->pending = 1;
+    for (i = 0; i < rcu->readers_num; i++) {
+        pthread_mutex_lock(&rcu->readers[i]->lock);
+    }
+    rcu->pending = 0;
+}
+
+void
+rcu_exclusive_end(struct rcu *rcu) {
+    size_t i;
+
+    if (rcu == NULL || --rcu->exclusive > 0) {
+        return;
+    }
+
+    for (i = 0; i < rcu->readers_num; i++) {
+        pthread_mutex_unlock(&rcu->readers[i]->lock);
+    }
+}
+
+void
+rcu_hmap_insert(struct rcu *rcu, struct hmap *hmap, struct hmap_node *node, size_t hash) {
+    /* NOTE: same growth policy as hmap_insert; rehashing moves the nodes of
+     *       the map, so it must not be seen by readers. */
+    if ((hmap->n + 1) / 2 > hmap->mask) {
+        rcu_exclusive_begin(rcu);
+        hmap_reserve(hmap, hmap->n + 1);
+        rcu_exclusive_end(rcu);
+    }
+
+    node->hash = hash;
+    node->next = hmap->buckets[hash & hmap->mask];
+    rcu_barrier();
+    hmap->buckets[hash & hmap->mask] = node;
+    hmap->n++;
+}
+
+void
+rcu_list_insert(struct list *before, struct list *elem) {
+    elem->prev = before->prev;
+    elem->next = before;
+    rcu_barrier();
+    before->prev->next = elem;
+    before->prev = elem;
+}
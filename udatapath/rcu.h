@@ -0,0 +1,119 @@
+/* Copyright (c) 2011, TrafficLab, Ericsson Research, Hungary
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Ericsson Research nor the names of its
+ *     contributors may be used to endorse or promote products derived from
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RCU_H
+#define RCU_H 1
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "hmap.h"
+#include "list.h"
+
+
+/****************************************************************************
+ * Read-copy-update support for data shared by a single writer (the control
+ * thread) and any number of registered reader threads.
+ *
+ * Readers enter a read side critical section for each batch of work, and
+ * announce the epoch they entered at. The writer unlinks objects so that
+ * readers entering later cannot find them, and defers freeing them until
+ * every reader has left the critical sections it was in at the time.
+ *
+ * Changes which cannot be done without disturbing readers (e.g. rehashing a
+ * hash map) are done in an exclusive section, which waits for all readers to
+ * leave their critical sections, and keeps them out until it ends.
+ *
+ * All writer side functions accept a NULL rcu, in which case there are no
+ * concurrent readers: objects are freed immediately, and exclusive sections
+ * are no-ops.
+ ****************************************************************************/
+
+/* Epoch of readers outside of critical sections. */
+#define RCU_OFFLINE 0
+
+struct rcu_reader {
+    pthread_mutex_t     lock;    /* held in critical sections. */
+    volatile uint64_t   epoch;   /* epoch the critical section was entered at. */
+};
+
+struct rcu {
+    volatile uint64_t    epoch;
+    volatile int         pending;      /* writer waits for an exclusive section. */
+    size_t               exclusive;    /* nesting depth of exclusive sections. */
+    struct rcu_reader  **readers;
+    size_t               readers_num;
+    struct list          deferred;     /* callbacks in increasing epoch order. */
+};
+
+/* Makes sure stores to an object are visible before the object is published. */
+#define rcu_barrier() __sync_synchronize()
+
+void
+rcu_init(struct rcu *rcu);
+
+/* Registers a reader. Must be called before the reader thread starts. */
+void
+rcu_register(struct rcu *rcu, struct rcu_reader *reader);
+
+/* Enters a read side critical section. */
+void
+rcu_read_lock(struct rcu *rcu, struct rcu_reader *reader);
+
+/* Leaves the read side critical section. */
+void
+rcu_read_unlock(struct rcu *rcu, struct rcu_reader *reader);
+
+/* Calls cb(arg) once no reader can hold a reference to arg anymore. */
+void
+rcu_defer(struct rcu *rcu, void (*cb)(void *), void *arg);
+
+/* Calls the deferred callbacks which became safe to call. */
+void
+rcu_run(struct rcu *rcu);
+
+/* Waits for all readers to leave their critical sections, and keeps them out
+ * until rcu_exclusive_end is called. Exclusive sections may be nested. */
+void
+rcu_exclusive_begin(struct rcu *rcu);
+
+void
+rcu_exclusive_end(struct rcu *rcu);
+
+/* Inserts the node into a hash map read by readers. */
+void
+rcu_hmap_insert(struct rcu *rcu, struct hmap *hmap, struct hmap_node *node, size_t hash);
+
+/* Inserts elem before the given element into a list read by readers, which
+ * only walk the list forward. Removal with list_remove is safe. */
+void
+rcu_list_insert(struct list *before, struct list *elem);
+
+
+#endif /* RCU_H */
@@ -0,0 +1,151 @@
+/* Copyright (c) 2011, TrafficLab, Ericsson Research, Hungary
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Ericsson Research nor the names of its
+ *     contributors may be used to endorse or promote products derived from
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "list.h"
+#include "timer_wheel.h"
+
+/* Places the timer in the slot matching its expiration. */
+static void
+place(struct timer_wheel *wheel, struct timer_wheel_timer *timer) {
+    uint64_t delta;
+    size_t level;
+
+    if (timer->expires < wheel->now) {
+        timer->expires = wheel->now;
+    }
+    delta = timer->expires - wheel->now;
+
+    for (level = 0; level < TIMER_WHEEL_LEVELS - 1; level++) {
+        if (delta < (1ULL << (TIMER_WHEEL_BITS * (level + 1)))) {
+            break;
+        }
+    }
+    if (level == TIMER_WHEEL_LEVELS - 1 &&
+        delta >= (1ULL << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS))) {
+        /* out of range; it is placed again when its slot is cascaded. */
+        timer->expires = wheel->now + (1ULL << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)) - 1;
+    }
+
+    list_push_back(&wheel->slots[level][(timer->expires >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK],
+                   &timer->node);
+}
+
+/* Moves the timers of the current slot of the given level to lower levels. */
+static void
+cascade(struct timer_wheel *wheel, size_t level) {
+    struct list *slot = &wheel->slots[level][(wheel->now >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK];
+
+    while (!list_is_empty(slot)) {
+        struct timer_wheel_timer *timer = CONTAINER_OF(list_pop_front(slot),
+                                                       struct timer_wheel_timer, node);
+        place(wheel, timer);
+    }
+}
+
+void
+timer_wheel_init(struct timer_wheel *wheel, uint64_t now_ms) {
+    size_t i, j;
+
+    wheel->now        = now_ms / TIMER_WHEEL_TICK_MS;
+    wheel->timers_num = 0;
+
+    for (i = 0; i < TIMER_WHEEL_LEVELS; i++) {
+        for (j = 0; j < TIMER_WHEEL_SLOTS; j++) {
+            list_init(&wheel->slots[i][j]);
+        }
+    }
+}
+
+void
+timer_wheel_timer_init(struct timer_wheel_timer *timer,
+                       void (*cb)(struct timer_wheel_timer *timer)) {
+    list_init(&timer->node);
+    timer->expires = 0;
+    timer->cb      = cb;
+}
+
+void
+timer_wheel_add(struct timer_wheel *wheel, struct timer_wheel_timer *timer, uint64_t expires_ms) {
+    timer_wheel_del(wheel, timer);
+
+    /* NOTE: rounded up, so timers never expire early. */
+    timer->expires = (expires_ms + TIMER_WHEEL_TICK_MS - 1) / TIMER_WHEEL_TICK_MS;
+    place(wheel, timer);
+    wheel->timers_num++;
+}
+
+void
+timer_wheel_del(struct timer_wheel *wheel, struct timer_wheel_timer *timer) {
+    if (timer_wheel_is_scheduled(timer)) {
+        list_remove(&timer->node);
+        list_init(&timer->node);
+        wheel->timers_num--;
+    }
+}
+
+void
+timer_wheel_run(struct timer_wheel *wheel, uint64_t now_ms) {
+    uint64_t target = now_ms / TIMER_WHEEL_TICK_MS;
+
+    while (wheel->now <= target) {
+        struct list expired, *slot;
+        size_t level;
+
+        if (wheel->timers_num == 0) {
+            /* nothing to expire; skip the idle ticks. */
+            wheel->now = target + 1;
+            break;
+        }
+
+        for (level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+            if (((wheel->now >> (TIMER_WHEEL_BITS * (level - 1))) & TIMER_WHEEL_MASK) != 0) {
+                break;
+            }
+            cascade(wheel, level);
+        }
+
+        /* NOTE: the slot is taken over before calling the callbacks, and the
+         *       wheel is advanced, so timers added by them for this tick
+         *       expire on the next one. */
+        slot = &wheel->slots[0][wheel->now & TIMER_WHEEL_MASK];
+        list_init(&expired);
+        list_splice(&expired, slot->next, slot);
+        wheel->now++;
+
+        while (!list_is_empty(&expired)) {
+            struct timer_wheel_timer *timer = CONTAINER_OF(list_pop_front(&expired),
+                                                           struct timer_wheel_timer, node);
+            list_init(&timer->node);
+            wheel->timers_num--;
+            timer->cb(timer);
+        }
+    }
+}
@@ -0,0 +1,94 @@
+/* Copyright (c) 2011, TrafficLab, Ericsson Research, Hungary
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Ericsson Research nor the names of its
+ *     contributors may be used to endorse or promote products derived from
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H 1
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "list.h"
+
+
+/****************************************************************************
+ * Hierarchical timing wheel. Timers are kept in slots of the level given by
+ * how far in the future they expire; whenever a level wraps around, the
+ * timers in the next slot of the level above are moved down. Adding and
+ * removing a timer is O(1), and running the wheel is proportional to the
+ * number of ticks passed and timers expired.
+ ****************************************************************************/
+
+#define TIMER_WHEEL_TICK_MS 100   /* resolution of the wheel. */
+#define TIMER_WHEEL_BITS    6
+#define TIMER_WHEEL_SLOTS   (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_MASK    (TIMER_WHEEL_SLOTS - 1)
+#define TIMER_WHEEL_LEVELS  4     /* covers 64^4 ticks; about 19 days. */
+
+struct timer_wheel_timer {
+    struct list   node;       /* node in the slot; empty if not scheduled. */
+    uint64_t      expires;    /* tick the timer expires at. */
+    void        (*cb)(struct timer_wheel_timer *timer);
+};
+
+struct timer_wheel {
+    uint64_t      now;        /* next tick to be processed. */
+    size_t        timers_num;
+    struct list   slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+};
+
+/* Initializes an empty wheel, starting at the given time. */
+void
+timer_wheel_init(struct timer_wheel *wheel, uint64_t now_ms);
+
+/* Initializes a timer, which calls cb when it expires. */
+void
+timer_wheel_timer_init(struct timer_wheel_timer *timer,
+                       void (*cb)(struct timer_wheel_timer *timer));
+
+/* Schedules the timer to expire at the given time. The timer is rescheduled
+ * if it was already scheduled. Timers in the past expire on the next run. */
+void
+timer_wheel_add(struct timer_wheel *wheel, struct timer_wheel_timer *timer, uint64_t expires_ms);
+
+/* Cancels the timer, if it is scheduled. */
+void
+timer_wheel_del(struct timer_wheel *wheel, struct timer_wheel_timer *timer);
+
+/* Returns true if the timer is scheduled. */
+static inline bool
+timer_wheel_is_scheduled(struct timer_wheel_timer *timer) {
+    return !list_is_empty(&timer->node);
+}
+
+/* Calls the callbacks of the timers expired by the given time. Callbacks may
+ * add and delete any timers of the wheel. */
+void
+timer_wheel_run(struct timer_wheel *wheel, uint64_t now_ms);
+
+
+#endif /* TIMER_WHEEL_H */
@@ -77,6 +77,9 @@ static struct datapath *dp;
 
 static char *port_list;
 static char *local_port = "tap:";
+static size_t n_threads = 0;
+static int rate_limit = 0;
+static int burst_limit = 0;
 
 static void add_ports(struct datapath *dp, char *port_list);
 
@@ -156,6 +159,10 @@ udatapath_cmd(int argc, char *argv[])
     die_if_already_running();
     daemonize();
 
+    if (n_threads > 0) {
+        dp_workers_start(dp, n_threads);
+    }
+
     for (;;) {
         dp_run(dp);
         dp_wait(dp);
@@ -194,7 +201,15 @@ parse_options(struct datapath *dp, int argc, char *argv[])
         OPT_SERIAL_NUM,
         OPT_BOOTSTRAP_CA_CERT,
         OPT_NO_LOCAL_PORT,
-        OPT_NO_SLICING
+        OPT_NO_SLICING,
+        OPT_RX_BATCH,
+        OPT_THREADS,
+        OPT_BUFFERS,
+        OPT_BUFFERS_MEM,
+        OPT_PKTIN_SUPPRESS,
+        OPT_SELECT_HASH,
+        OPT_RATE_LIMIT,
+        OPT_BURST_LIMIT
     };
 
     static struct option long_options[] = {
@@ -206,6 +221,14 @@ parse_options(struct datapath *dp, int argc, char *argv[])
         {"help",        no_argument, 0, 'h'},
         {"version",     no_argument, 0, 'V'},
         {"no-slicing",  no_argument, 0, OPT_NO_SLICING},
+        {"rx-batch",    required_argument, 0, OPT_RX_BATCH},
+        {"threads",     required_argument, 0, OPT_THREADS},
+        {"buffers",     required_argument, 0, OPT_BUFFERS},
+        {"buffers-mem", required_argument, 0, OPT_BUFFERS_MEM},
+        {"pktin-suppress", required_argument, 0, OPT_PKTIN_SUPPRESS},
+        {"select-hash", no_argument, 0, OPT_SELECT_HASH},
+        {"rate-limit",  optional_argument, 0, OPT_RATE_LIMIT},
+        {"burst-limit", required_argument, 0, OPT_BURST_LIMIT},
         {"mfr-desc",    required_argument, 0, OPT_MFR_DESC},
         {"hw-desc",     required_argument, 0, OPT_HW_DESC},
         {"sw-desc",     required_argument, 0, OPT_SW_DESC},
@@ -297,6 +320,76 @@ parse_options(struct datapath *dp, int argc, char *argv[])
             dp_set_max_queues(dp, 0);
             break;
 
+        case OPT_RX_BATCH: {
+            int rx_batch = atoi(optarg);
+            if (rx_batch < 1 || rx_batch > NETDEV_MAX_BATCH) {
+                ofp_fatal(0, "argument to --rx-batch must be between 1 and %d",
+                          NETDEV_MAX_BATCH);
+            }
+            dp_set_rx_batch(dp, rx_batch);
+            break;
+        }
+
+        case OPT_THREADS: {
+            int threads = atoi(optarg);
+            if (threads < 0 || threads > DP_MAX_PORTS) {
+                ofp_fatal(0, "argument to --threads must be between 0 and %d",
+                          DP_MAX_PORTS);
+            }
+            n_threads = threads;
+            break;
+        }
+
+        case OPT_BUFFERS: {
+            int buffers = atoi(optarg);
+            if (buffers < 1 || buffers > DP_BUFFERS_MAX) {
+                ofp_fatal(0, "argument to --buffers must be between 1 and %d",
+                          DP_BUFFERS_MAX);
+            }
+            dp_set_buffers(dp, buffers);
+            break;
+        }
+
+        case OPT_BUFFERS_MEM: {
+            int mem = atoi(optarg);
+            if (mem < 1 || (size_t)mem > SIZE_MAX / (1024 * 1024)) {
+                ofp_fatal(0, "argument to --buffers-mem must be a positive number of MB");
+            }
+            dp_set_buffers_mem(dp, (size_t)mem * 1024 * 1024);
+            break;
+        }
+
+        case OPT_PKTIN_SUPPRESS: {
+            int msec = atoi(optarg);
+            if (msec < 0) {
+                ofp_fatal(0, "argument to --pktin-suppress must not be negative");
+            }
+            dp_set_pktin_suppress(dp, msec);
+            break;
+        }
+
+        case OPT_SELECT_HASH:
+            dp_set_select_hash(dp, true);
+            break;
+
+        case OPT_RATE_LIMIT:
+            if (optarg) {
+                rate_limit = atoi(optarg);
+                if (rate_limit < 1) {
+                    ofp_fatal(0, "--rate-limit argument must be at least 1");
+                }
+            } else {
+                rate_limit = 1000;
+            }
+            break;
+
+        case OPT_BURST_LIMIT:
+            burst_limit = atoi(optarg);
+            if (burst_limit < 1) {
+                ofp_fatal(0, "--burst-limit argument must be at least 1");
+            }
+            break;
+
         DAEMON_OPTION_HANDLERS
 
 #ifdef HAVE_OPENSSL
@@ -315,6 +408,20 @@ parse_options(struct datapath *dp, int argc, char *argv[])
         }
     }
     free(short_options);
+
+    /* Rate limiting. */
+    if (rate_limit) {
+        if (rate_limit < 100) {
+            VLOG_WARN(THIS_MODULE, "Rate limit set to unusually low value %d",
+                      rate_limit);
+        }
+        if (!burst_limit) {
+            burst_limit = rate_limit / 4;
+        }
+        burst_limit = MAX(burst_limit, 1);
+        burst_limit = MIN(burst_limit, INT_MAX / 1000);
+        dp_set_pktin_rate(dp, rate_limit, burst_limit);
+    }
 }
 
 static void
@@ -334,6 +441,17 @@ usage(void)
            "  -d, --datapath-id=ID    Use ID as the OpenFlow switch ID\n"
            "                          (ID must consist of 12 hex digits)\n"
            "  --no-slicing            disable slicing\n"
+           "  --rx-batch=N            receive up to N packets per port at once\n"
+           "  --threads=N             process packets on N worker threads\n"
+           "  --buffers=N             buffer up to N packets for packet ins\n"
+           "  --buffers-mem=MB        use up to MB megabytes for buffered packets\n"
+           "  --pktin-suppress=MS     send a table miss of a flow only once per MS\n"
+           "                          milliseconds, until the next flow mod\n"
+           "  --select-hash           select group buckets by hashing the flow\n"
+           "                          of packets, instead of round robin\n"
+           "  --rate-limit[=PACKETS]  max rate of table miss packet ins, in\n"
+           "                          packets/s (default: 1000)\n"
+           "  --burst-limit=BURST     limit on packet credit for idle time\n"
            "\nOther options:\n"
            "  -D, --detach            run in background as daemon\n"
            "  -P, --pidfile[=FILE]    create pidfile (default: %s/ofdatapath.pid)\n"
@@ -219,10 +219,38 @@ dpctl_transact(struct vconn *vconn, struct ofl_msg_header *req,
     ofpbuf_delete(ofpbufrepl);
 }
 
+/* Receives the remaining parts of a stats reply sent in multiple messages. */
+static void
+dpctl_recv_more(struct vconn *vconn, struct ofl_msg_header **repl) {
+    struct ofpbuf *ofpbufrepl;
+    int error;
+
+    error = vconn_recv_xid(vconn, htonl(XID), &ofpbufrepl);
+    if (error) {
+        ofp_fatal(0, "Error during transaction.");
+    }
+
+    error = ofl_msg_unpack(ofpbufrepl->data, ofpbufrepl->size, repl, NULL /*xid_ptr*/, &dpctl_exp);
+    if (error) {
+        ofp_fatal(0, "Error unpacking reply.");
+    }
+
+    ofpbufrepl->base = NULL;
+    ofpbufrepl->data = NULL;
+    ofpbuf_delete(ofpbufrepl);
+}
+
+static bool
+dpctl_reply_more(struct ofl_msg_header *reply) {
+    return reply->type == OFPT_STATS_REPLY &&
+           (((struct ofl_msg_stats_reply_header *)reply)->flags & OFPSF_REPLY_MORE) != 0;
+}
+
 static void
 dpctl_transact_and_print(struct vconn *vconn, struct ofl_msg_header *req,
                                         struct ofl_msg_header **repl) {
     struct ofl_msg_header *reply;
+    bool more;
     char *str;
 
     str = ofl_msg_to_string(req, &dpctl_exp);
@@ -235,6 +263,21 @@ dpctl_transact_and_print(struct vconn *vconn, struct ofl_msg_header *req,
     printf("\nRECEIVED:\n%s\n\n", str);
     free(str);
 
+    /* NOTE: only the first part of a multipart reply is returned. */
+    more = dpctl_reply_more(reply);
+    while (more) {
+        struct ofl_msg_header *part;
+
+        dpctl_recv_more(vconn, &part);
+
+        str = ofl_msg_to_string(part, &dpctl_exp);
+        printf("\nRECEIVED:\n%s\n\n", str);
+        free(str);
+
+        more = dpctl_reply_more(part);
+        ofl_msg_free(part, &dpctl_exp);
+    }
+
     if (repl != NULL) {
         (*repl) = reply;
     } else {
@@ -699,6 +742,28 @@ set_desc(struct vconn *vconn, int argc UNUSED, char *argv[]) {
 
 
 
+static void
+stats_flow_cache(struct vconn *vconn, int argc UNUSED, char *argv[] UNUSED) {
+    struct ofl_exp_openflow_msg_header req =
+            {{{.type = OFPT_EXPERIMENTER},
+              .experimenter_id = OPENFLOW_VENDOR_ID},
+             .type = OFP_EXT_FLOW_CACHE_REQUEST};
+
+    dpctl_transact_and_print(vconn, (struct ofl_msg_header *)&req, NULL);
+}
+
+static void
+stats_pktin_rate(struct vconn *vconn, int argc UNUSED, char *argv[] UNUSED) {
+    struct ofl_exp_openflow_msg_header req =
+            {{{.type = OFPT_EXPERIMENTER},
+              .experimenter_id = OPENFLOW_VENDOR_ID},
+             .type = OFP_EXT_PKTIN_RATE_REQUEST};
+
+    dpctl_transact_and_print(vconn, (struct ofl_msg_header *)&req, NULL);
+}
+
+
+
 static void
 queue_mod(struct vconn *vconn, int argc UNUSED, char *argv[]) {
     struct ofl_packet_queue *pq;
@@ -779,6 +844,8 @@ static struct command all_commands[] = {
     {"stats-queue", 0, 2, stats_queue },
     {"stats-group", 0, 1, stats_group },
     {"stats-group-desc", 0, 1, stats_group_desc },
+    {"stats-flow-cache", 0, 0, stats_flow_cache },
+    {"stats-pktin-rate", 0, 0, stats_pktin_rate },
 
     {"set-config", 1, 1, set_config},
     {"flow-mod", 1, 7/*+1 for each inst type*/, flow_mod },
@@ -930,6 +997,8 @@ usage(void)
             "  SWITCH stats-queue [PORT [QUEUE]]      print queue statistics\n"
             "  SWITCH stats-group [GROUP]             print group statistics\n"
             "  SWITCH stats-group-desc [GROUP]        print group desc statistics\n"
+            "  SWITCH stats-flow-cache                print flow cache hits and misses\n"
+            "  SWITCH stats-pktin-rate                print packet in rate limiter counters\n"
             "\n"
             "  SWITCH set-config ARG                  set switch configuration\n"
             "  SWITCH flow-mod ARG [MATCH [INST...]]  send flow_mod message\n"